@@ -0,0 +1,221 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#include "tga/tga_bvh.hpp"
+#include "tga/tga_utils.hpp"
+
+// Measures the CPU acceleration structures without a GPU: build times and rays per second per core for closest hit
+// and occlusion queries, each with single rays and 8-wide packets. Also checks that the packets find the same hits as
+// the single rays.
+// Usage: bvhBenchmark [model.obj], a procedural scene is used without a model
+
+namespace
+{
+constexpr uint32_t width = 1024;
+constexpr uint32_t height = 768;
+
+struct Mesh {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+};
+
+// Sphere with bumps, dense enough that the bottom level dominates the traversal
+Mesh bumpySphere(uint32_t rings, uint32_t segments)
+{
+    Mesh mesh;
+    for (uint32_t ring = 0; ring <= rings; ++ring) {
+        float theta = glm::pi<float>() * ring / rings;
+        for (uint32_t segment = 0; segment <= segments; ++segment) {
+            float phi = 2.f * glm::pi<float>() * segment / segments;
+            float radius = 1.f + 0.05f * std::sin(12.f * theta) * std::sin(16.f * phi);
+            mesh.positions.emplace_back(radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta),
+                                        radius * std::sin(theta) * std::sin(phi));
+        }
+    }
+    for (uint32_t ring = 0; ring < rings; ++ring) {
+        for (uint32_t segment = 0; segment < segments; ++segment) {
+            uint32_t current = ring * (segments + 1) + segment;
+            uint32_t below = current + segments + 1;
+            mesh.indices.insert(mesh.indices.end(), {current, below, current + 1, current + 1, below, below + 1});
+        }
+    }
+    return mesh;
+}
+
+Mesh loadMesh(char const *filepath)
+{
+    auto obj = tga::loadObj(filepath);
+    Mesh mesh;
+    for (auto& vertex : obj.vertexBuffer) mesh.positions.push_back(vertex.position);
+    mesh.indices = std::move(obj.indexBuffer);
+    return mesh;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Camera {
+    glm::vec3 position, forward, right, up;
+
+    tga::cpu::Ray ray(uint32_t x, uint32_t y) const
+    {
+        float u = (x + 0.5f) / width * 2.f - 1.f;
+        float v = 1.f - (y + 0.5f) / height * 2.f;
+        tga::cpu::Ray ray;
+        ray.origin = position;
+        ray.direction = forward + u * right * (float(width) / height) + v * up;
+        return ray;
+    }
+};
+
+// Each thread takes rows until the image is done. Returns rays per second
+template <typename RowFunction>
+double traceImage(uint32_t threadCount, RowFunction const& traceRow)
+{
+    std::atomic<uint32_t> nextRow{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < threadCount; ++i)
+        threads.emplace_back([&] {
+            for (uint32_t row = nextRow++; row < height; row = nextRow++) traceRow(row);
+        });
+    for (auto& thread : threads) thread.join();
+    return width * height / secondsSince(start);
+}
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    auto mesh = argc > 1 ? loadMesh(argv[1]) : bumpySphere(384, 768);
+
+    auto start = std::chrono::steady_clock::now();
+    tga::cpu::BottomLevelBVH blas({tga::cpu::TriangleGeometry{mesh.positions.data(), sizeof(glm::vec3),
+                                                              mesh.indices.data(),
+                                                              static_cast<uint32_t>(mesh.indices.size())}});
+    auto blasSeconds = secondsSince(start);
+
+    // Instances on a grid that covers the view, scaled to the size of the mesh
+    auto bounds = blas.bounds();
+    auto size = bounds.max - bounds.min;
+    float extent = std::max(std::max(size.x, size.y), size.z);
+    glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    constexpr int gridSize = 8;
+    std::vector<tga::cpu::Instance> instances;
+    for (int z = 0; z < gridSize; ++z) {
+        for (int x = 0; x < gridSize; ++x) {
+            float scale = 2.f / extent;
+            glm::vec3 offset{(x - gridSize / 2) * 2.5f, 0.f, (z - gridSize / 2) * 2.5f};
+            offset -= center * scale;
+            tga::ext::TransformMatrix transform{{{scale, 0.f, 0.f, offset.x},
+                                                 {0.f, scale, 0.f, offset.y},
+                                                 {0.f, 0.f, scale, offset.z}}};
+            instances.push_back({&blas, transform, static_cast<uint32_t>(instances.size())});
+        }
+    }
+    start = std::chrono::steady_clock::now();
+    tga::cpu::TopLevelBVH tlas(instances);
+    auto tlasSeconds = secondsSince(start);
+
+    std::cout << "Triangles: " << blas.triangleCount() << ", instances: " << instances.size() << '\n';
+    std::cout << "BLAS build: " << blasSeconds * 1000. << "ms (" << blas.nodeCount() << " nodes)\n";
+    std::cout << "TLAS build: " << tlasSeconds * 1000. << "ms (" << tlas.nodeCount() << " nodes)\n";
+
+    Camera camera;
+    camera.position = {0.f, 6.f, -14.f};
+    camera.forward = glm::normalize(glm::vec3{0.f, -0.4f, 1.f});
+    camera.right = glm::normalize(glm::cross(glm::vec3{0.f, 1.f, 0.f}, camera.forward));
+    camera.up = glm::cross(camera.forward, camera.right);
+    glm::vec3 toLight = glm::normalize(glm::vec3{0.3f, 1.f, -0.2f});
+
+    // Shadow rays start on the closest hits of the camera rays. The results of every pixel are kept to compare the
+    // packets with the single rays, each run writes the same values
+    std::vector<tga::cpu::Ray> shadowRays(width * height);
+    std::vector<uint8_t> hasShadowRay(width * height);
+    std::vector<tga::cpu::Hit> hits(width * height), packetHits(width * height);
+    std::vector<uint8_t> occluded(width * height), packetOccluded(width * height);
+    auto closestHit = [&](uint32_t row) {
+        for (uint32_t x = 0; x < width; ++x) {
+            auto ray = camera.ray(x, row);
+            auto index = row * width + x;
+            auto& hit = hits[index] = tlas.intersect(ray);
+            hasShadowRay[index] = bool(hit);
+            if (!hit) continue;
+            auto& shadowRay = shadowRays[index];
+            shadowRay.origin = ray.origin + hit.t * ray.direction;
+            shadowRay.tMin = 1e-3f;
+            shadowRay.direction = toLight;
+        }
+    };
+    // Packets are 8 neighbouring pixels of a row, which keeps their rays coherent
+    auto closestHitPackets = [&](uint32_t row) {
+        for (uint32_t x = 0; x < width; x += tga::cpu::packetSize) {
+            tga::cpu::RayPacket packet;
+            for (uint32_t lane = 0; lane < tga::cpu::packetSize; ++lane) packet.setRay(lane, camera.ray(x + lane, row));
+            auto laneHits = tlas.intersect(packet);
+            for (uint32_t lane = 0; lane < tga::cpu::packetSize; ++lane)
+                packetHits[row * width + x + lane] = laneHits.getHit(lane);
+        }
+    };
+    auto occlusion = [&](uint32_t row) {
+        for (uint32_t x = 0; x < width; ++x) {
+            auto index = row * width + x;
+            occluded[index] = hasShadowRay[index] && tlas.occluded(shadowRays[index]);
+        }
+    };
+    auto occlusionPackets = [&](uint32_t row) {
+        for (uint32_t x = 0; x < width; x += tga::cpu::packetSize) {
+            tga::cpu::RayPacket packet;
+            packet.activeLanes = 0;
+            for (uint32_t lane = 0; lane < tga::cpu::packetSize; ++lane) {
+                auto index = row * width + x + lane;
+                if (!hasShadowRay[index]) continue;
+                packet.setRay(lane, shadowRays[index]);
+                packet.activeLanes |= 1u << lane;
+            }
+            auto occludedLanes = packet.activeLanes ? tlas.occluded(packet) : 0u;
+            for (uint32_t lane = 0; lane < tga::cpu::packetSize; ++lane)
+                packetOccluded[row * width + x + lane] = (occludedLanes >> lane) & 1u;
+        }
+    };
+
+    auto cores = std::max(std::thread::hardware_concurrency(), 1u);
+    auto report = [&](char const *name, auto const& traceRow) {
+        auto singleCore = traceImage(1, traceRow);
+        auto allCores = traceImage(cores, traceRow);
+        std::cout << name << ": " << singleCore / 1e6 << " MRays/s on 1 core, " << allCores / 1e6 << " MRays/s on "
+                  << cores << " cores (" << allCores / cores / 1e6 << " MRays/s per core)\n";
+    };
+    report("Closest hit, single rays", closestHit);
+    report("Closest hit, packets", closestHitPackets);
+    // Occlusion rays per second count every pixel, pixels without a camera hit have no shadow ray
+    report("Occlusion, single rays", occlusion);
+    report("Occlusion, packets", occlusionPackets);
+
+    // Packets have to find the same triangle at the same distance as single rays, and the same occlusion. A ray through
+    // the shared edge of two triangles may hit both at exactly the same t, then the traversal order decides which one
+    // is returned and either is a closest hit
+    uint32_t hitCount{0}, occludedCount{0}, ties{0}, mismatches{0};
+    for (uint32_t index = 0; index < width * height; ++index) {
+        auto& hit = hits[index];
+        auto& packetHit = packetHits[index];
+        bool sameDistance = bool(hit) == bool(packetHit) && (!hit || hit.t == packetHit.t);
+        bool sameTriangle =
+            hit.instanceIndex == packetHit.instanceIndex && hit.primitiveIndex == packetHit.primitiveIndex;
+        ties += sameDistance && !sameTriangle;
+        if ((!sameDistance || occluded[index] != packetOccluded[index]) && !mismatches++)
+            std::cout << "First mismatch between packets and single rays at pixel (" << index % width << ", "
+                      << index / width << ")\n";
+        hitCount += bool(hit);
+        occludedCount += occluded[index];
+    }
+    std::cout << "Camera rays hitting the scene: " << hitCount / double(width * height) * 100.
+              << "%, shadowed: " << occludedCount / double(std::max(hitCount, 1u)) * 100. << "%\n";
+    std::cout << "Packets and single rays differ for " << mismatches << " of " << width * height << " pixels, "
+              << ties << " hit two triangles at the same distance\n";
+    return mismatches ? 1 : 0;
+}
@@ -102,6 +102,21 @@ int main()
     std::cout << "Buffer Readback time: " << std::chrono::duration<double, std::milli>(transferEnd - transferStart).count() << "ms\n";
     std::cout << "Texture content:" << *static_cast<uint32_t*>(tgai.getMapping(texStaging)) << '\n';
 
+    // An asynchronous readback returns immediately, its data is delivered by pollReadbacks once it arrived
+    bool asyncResultMatches{false};
+    auto asyncStart = std::chrono::steady_clock::now();
+    tgai.readback(zBuf, bufferSize, 0, [&](void const *data, size_t size) {
+        asyncResultMatches = std::memcmp(data, z, size) == 0;
+    });
+    auto asyncIssued = std::chrono::steady_clock::now();
+    // A real application would keep rendering frames here instead of spinning
+    while (tgai.pollReadbacks() == 0) {}
+    auto asyncEnd = std::chrono::steady_clock::now();
+    std::cout << "Async Readback issue time: "
+              << std::chrono::duration<double, std::milli>(asyncIssued - asyncStart).count() << "ms, data after "
+              << std::chrono::duration<double, std::milli>(asyncEnd - asyncStart).count() << "ms, "
+              << (asyncResultMatches ? "matches" : "differs") << '\n';
+
     saxpy(params, x, y, z);
 
     return 0;
@@ -14,19 +14,14 @@ int main()
     tga::Shader fragmentShaderBG =
         tga::loadShader("../shaders/deferred_rendering_bg_frag.spv", tga::ShaderType::fragment, tgai);
 
-    // Textures being written into
+    // G-buffer textures, only used within the RenderPass
     tga::Texture cc1 = tgai.createTexture({screenResX, screenResY, tga::Format::r16g16b16a16_sfloat});
     // Can mix and match formats but not resolutions
     tga::Texture cc2 = tgai.createTexture({screenResX, screenResY, tga::Format::r8g8b8a8_srgb});
     tga::Texture cc3 = tgai.createTexture({screenResX, screenResY, tga::Format::r32_sfloat});
     tga::Texture cc4 = tgai.createTexture({screenResX, screenResY, tga::Format::r16_sfloat});
-    // Renderpass using the shaders and rendering to the window
-    tga::RenderPass renderPassBG =
-        tgai.createRenderPass(tga::RenderPassInfo{vertexShaderBG, fragmentShaderBG}
-                                  .setRenderTarget(std::vector<tga::Texture>{cc1, cc2, cc3, cc4})
-                                  .setClearOperations(tga::ClearOperation::all));
 
-    // Perform operations using output from previous pass as input
+    // Combine the G-buffer values in a second subpass
     tga::Shader vertexShaderFG, fragmentShaderFG;
     try {
         vertexShaderFG = tga::loadShader("../shaders/deferred_rendering_fg_vert.spv", tga::ShaderType::vertex, tgai);
@@ -37,27 +32,41 @@ int main()
         std::cerr << "Is your working directory `examples/`?\n";
     }
 
-    auto setLayout = tga::SetLayout{{tga::BindingType::sampler, 1} /*cc1*/,
-                                    {tga::BindingType::sampler, 1} /*cc2*/,
-                                    {tga::BindingType::sampler, 1} /*cc3*/,
-                                    {tga::BindingType::sampler, 1} /*cc4*/};
+    // The G-buffer is read at the position of the fragment, no sampler needed
+    auto setLayout = tga::SetLayout{{tga::BindingType::inputAttachment, 1} /*cc1*/,
+                                    {tga::BindingType::inputAttachment, 1} /*cc2*/,
+                                    {tga::BindingType::inputAttachment, 1} /*cc3*/,
+                                    {tga::BindingType::inputAttachment, 1} /*cc4*/};
     tga::Window window = tgai.createWindow({screenResX, screenResY});
-    auto rpFGInfo =
-        tga::RenderPassInfo{vertexShaderFG, fragmentShaderFG, window}.setInputLayout(tga::InputLayout{setLayout});
 
-    // Add a set layout to create binding points for input textures
-    tga::RenderPass renderPassFG = tgai.createRenderPass(rpFGInfo);
-    tga::InputSet ccIS = tgai.createInputSet(
-        tga::InputSetInfo(renderPassFG).setBindings({{cc1, 0}, {cc2, 1}, {cc3, 2}, {cc4, 3}}).setIndex(0));
+    // Attachment 0 is the window, the G-buffer follows as attachments 1 to 4
+    auto gBufferSubpass = tga::SubpassInfo{vertexShaderBG, fragmentShaderBG, {1, 2, 3, 4}}.setDepthAttachment(false);
+    auto lightingSubpass = tga::SubpassInfo{vertexShaderFG, fragmentShaderFG, {0}, {1, 2, 3, 4}}
+                               .setInputLayout(tga::InputLayout{setLayout})
+                               .setDepthAttachment(false);
+
+    // Both subpasses run in one RenderPass, so the G-buffer never has to be written back to memory
+    tga::RenderPass renderPass =
+        tgai.createRenderPass(tga::RenderPassInfo{vertexShaderBG, fragmentShaderBG, window}
+                                  .setSubpasses({gBufferSubpass, lightingSubpass})
+                                  .setSubpassAttachments({cc1, cc2, cc3, cc4})
+                                  .setSubpassAttachmentStoreOp(tga::StoreOperation::dontCare)
+                                  .setClearOperations(tga::ClearOperation::all)
+                                  .setDepthConfig({tga::DepthFormat::none}));
+
+    tga::InputSet ccIS = tgai.createInputSet(tga::InputSetInfo(renderPass)
+                                                 .setBindings({{cc1, 0}, {cc2, 1}, {cc3, 2}, {cc4, 3}})
+                                                 .setIndex(0)
+                                                 .setSubpass(1));
 
     tga::CommandBuffer cmdBuffer;
 
     while (!tgai.windowShouldClose(window)) {
         auto nextFrame = tgai.nextFrame(window);
         cmdBuffer = tga::CommandRecorder{tgai, cmdBuffer}
-                        .setRenderPass(renderPassBG, 0)
+                        .setRenderPass(renderPass, nextFrame)
                         .draw(3, 0)
-                        .setRenderPass(renderPassFG, nextFrame)
+                        .nextSubpass()
                         .bindInputSet(ccIS)
                         .draw(3, 0)
                         .endRecording();
@@ -16,6 +16,7 @@ void HeightmapViewer::setHeightmap(float *data, uint32_t imageWidth, uint32_t im
     heightmapInfo.setSrcData(texData);
     heightmap = tgai.createTexture(heightmapInfo);
     tgai.free(texData);
+    if (textureIS) tgai.updateInputSet(textureIS, {{heightmap, 0}});
     tData.terrainScale = glm::vec3(terrainWidth, terrainHeight, terrainDepth);
 }
 
@@ -23,9 +24,11 @@ void setTextureContent(tga::Texture& target, tga::Interface& tgai, uint8_t *rgba
 {
     if (target) tgai.free(target);
     auto texData = tgai.createStagingBuffer({4 * width * height, rgba_data});
+    // Tiled terrain textures are heavily minified in the distance, the mip chain keeps them from shimmering
     target = tgai.createTexture(
         tga::TextureInfo{width, height, tga::Format::r8g8b8a8_srgb, tga::SamplerMode::linear, tga::AddressMode::repeat}
-            .setSrcData(texData));
+            .setSrcData(texData)
+            .setMipLevels(tga::TextureInfo::autoMipLevels));
     tgai.free(texData);
 }
 
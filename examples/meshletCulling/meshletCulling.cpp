@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "tga/tga.hpp"
+#include "tga/tga_math.hpp"
+#include "tga/tga_utils.hpp"
+
+// Culls the meshlets of a mesh in a compute shader every frame: meshlets outside of the frustum or facing away from
+// the camera are skipped, the indices of the others are appended to an index buffer drawn with drawIndexedIndirect.
+// Usage: meshletCulling [model.obj], a procedural sphere is used without a model. Press C to toggle culling
+
+namespace
+{
+// Same layout as the uniform block of the shaders
+struct Culling {
+    alignas(16) glm::mat4 modelViewProjection;
+    alignas(16) glm::vec3 cameraPosition;
+    uint32_t meshletCount;
+};
+
+// Sphere with bumps, outward facing with counter clockwise triangles
+tga::Obj bumpySphere(uint32_t rings, uint32_t segments)
+{
+    tga::Obj obj;
+    for (uint32_t ring = 0; ring <= rings; ++ring) {
+        float theta = glm::pi<float>() * ring / rings;
+        for (uint32_t segment = 0; segment <= segments; ++segment) {
+            float phi = 2.f * glm::pi<float>() * segment / segments;
+            glm::vec3 direction{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+            auto& vertex = obj.vertexBuffer.emplace_back();
+            vertex.position = direction * (1.f + 0.03f * std::sin(24.f * theta) * std::sin(32.f * phi));
+            vertex.normal = direction;
+        }
+    }
+    for (uint32_t ring = 0; ring < rings; ++ring) {
+        for (uint32_t segment = 0; segment < segments; ++segment) {
+            uint32_t current = ring * (segments + 1) + segment;
+            uint32_t below = current + segments + 1;
+            obj.indexBuffer.insert(obj.indexBuffer.end(), {current, current + 1, below, current + 1, below + 1, below});
+        }
+    }
+    return obj;
+}
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    tga::Interface tgai{};
+
+    auto obj = argc > 1 ? tga::loadObj(argv[1]) : bumpySphere(1024, 2048);
+    tga::optimizeMesh(obj);
+    auto meshlets = tga::buildMeshlets(obj);
+    auto triangleCount = static_cast<uint32_t>(obj.indexBuffer.size() / 3);
+    std::cout << "Triangles: " << triangleCount << ", meshlets: " << meshlets.size() << '\n';
+
+    glm::vec3 boundsMin{std::numeric_limits<float>::max()}, boundsMax{-std::numeric_limits<float>::max()};
+    for (auto& vertex : obj.vertexBuffer) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+    auto createBuffer = [&](tga::BufferUsage usage, size_t size, void const *data) {
+        auto staging = tgai.createStagingBuffer({size, static_cast<uint8_t const *>(data)});
+        auto buffer = tgai.createBuffer({usage, size, staging});
+        tgai.free(staging);
+        return buffer;
+    };
+    auto indexDataSize = obj.indexBuffer.size() * sizeof(uint32_t);
+    auto vertexBuffer = createBuffer(tga::BufferUsage::vertex, obj.vertexBuffer.size() * sizeof(tga::Vertex),
+                                     obj.vertexBuffer.data());
+    // The full index buffer draws the mesh without culling
+    auto indexBuffer =
+        createBuffer(tga::BufferUsage::index | tga::BufferUsage::storage, indexDataSize, obj.indexBuffer.data());
+    auto meshletBuffer =
+        createBuffer(tga::BufferUsage::storage, meshlets.size() * sizeof(tga::Meshlet), meshlets.data());
+    auto culledIndexBuffer = tgai.createBuffer({tga::BufferUsage::index | tga::BufferUsage::storage, indexDataSize});
+    auto drawCommandBuffer = tgai.createBuffer(
+        {tga::BufferUsage::indirect | tga::BufferUsage::storage, sizeof(tga::DrawIndexedIndirectCommand)});
+    auto cullingBuffer = tgai.createBuffer({tga::BufferUsage::uniform, sizeof(Culling)});
+
+    auto cullShader = tga::loadShader("../shaders/meshletCulling_comp.spv", tga::ShaderType::compute, tgai);
+    auto vertexShader = tga::loadShader("../shaders/meshletCulling_vert.spv", tga::ShaderType::vertex, tgai);
+    auto fragmentShader = tga::loadShader("../shaders/meshletCulling_frag.spv", tga::ShaderType::fragment, tgai);
+
+    auto cullPass = tgai.createComputePass(
+        {cullShader, tga::InputLayout{tga::SetLayout{tga::BindingType::uniformBuffer, tga::BindingType::storageBuffer,
+                                                     tga::BindingType::storageBuffer, tga::BindingType::storageBuffer,
+                                                     tga::BindingType::storageBuffer}}});
+    auto cullInputSet = tgai.createInputSet({cullPass,
+                                             {{cullingBuffer, 0},
+                                              {meshletBuffer, 1},
+                                              {indexBuffer, 2},
+                                              {culledIndexBuffer, 3},
+                                              {drawCommandBuffer, 4}},
+                                             0});
+
+    auto [screenResX, screenResY] = tgai.screenResolution();
+    tga::Window window = tgai.createWindow({screenResX, screenResY});
+    auto renderPass =
+        tgai.createRenderPass(tga::RenderPassInfo{vertexShader, fragmentShader, window}
+                                  .setVertexLayout(tga::Vertex::layout())
+                                  .setClearOperations(tga::ClearOperation::all)
+                                  .setPerPixelOperations(tga::PerPixelOperations{}.setDepthCompareOp(
+                                      tga::CompareOperation::less))
+                                  .setRasterizerConfig({tga::FrontFace::counterclockwise, tga::CullMode::back})
+                                  .setInputLayout({tga::SetLayout{tga::BindingType::uniformBuffer}}));
+    auto renderInputSet = tgai.createInputSet({renderPass, {{cullingBuffer, 0}}, 0});
+
+    bool cullingEnabled{true}, toggleHeld{false};
+    uint32_t drawnTriangles{triangleCount};
+    uint32_t frameCount{0};
+    auto start = std::chrono::steady_clock::now();
+    auto titleTime = start;
+    tga::CommandBuffer cmdBuffer;
+    while (!tgai.windowShouldClose(window)) {
+        auto nextFrame = tgai.nextFrame(window);
+        bool toggleDown = tgai.keyDown(window, tga::Key::C);
+        if (toggleDown && !toggleHeld) cullingEnabled = !cullingEnabled;
+        toggleHeld = toggleDown;
+
+        // Orbit close enough that parts of the mesh leave the screen
+        float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        glm::vec3 cameraPosition =
+            center + radius * glm::vec3(std::sin(0.3f * time), 0.4f * std::sin(0.2f * time), std::cos(0.3f * time));
+        auto view = glm::lookAt(cameraPosition, center, glm::vec3(0.f, 1.f, 0.f));
+        float aspectRatio = float(screenResX) / float(screenResY);
+        auto projection = glm::perspective_vk(glm::radians(60.f), aspectRatio, 0.01f * radius, 10.f * radius);
+        // The mesh is drawn without a model matrix, mesh space is world space
+        Culling culling{projection * view, cameraPosition, static_cast<uint32_t>(meshlets.size())};
+        tga::DrawIndexedIndirectCommand emptyDraw{0, 1, 0, 0, 0};
+
+        tga::CommandRecorder recorder{tgai, cmdBuffer};
+        recorder.inlineBufferUpdate(cullingBuffer, &culling, sizeof(culling));
+        if (cullingEnabled) {
+            // Meshlets beyond the x limit of the dispatch continue in y
+            constexpr uint32_t maxGroupsX = 65535;
+            auto meshletCount = static_cast<uint32_t>(meshlets.size());
+            recorder.inlineBufferUpdate(drawCommandBuffer, &emptyDraw, sizeof(emptyDraw))
+                .barrier(tga::PipelineStage::Transfer, tga::PipelineStage::ComputeShader)
+                .setComputePass(cullPass)
+                .bindInputSet(cullInputSet)
+                .dispatch(std::min(meshletCount, maxGroupsX), (meshletCount + maxGroupsX - 1) / maxGroupsX, 1)
+                .barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::DrawIndirect)
+                .barrier(tga::PipelineStage::ComputeShader, tga::PipelineStage::VertexInput);
+        }
+        recorder.barrier(tga::PipelineStage::Transfer, tga::PipelineStage::VertexShader)
+            .setRenderPass(renderPass, nextFrame, {0.1f, 0.1f, 0.15f, 1.f})
+            .bindInputSet(renderInputSet)
+            .bindVertexBuffer(vertexBuffer);
+        if (cullingEnabled) recorder.bindIndexBuffer(culledIndexBuffer).drawIndexedIndirect(drawCommandBuffer, 1);
+        else recorder.bindIndexBuffer(indexBuffer).drawIndexed(triangleCount * 3, 0, 0);
+        cmdBuffer = recorder.endRecording();
+        tgai.execute(cmdBuffer);
+        tgai.present(window, nextFrame);
+
+        ++frameCount;
+        auto now = std::chrono::steady_clock::now();
+        float seconds = std::chrono::duration<float>(now - titleTime).count();
+        if (seconds < 1.f) continue;
+        // The draw command of this frame arrives a few frames later, nextFrame delivers it
+        if (cullingEnabled)
+            tgai.readback(drawCommandBuffer, sizeof(uint32_t), 0, [&](void const *data, size_t) {
+                drawnTriangles = *static_cast<uint32_t const *>(data) / 3;
+            });
+        else drawnTriangles = triangleCount;
+        std::stringstream windowTitle;
+        windowTitle << "TGA Meshlet Culling (" << frameCount / seconds << " fps, "
+                    << (cullingEnabled ? "culling" : "no culling") << ", " << drawnTriangles << " of "
+                    << triangleCount << " triangles drawn)";
+        tgai.setWindowTitle(window, windowTitle.str());
+        frameCount = 0;
+        titleTime = now;
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "tga/tga_utils.hpp"
+
+// Compares the load time of tga::loadObj with the sequential tinyobjloader based loader it replaced, checks that both
+// return the same vertices and indices, and compares with reading the optimized mesh back from a binary mesh file
+// written next to the model. Also reports the size and normal error
+// of the quantized CompactVertex.
+// Usage: objBenchmark model.obj [runs], large models show the difference best
+
+namespace
+{
+// The previous tga::loadObj: tinyobjloader, then one Vertex per face vertex deduplicated with std::unordered_map
+tga::Obj loadObjSequential(std::string const& filepath)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str()))
+        throw std::runtime_error(warn + err);
+
+    std::vector<tga::Vertex> preVertexBuffer;
+    for (auto const& shape : shapes) {
+        for (auto const& index : shape.mesh.indices) {
+            auto& vertex = preVertexBuffer.emplace_back();
+            vertex.position = {attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1],
+                               attrib.vertices[3 * index.vertex_index + 2]};
+            if (index.normal_index != -1)
+                vertex.normal = {attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1],
+                                 attrib.normals[3 * index.normal_index + 2]};
+            if (index.texcoord_index != -1)
+                vertex.uv = {attrib.texcoords[2 * index.texcoord_index + 0],
+                             1.f - attrib.texcoords[2 * index.texcoord_index + 1]};
+        }
+    }
+    for (size_t i = 0; i < preVertexBuffer.size(); i += 3) {
+        auto deltaPos1 = preVertexBuffer[i + 1].position - preVertexBuffer[i].position;
+        auto deltaPos2 = preVertexBuffer[i + 2].position - preVertexBuffer[i].position;
+        auto deltaUV1 = preVertexBuffer[i + 1].uv - preVertexBuffer[i].uv;
+        auto deltaUV2 = preVertexBuffer[i + 2].uv - preVertexBuffer[i].uv;
+        float r = 1.f / (deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x);
+        glm::vec3 tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * r;
+        for (size_t j = i; j < i + 3; ++j) preVertexBuffer[j].tangent = tangent;
+    }
+
+    std::unordered_map<tga::Vertex, uint32_t> foundVertices;
+    tga::Obj obj;
+    for (auto const& vertex : preVertexBuffer) {
+        if (!foundVertices.count(vertex)) {
+            foundVertices[vertex] = static_cast<uint32_t>(obj.vertexBuffer.size());
+            obj.vertexBuffer.emplace_back(vertex);
+        } else {
+            obj.vertexBuffer[foundVertices[vertex]].tangent += vertex.tangent;
+        }
+        obj.indexBuffer.emplace_back(foundVertices[vertex]);
+    }
+    for (auto& vertex : obj.vertexBuffer) vertex.tangent = glm::normalize(vertex.tangent);
+    return obj;
+}
+
+// Empty if both loaders return the same index buffer and the same vertices, the tangents are sums of the same values in
+// the same order but may round differently between compilation units
+std::string compareLoaders(tga::Obj const& parallel, tga::Obj const& sequential)
+{
+    std::stringstream mismatch;
+    if (parallel.vertexBuffer.size() != sequential.vertexBuffer.size())
+        mismatch << parallel.vertexBuffer.size() << " instead of " << sequential.vertexBuffer.size() << " vertices";
+    else if (parallel.indexBuffer.size() != sequential.indexBuffer.size())
+        mismatch << parallel.indexBuffer.size() << " instead of " << sequential.indexBuffer.size() << " indices";
+    if (!mismatch.str().empty()) return mismatch.str();
+
+    auto& indices = parallel.indexBuffer;
+    auto index = std::mismatch(indices.begin(), indices.end(), sequential.indexBuffer.begin());
+    if (index.first != indices.end())
+        mismatch << "index " << index.first - indices.begin() << " is " << *index.first << " instead of "
+                 << *index.second;
+    for (size_t i = 0; i < parallel.vertexBuffer.size() && mismatch.str().empty(); ++i) {
+        auto& vertex = parallel.vertexBuffer[i];
+        auto& expected = sequential.vertexBuffer[i];
+        bool sameTangent{true};
+        for (int c = 0; c < 3; ++c) {
+            bool bothNaN = std::isnan(vertex.tangent[c]) && std::isnan(expected.tangent[c]);
+            sameTangent = sameTangent && (bothNaN || std::abs(vertex.tangent[c] - expected.tangent[c]) <= 1e-5f);
+        }
+        if (!(vertex == expected)) mismatch << "position, uv or normal of vertex " << i << " differ";
+        else if (!sameTangent) mismatch << "tangent of vertex " << i << " differs";
+    }
+    return mismatch.str();
+}
+
+// Median of the runs in milliseconds
+template <typename Function>
+double measure(uint32_t runs, Function const& function)
+{
+    std::vector<double> times;
+    for (uint32_t run = 0; run < runs; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        std::cerr << "Usage: objBenchmark model.obj [runs]\n";
+        return 1;
+    }
+    std::string filepath = argv[1];
+    uint32_t runs = argc > 2 ? std::max(std::stoi(argv[2]), 1) : 3;
+
+    tga::Obj parallel, sequential;
+    auto parallelTime = measure(runs, [&] { parallel = tga::loadObj(filepath); });
+    auto sequentialTime = measure(runs, [&] { sequential = loadObjSequential(filepath); });
+
+    std::cout << "Vertices: " << parallel.vertexBuffer.size() << ", triangles: " << parallel.indexBuffer.size() / 3
+              << '\n';
+    std::cout << "tga::loadObj: " << parallelTime << "ms on " << std::thread::hardware_concurrency() << " threads\n";
+    std::cout << "tinyobjloader and std::unordered_map: " << sequentialTime << "ms ("
+              << sequentialTime / parallelTime << "x)\n";
+    auto mismatch = compareLoaders(parallel, sequential);
+    if (mismatch.empty()) std::cout << "Both loaders return the same vertices and indices\n";
+    else std::cout << "Error: the loaders disagree, " << mismatch << '\n';
+
+    tga::MeshOptimizationReport report;
+    auto optimizeTime = measure(1, [&] { report = tga::optimizeMesh(parallel); });
+    std::cout << "optimizeMesh: " << optimizeTime << "ms, ACMR " << report.before.acmr << " -> " << report.after.acmr
+              << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << '\n';
+
+    auto compact = tga::quantizeObj(parallel);
+    float maxNormalError{0.f};
+    for (size_t i = 0; i < compact.vertexBuffer.size(); ++i) {
+        auto& encoded = compact.vertexBuffer[i].normal;
+        auto normal = tga::octahedralDecode(glm::vec2{encoded[0] / 32767.f, encoded[1] / 32767.f});
+        auto cosine = glm::dot(normal, glm::normalize(parallel.vertexBuffer[i].normal));
+        maxNormalError = std::max(maxNormalError, glm::degrees(std::acos(std::min(cosine, 1.f))));
+    }
+    std::cout << "CompactVertex: " << sizeof(tga::CompactVertex) << " instead of " << sizeof(tga::Vertex)
+              << " bytes per vertex, max normal error " << maxNormalError << " degrees\n";
+
+    // Opening the file only maps it, the checksum touches all of the data like the copy into a staging buffer would
+    auto meshFilepath = filepath + ".mesh";
+    tga::writeMesh(meshFilepath, parallel);
+    uint64_t checksum{0};
+    auto meshFileTime = measure(runs, [&] {
+        tga::MeshFile meshFile(meshFilepath);
+        auto vertexBytes = static_cast<uint8_t const *>(meshFile.vertexData());
+        for (size_t i = 0; i < meshFile.vertexCount() * meshFile.vertexLayout().vertexSize; i += 8)
+            checksum += vertexBytes[i];
+        for (uint32_t i = 0; i < meshFile.indexCount(); ++i) checksum += meshFile.indexData()[i];
+    });
+    std::cout << "Mesh file: " << meshFileTime << "ms (" << parallelTime / meshFileTime << "x faster than OBJ, "
+              << meshFilepath << ", checksum " << checksum % 1000 << ")\n";
+    return mismatch.empty() ? 0 : 1;
+}
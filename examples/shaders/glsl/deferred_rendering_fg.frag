@@ -1,19 +1,19 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(set = 0, binding = 0) uniform sampler2D cc1;
-layout(set = 0, binding = 1) uniform sampler2D cc2;
-layout(set = 0, binding = 2) uniform sampler2D cc3;
-layout(set = 0, binding = 3) uniform sampler2D cc4;
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput cc1;
+layout(input_attachment_index = 1, set = 0, binding = 1) uniform subpassInput cc2;
+layout(input_attachment_index = 2, set = 0, binding = 2) uniform subpassInput cc3;
+layout(input_attachment_index = 3, set = 0, binding = 3) uniform subpassInput cc4;
 
 layout (location = 0) in vec2 uv;
 layout (location = 0) out vec4 color;
 
 void main() 
 {
-    vec4 colCc1 = texture(cc1,uv);
-    vec4 colCc2 = texture(cc2,uv);
-    float colCc3 = texture(cc3,uv).r;
-    float colCc4 = texture(cc4,uv).r;
+    vec4 colCc1 = subpassLoad(cc1);
+    vec4 colCc2 = subpassLoad(cc2);
+    float colCc3 = subpassLoad(cc3).r;
+    float colCc4 = subpassLoad(cc4).r;
     color = vec4(colCc1+colCc2)+vec4(0,0,colCc3,colCc4);
 }
@@ -0,0 +1,12 @@
+#version 450
+
+layout(location = 0) in vec3 fragNormal;
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+    vec3 toLight = normalize(vec3(0.3, 1, 0.5));
+    float diffuse = max(dot(normalize(fragNormal), toLight), 0);
+    color = vec4(vec3(0.1 + 0.8 * diffuse), 1);
+}
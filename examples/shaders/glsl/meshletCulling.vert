@@ -0,0 +1,18 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform Culling {
+    mat4 modelViewProjection;
+    vec3 cameraPosition;
+    uint meshletCount;
+};
+
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec3 normal;
+
+layout(location = 0) out vec3 fragNormal;
+
+void main()
+{
+    gl_Position = modelViewProjection * vec4(position, 1);
+    fragNormal = normal;
+}
@@ -28,12 +28,26 @@
 namespace tga
 {
 
+/** \brief Identifies an asynchronous readback, see Interface::readback
+ */
+struct ReadbackTicket {
+    uint64_t id{0};
+
+    explicit operator bool() const { return id != 0; }
+    bool operator==(ReadbackTicket const&) const = default;
+};
+
+/** \brief Receives the data of a completed readback, the data is only valid for the duration of the call
+ */
+using ReadbackCallback = std::function<void(void const *data, size_t size)>;
+
 /** \brief The abstract Interface to the Trainings Graphics API
  *
  */
 class Interface {
 public:
     Interface();
+    explicit Interface(InterfaceInfo const&);
     ~Interface();
     // Resource Creation
     Shader createShader(ShaderInfo const&);
@@ -50,11 +64,99 @@ public:
     ext::BottomLevelAccelerationStructure createBottomLevelAccelerationStructure(
         ext::BottomLevelAccelerationStructureInfo const&);
 
+    /** \brief Builds many bottom level acceleration structures with a single submission.
+     * All builds share one scratch buffer, builds that don't fit into the scratch budget at once are split into
+     * consecutive batches of the same CommandBuffer.
+     * \param waitForBuild If false, the call returns right after submitting the builds. The structures can be used by
+     * all CommandBuffers executed afterwards, the scratch memory is released once the builds completed.
+     * Compaction requires the compacted sizes of the builds, so the call always waits if any info allows compaction.
+     * \return Handles in the order of the infos
+     */
+    std::vector<ext::BottomLevelAccelerationStructure> createBottomLevelAccelerationStructures(
+        std::vector<ext::BottomLevelAccelerationStructureInfo> const&, bool waitForBuild = true);
+
+    /** \brief Device address of a bottom level acceleration structure.
+     * \return Value for AccelerationStructureInstance::accelerationStructureReference
+     */
+    uint64_t getDeviceAddress(ext::BottomLevelAccelerationStructure);
+
+    /** \brief Serializes a bottom level acceleration structure, e.g. to cache it on disk next to its mesh.
+     * The data is only valid for the driver and device it was created with, see canDeserialize.
+     */
+    std::vector<uint8_t> serialize(ext::BottomLevelAccelerationStructure);
+    /** \brief Whether the data of serialize can be used with the driver and device of this Interface.
+     * Caches from a different driver version are rejected and have to be rebuilt.
+     */
+    bool canDeserialize(std::vector<uint8_t> const& data);
+    /** \brief Recreates a bottom level acceleration structure from the data of serialize, without rebuilding it.
+     * Throws if canDeserialize(data) is false.
+     */
+    ext::BottomLevelAccelerationStructure deserialize(std::vector<uint8_t> const& data);
+
     void execute(CommandBuffer);
     void waitForCompletion(CommandBuffer);
 
     void *getMapping(StagingBuffer);
 
+    // Asynchronous readback
+
+    /** \brief Copies a range of a Buffer to host memory without waiting for the copy to finish.
+     * The copy is submitted immediately and sees the results of all CommandBuffers executed before the call.
+     * \param callback (optional) Called by pollReadbacks once the data arrived, the ticket is freed afterwards
+     * \return Ticket to query the state and data of the readback
+     */
+    ReadbackTicket readback(Buffer src, size_t size, size_t srcOffset = 0, ReadbackCallback callback = {});
+
+    /** \brief Copies all layers of a mip level of a Texture to host memory without waiting for the copy to finish.
+     * Like textureDownload the data is tightly packed, see formatImageSize.
+     */
+    ReadbackTicket readback(Texture src, uint32_t mipLevel = 0, ReadbackCallback callback = {});
+
+    /** \brief True if the data of a readback arrived. Never blocks.
+     */
+    bool readbackReady(ReadbackTicket);
+
+    /** \brief Data of a finished readback, valid until the ticket is freed. Throws if the readback is not ready.
+     */
+    void const *getReadbackData(ReadbackTicket);
+
+    /** \brief Invokes the callbacks of all finished readbacks and frees their tickets. Never blocks.
+     * Also called by nextFrame.
+     * \return Number of callbacks invoked
+     */
+    uint32_t pollReadbacks();
+
+    /** \brief Replaces Bindings of an InputSet without recreating it.
+     * Only the listed slots and array elements are written, all other Bindings keep their resources.
+     * The InputSet must not be in use by a CommandBuffer that is still executing.
+     */
+    void updateInputSet(InputSet inputSet, std::vector<Binding> const& bindings);
+
+    // Bindless resources
+
+    /** \brief Adds a Texture to the bindless table of the Interface.
+     * The Texture is visible to all passes created with bindlessTable enabled until it is unregistered or freed.
+     * \return Stable index of the Texture into the sampled and storage image arrays of the table
+     */
+    uint32_t registerBindless(Texture texture);
+
+    /** \brief Adds a Buffer to the bindless table of the Interface.
+     * \return Stable index of the Buffer into the storage buffer array of the table
+     */
+    uint32_t registerBindless(Buffer buffer);
+
+    /** \brief Removes a Texture from the bindless table, its index may be handed out again.
+     * The table keeps the stale descriptor, shaders must not access the index until registerBindless hands it out
+     * again. Freeing the Texture unregisters it as well.
+     */
+    void unregisterBindless(Texture texture);
+
+    /** \brief Removes a Buffer from the bindless table, its index may be handed out again.
+     * The table keeps the stale descriptor, shaders must not access the index until registerBindless hands it out
+     * again. Freeing the Buffer unregisters it as well.
+     */
+    void unregisterBindless(Buffer buffer);
+
     // Window functions
 
     /** \brief Number of framebuffers used by a window.
@@ -109,6 +211,7 @@ public:
     void free(RenderPass);
     void free(ComputePass);
     void free(CommandBuffer);
+    void free(ReadbackTicket);
     void free(ext::TopLevelAccelerationStructure);
     void free(ext::BottomLevelAccelerationStructure);
 
@@ -117,10 +220,13 @@ private:
     CommandBuffer beginCommandBuffer(CommandBuffer cmdBuffer);
     void setRenderPass(CommandBuffer, RenderPass, uint32_t framebufferIndex,
                        std::array<float, 4> const& colorClearValue, float depthClearValue);
+    void nextSubpass(CommandBuffer);
     void setComputePass(CommandBuffer, ComputePass);
     void bindVertexBuffer(CommandBuffer, Buffer);
     void bindIndexBuffer(CommandBuffer, Buffer);
     void bindInputSet(CommandBuffer, InputSet);
+    void bindTransientInputSet(CommandBuffer, InputSetInfo const&);
+    void pushBindings(CommandBuffer, uint32_t setIndex, std::vector<Binding> const& bindings);
     void draw(CommandBuffer, uint32_t vertexCount, uint32_t firstVertex, uint32_t instanceCount,
               uint32_t firstInstance);
     void drawIndexed(CommandBuffer, uint32_t indexCount, uint32_t firstIndex, uint32_t vertexOffset,
@@ -128,13 +234,26 @@ private:
     void drawIndirect(CommandBuffer, Buffer indirectDrawBuffer, uint32_t drawCount, size_t offset, uint32_t stride);
     void drawIndexedIndirect(CommandBuffer, Buffer indirectDrawBuffer, uint32_t drawCount, size_t offset,
                              uint32_t stride);
+    void setCullMode(CommandBuffer, CullMode);
+    void setFrontFace(CommandBuffer, FrontFace);
+    void setPrimitiveTopology(CommandBuffer, PrimitiveTopology);
+    void setDepthTestEnabled(CommandBuffer, bool);
+    void setDepthWriteEnabled(CommandBuffer, bool);
+    void setDepthCompareOp(CommandBuffer, CompareOperation);
     void barrier(CommandBuffer, PipelineStage srcStage, PipelineStage dstStage);
     void dispatch(CommandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
 
     void inlineBufferUpdate(CommandBuffer, Buffer dst, void const *srcData, uint16_t dataSize, size_t dstOffset);
     void bufferUpload(CommandBuffer, StagingBuffer src, Buffer dst, size_t size, size_t srcOffset, size_t dstOffset);
     void bufferDownload(CommandBuffer, Buffer src, StagingBuffer dst, size_t size, size_t srcOffset, size_t dstOffset);
-    void textureDownload(CommandBuffer, Texture src, StagingBuffer dst, size_t dstOffset);
+    void textureDownload(CommandBuffer, Texture src, StagingBuffer dst, size_t dstOffset, uint32_t mipLevel);
+    void textureUpload(CommandBuffer, StagingBuffer src, Texture dst, std::vector<TextureRegion> const& regions);
+    void textureDownload(CommandBuffer, Texture src, StagingBuffer dst, std::vector<TextureRegion> const& regions);
+    void generateMipmaps(CommandBuffer, Texture);
+    void updateTopLevelAccelerationStructure(CommandBuffer, ext::TopLevelAccelerationStructure,
+                                             std::vector<ext::AccelerationStructureInstanceInfo> const&);
+    void updateTopLevelAccelerationStructure(CommandBuffer, ext::TopLevelAccelerationStructure, Buffer instanceBuffer,
+                                             size_t instanceBufferOffset);
     void endCommandBuffer(CommandBuffer);
 
 private:
@@ -158,6 +277,14 @@ public:
         tgai.setRenderPass(cmdBuffer, renderPass, framebufferIndex, colorClearValue, depthClearValue);
         return *this;
     }
+    /** \brief Advances to the next subpass of the current RenderPass and binds its pipeline.
+     * InputSets of the previous subpass have to be bound again for the next one.
+     */
+    CommandRecorder& nextSubpass()
+    {
+        tgai.nextSubpass(cmdBuffer);
+        return *this;
+    }
     CommandRecorder& bindVertexBuffer(Buffer buffer)
     {
         tgai.bindVertexBuffer(cmdBuffer, buffer);
@@ -173,6 +300,23 @@ public:
         tgai.bindInputSet(cmdBuffer, inputSet);
         return *this;
     }
+    /** \brief Creates and binds an InputSet that is only valid for this recording.
+     * The InputSet is recycled in bulk when the CommandBuffer is recorded again or freed, which makes it cheap to
+     * use for bindings that change every frame.
+     */
+    CommandRecorder& bindTransientInputSet(InputSetInfo const& inputSetInfo)
+    {
+        tgai.bindTransientInputSet(cmdBuffer, inputSetInfo);
+        return *this;
+    }
+    /** \brief Provides the Bindings of a push-only set of the current RenderPass or ComputePass.
+     * \param setIndex Index of a SetLayout with pushOnly enabled in the inputLayout of the pass
+     */
+    CommandRecorder& pushBindings(uint32_t setIndex, std::vector<Binding> const& bindings)
+    {
+        tgai.pushBindings(cmdBuffer, setIndex, bindings);
+        return *this;
+    }
     CommandRecorder& draw(uint32_t vertexCount, uint32_t firstVertex, uint32_t instanceCount = 1,
                           uint32_t firstInstance = 0)
     {
@@ -198,6 +342,38 @@ public:
         return *this;
     }
 
+    // Dynamic state, only valid for RenderPasses that declared the state in RenderPassInfo::dynamicStates
+    CommandRecorder& setCullMode(CullMode cullMode)
+    {
+        tgai.setCullMode(cmdBuffer, cullMode);
+        return *this;
+    }
+    CommandRecorder& setFrontFace(FrontFace frontFace)
+    {
+        tgai.setFrontFace(cmdBuffer, frontFace);
+        return *this;
+    }
+    CommandRecorder& setPrimitiveTopology(PrimitiveTopology primitiveTopology)
+    {
+        tgai.setPrimitiveTopology(cmdBuffer, primitiveTopology);
+        return *this;
+    }
+    CommandRecorder& setDepthTestEnabled(bool enabled)
+    {
+        tgai.setDepthTestEnabled(cmdBuffer, enabled);
+        return *this;
+    }
+    CommandRecorder& setDepthWriteEnabled(bool enabled)
+    {
+        tgai.setDepthWriteEnabled(cmdBuffer, enabled);
+        return *this;
+    }
+    CommandRecorder& setDepthCompareOp(CompareOperation compareOperation)
+    {
+        tgai.setDepthCompareOp(cmdBuffer, compareOperation);
+        return *this;
+    }
+
     CommandRecorder& setComputePass(ComputePass computePass)
     {
         tgai.setComputePass(cmdBuffer, computePass);
@@ -234,9 +410,56 @@ public:
         return *this;
     }
 
-    CommandRecorder& textureDownload(Texture src, StagingBuffer dst, size_t dstOffset = 0)
+    /** \brief Copies all layers of a mip level of a Texture into a StagingBuffer.
+     * Ends the current RenderPass, draws after it need another setRenderPass.
+     */
+    CommandRecorder& textureDownload(Texture src, StagingBuffer dst, size_t dstOffset = 0, uint32_t mipLevel = 0)
+    {
+        tgai.textureDownload(cmdBuffer, src, dst, dstOffset, mipLevel);
+        return *this;
+    }
+    /** \brief Copies parts of a StagingBuffer into a Texture, all regions are transferred with a single copy.
+     * Ends the current RenderPass, draws after it need another setRenderPass.
+     */
+    CommandRecorder& textureUpload(StagingBuffer src, Texture dst,
+                                   std::vector<TextureRegion> const& regions = {TextureRegion{}})
+    {
+        tgai.textureUpload(cmdBuffer, src, dst, regions);
+        return *this;
+    }
+    /** \brief Copies parts of a Texture into a StagingBuffer, all regions are transferred with a single copy.
+     * Ends the current RenderPass, draws after it need another setRenderPass.
+     */
+    CommandRecorder& textureDownload(Texture src, StagingBuffer dst, std::vector<TextureRegion> const& regions)
+    {
+        tgai.textureDownload(cmdBuffer, src, dst, regions);
+        return *this;
+    }
+    /** \brief Regenerates all mip levels of a Texture from its first level, e.g. after rendering into it.
+     * Ends the current RenderPass, draws after it need another setRenderPass.
+     */
+    CommandRecorder& generateMipmaps(Texture texture)
+    {
+        tgai.generateMipmaps(cmdBuffer, texture);
+        return *this;
+    }
+    /** \brief Refits a top level acceleration structure created with allowUpdate to new instance data.
+     * The number of instances must not change. The instances are stored in the CommandBuffer, so it can be executed
+     * repeatedly. Ends the current RenderPass.
+     */
+    CommandRecorder& updateTopLevelAccelerationStructure(
+        ext::TopLevelAccelerationStructure tlas, std::vector<ext::AccelerationStructureInstanceInfo> const& instances)
+    {
+        tgai.updateTopLevelAccelerationStructure(cmdBuffer, tlas, instances);
+        return *this;
+    }
+    /** \brief Refits a top level acceleration structure created with allowUpdate to the AccelerationStructureInstance
+     * records in a Buffer, e.g. written by a ComputePass earlier in the CommandBuffer.
+     */
+    CommandRecorder& updateTopLevelAccelerationStructure(ext::TopLevelAccelerationStructure tlas,
+                                                         Buffer instanceBuffer, size_t instanceBufferOffset = 0)
     {
-        tgai.textureDownload(cmdBuffer, src, dst, dstOffset);
+        tgai.updateTopLevelAccelerationStructure(cmdBuffer, tlas, instanceBuffer, instanceBufferOffset);
         return *this;
     }
 
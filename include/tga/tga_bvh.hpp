@@ -0,0 +1,171 @@
+#pragma once
+#include <array>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "tga/tga.hpp"
+#include "tga/tga_math.hpp"
+
+// CPU counterpart of the ext:: acceleration structures, e.g. for picking, occlusion queries and offline baking on
+// machines without ray tracing support. Follows the ray tracing conventions of the GPU: closest hits report the
+// barycentrics of the hit as in hitAttributeEXT, instances are skipped if instance mask & ray cullMask == 0.
+namespace tga
+{
+namespace cpu
+{
+    struct Ray {
+        glm::vec3 origin;
+        float tMin{0.f};
+        glm::vec3 direction; /**<Does not have to be normalized, t is measured in multiples of it*/
+        float tMax{std::numeric_limits<float>::infinity()};
+        uint8_t cullMask{0xFF};
+    };
+
+    struct Hit {
+        static constexpr uint32_t none = ~0u;
+        float t{std::numeric_limits<float>::infinity()};
+        glm::vec2 barycentrics{0.f}; /**<Weights of the second and third vertex of the triangle*/
+        uint32_t primitiveIndex{none};      /**<Same as gl_PrimitiveID*/
+        uint32_t geometryIndex{none};       /**<Same as gl_GeometryIndexEXT*/
+        uint32_t instanceIndex{none};       /**<Same as gl_InstanceID*/
+        uint32_t instanceCustomIndex{none}; /**<Same as gl_InstanceCustomIndexEXT*/
+        explicit operator bool() const { return instanceIndex != none; }
+    };
+
+    // Rays and hits of a packet are stored as structure of arrays, the tests loop over the lanes of each attribute
+    constexpr uint32_t packetSize = 8;
+    using PacketFloat = std::array<float, packetSize>;
+    using PacketIndex = std::array<uint32_t, packetSize>;
+
+    struct RayPacket {
+        PacketFloat originX{}, originY{}, originZ{};
+        PacketFloat directionX{}, directionY{}, directionZ{};
+        PacketFloat tMin{}, tMax{};
+        uint8_t cullMask{0xFF}; /**<Shared by all rays of the packet*/
+        uint32_t activeLanes{(1u << packetSize) - 1}; /**<Bit i set if lane i holds a ray*/
+        void setRay(uint32_t lane, Ray const& ray);
+    };
+
+    struct HitPacket {
+        PacketFloat t, u, v;
+        PacketIndex primitiveIndex, geometryIndex, instanceIndex, instanceCustomIndex;
+        Hit getHit(uint32_t lane) const;
+    };
+
+    // Host side counterpart of ext::TriangleGeometry
+    struct TriangleGeometry {
+        void const *vertexData;      /**<Vertex data, positions are read like the vertex buffer of a BLAS*/
+        size_t vertexStride;         /**<Distance between vertex positions in bytes*/
+        Format vertexPositionFormat; /**<r32g32b32_sfloat, r32g32b32a32_sfloat or r32g32_sfloat*/
+        uint32_t const *indexData;   /**<Index data, 3 indices per triangle*/
+        uint32_t indexCount;         /**<Same as indexCount of indexed draw*/
+        uint32_t firstIndex;         /**<Same as firstIndex of indexed draw*/
+        uint32_t vertexOffset;       /**<Same as vertexOffset of indexed draw*/
+        std::optional<ext::TransformMatrix> transform; /**<(optional) Applied to the vertex positions*/
+
+        TriangleGeometry(void const *_vertexData = nullptr, size_t _vertexStride = 0,
+                         uint32_t const *_indexData = nullptr, uint32_t _indexCount = 0,
+                         Format _vertexPositionFormat = Format::r32g32b32_sfloat)
+            : vertexData(_vertexData), vertexStride(_vertexStride), vertexPositionFormat(_vertexPositionFormat),
+              indexData(_indexData), indexCount(_indexCount), firstIndex(0), vertexOffset(0)
+        {}
+        TGA_SETTER(setVertexData, void const *, vertexData)
+        TGA_SETTER(setVertexStride, size_t, vertexStride)
+        TGA_SETTER(setVertexPositionFormat, Format, vertexPositionFormat)
+        TGA_SETTER(setIndexData, uint32_t const *, indexData)
+        TGA_SETTER(setIndexCount, uint32_t, indexCount)
+        TGA_SETTER(setFirstIndex, uint32_t, firstIndex)
+        TGA_SETTER(setVertexOffset, uint32_t, vertexOffset)
+        TGA_SETTER(setTransform, std::optional<ext::TransformMatrix> const&, transform)
+    };
+
+    // Host copy of the contents of a Buffer that is referenced by an ext:: info
+    using BufferData = std::function<void const *(Buffer)>;
+
+    namespace detail
+    {
+        struct Node {
+            glm::vec3 boundsMin;
+            uint32_t leftOrFirst; /**<Index of the left child, the right child follows it. First primitive of a leaf*/
+            glm::vec3 boundsMax;
+            uint32_t count; /**<Number of primitives of a leaf, 0 for inner nodes*/
+        };
+
+        struct Bounds {
+            glm::vec3 min{std::numeric_limits<float>::max()};
+            glm::vec3 max{-std::numeric_limits<float>::max()};
+        };
+
+        // Binned SAH build over the bounds of the primitives, large subtrees are built in parallel.
+        // Returns the nodes, order receives the primitive index for each leaf slot
+        std::vector<Node> buildBVH(std::vector<Bounds> const& primitiveBounds, std::vector<uint32_t>& order);
+    }  // namespace detail
+
+    class BottomLevelBVH {
+    public:
+        explicit BottomLevelBVH(std::vector<TriangleGeometry> const& geometries);
+        /** Builds from the same info as Interface::createBottomLevelAccelerationStructure.
+         * bufferData provides host copies of the vertex and index Buffers of the info
+         */
+        BottomLevelBVH(ext::BottomLevelAccelerationStructureInfo const& info, BufferData const& bufferData);
+
+        // Closest hit with t < hit.t, instance fields of the hit are left untouched
+        bool intersect(Ray const& ray, Hit& hit) const;
+        bool occluded(Ray const& ray) const;
+        // Closest hits of the lanes in activeLanes, returns the lanes that found a closer hit
+        uint32_t intersect(RayPacket const& packet, HitPacket& hits, uint32_t activeLanes) const;
+        uint32_t occluded(RayPacket const& packet, uint32_t activeLanes) const;
+
+        detail::Bounds bounds() const;
+        size_t triangleCount() const { return triangles.size(); }
+        size_t nodeCount() const { return nodes.size(); }
+
+    private:
+        struct Triangle {
+            glm::vec3 v0, edge1, edge2;
+            uint32_t primitiveIndex, geometryIndex;
+        };
+        std::vector<detail::Node> nodes;
+        std::vector<Triangle> triangles;
+    };
+
+    // Host side counterpart of ext::AccelerationStructureInstanceInfo
+    struct Instance {
+        BottomLevelBVH const *blas;
+        ext::TransformMatrix transform;
+        uint32_t customIndex{0};
+        uint8_t mask{0xFF};
+    };
+
+    class TopLevelBVH {
+    public:
+        explicit TopLevelBVH(std::vector<Instance> const& instances);
+        /** Builds from the same info as Interface::createTopLevelAccelerationStructure.
+         * blasOf maps the bottom level acceleration structures of the instances to their CPU counterparts.
+         * Instances from an instanceBuffer only exist on the GPU and are not supported
+         */
+        TopLevelBVH(ext::TopLevelAccelerationStructureInfo const& info,
+                    std::function<BottomLevelBVH const&(ext::BottomLevelAccelerationStructure)> const& blasOf);
+
+        Hit intersect(Ray const& ray) const;
+        bool occluded(Ray const& ray) const;
+        HitPacket intersect(RayPacket const& packet) const;
+        // Bit i is set if the ray of lane i hit anything
+        uint32_t occluded(RayPacket const& packet) const;
+
+        size_t nodeCount() const { return nodes.size(); }
+
+    private:
+        struct InstanceData {
+            BottomLevelBVH const *blas;
+            glm::mat4 worldToObject;
+            uint32_t instanceIndex, customIndex;
+            uint8_t mask;
+        };
+        std::vector<detail::Node> nodes;
+        std::vector<InstanceData> instances;
+    };
+}  // namespace cpu
+}  // namespace tga
@@ -3,6 +3,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <initializer_list>
 #include <optional>
 #include <variant>
 #include <vector>
@@ -21,6 +22,20 @@ namespace tga
         return *this;                    \
     }
 
+/* Interface
+ */
+struct InterfaceInfo {
+    bool headless;   /**<Create the Interface without window system integration. No GLFW is initialized and no
+                        surface or swapchain extensions are requested, Windows can't be created in this mode*/
+    bool validation; /**<Enable the Khronos validation layer and debug messenger, if they are installed*/
+
+    InterfaceInfo(bool _headless = false, bool _validation = true) : headless(_headless), validation(_validation) {}
+
+    // chaining setters for "Info().setX(x).setY(y)" pattern
+    TGA_SETTER(setHeadless, bool, headless)
+    TGA_SETTER(setValidation, bool, validation)
+};
+
 /* Shader
  */
 
@@ -104,6 +119,8 @@ enum class AddressMode { clampBorder, clampEdge, repeat, repeatMirror };
 enum class TextureType { _2D, _2DArray, _3D, _Cube };
 
 struct TextureInfo {
+    static constexpr uint32_t autoMipLevels = 0; /**<Use as mipLevels for a full mip chain down to 1x1*/
+
     uint32_t width;          /**<Width of the Texture in pixels*/
     uint32_t height;         /**<Height of the Texture in pixels*/
     Format format;           /**<Format of the pixels. Example: For 8 bit per Pixel with red, green and blue channel use
@@ -118,12 +135,19 @@ struct TextureInfo {
     StagingBuffer
         srcData; /**<(optional) Data of the Texture. Pass a TGA_NULL_HANDLE to create a texture with undefined content*/
     size_t srcDataOffset; /**<Offset from the start of the staging buffer*/
+    uint32_t mipLevels;   /**<(optional) Number of mip levels, autoMipLevels for a full chain. The levels below the
+                             first are generated from srcData, or with CommandRecorder::generateMipmaps*/
+    bool srcDataMipChain{false}; /**<(optional) srcData contains all mip levels, tightly packed starting with the
+                                    largest, instead of only the first. Required for block-compressed formats with
+                                    more than one mip level*/
 
     TextureInfo(uint32_t _width, uint32_t _height, Format _format, SamplerMode _samplerMode = SamplerMode::nearest,
                 AddressMode _repeateMode = AddressMode::clampBorder, TextureType _textureType = TextureType::_2D,
-                uint32_t _depthLayers = 1, StagingBuffer _srcData = {}, size_t _srcDataOffset = 0)
+                uint32_t _depthLayers = 1, StagingBuffer _srcData = {}, size_t _srcDataOffset = 0,
+                uint32_t _mipLevels = 1)
         : width(_width), height(_height), format(_format), samplerMode(_samplerMode), addressMode(_repeateMode),
-          textureType(_textureType), depthLayers(_depthLayers), srcData(_srcData), srcDataOffset(_srcDataOffset)
+          textureType(_textureType), depthLayers(_depthLayers), srcData(_srcData), srcDataOffset(_srcDataOffset),
+          mipLevels(_mipLevels)
     {}
 
     // chaining setters for "Info().setX(x).setY(y)" pattern
@@ -136,6 +160,45 @@ struct TextureInfo {
     TGA_SETTER(setDepthLayers, uint32_t, depthLayers)
     TGA_SETTER(setSrcData, StagingBuffer, srcData)
     TGA_SETTER(setSrcDataOffset, size_t, srcDataOffset)
+    TGA_SETTER(setMipLevels, uint32_t, mipLevels)
+    TGA_SETTER(setSrcDataMipChain, bool, srcDataMipChain)
+};
+
+/** Part of a Texture that is transferred by CommandRecorder::textureUpload or textureDownload
+ */
+struct TextureRegion {
+    size_t bufferOffset; /**<Offset into the StagingBuffer. The texels of the region are tightly packed, layer after
+                            layer, see formatImageSize*/
+    uint32_t mipLevel;   /**<Mip level of the region, the offset and extent are in texels of this level*/
+    uint32_t baseLayer;  /**<First array layer or cube face*/
+    uint32_t layerCount; /**<Number of array layers or cube faces*/
+    uint32_t x{0}, y{0}, z{0};              /**<Offset of the region*/
+    uint32_t width{0}, height{0}, depth{0}; /**<(optional) Extent of the region, 0 for the rest of the level*/
+
+    TextureRegion(size_t _bufferOffset = 0, uint32_t _mipLevel = 0, uint32_t _baseLayer = 0, uint32_t _layerCount = 1)
+        : bufferOffset(_bufferOffset), mipLevel(_mipLevel), baseLayer(_baseLayer), layerCount(_layerCount)
+    {}
+
+    // chaining setters for "Info().setX(x).setY(y)" pattern
+    TGA_SETTER(setBufferOffset, size_t, bufferOffset)
+    TGA_SETTER(setMipLevel, uint32_t, mipLevel)
+    TGA_SETTER(setBaseLayer, uint32_t, baseLayer)
+    TGA_SETTER(setLayerCount, uint32_t, layerCount)
+
+    auto& setOffset(uint32_t _x, uint32_t _y, uint32_t _z = 0)
+    {
+        x = _x;
+        y = _y;
+        z = _z;
+        return *this;
+    }
+    auto& setExtent(uint32_t _width, uint32_t _height, uint32_t _depth = 1)
+    {
+        width = _width;
+        height = _height;
+        depth = _depth;
+        return *this;
+    }
 };
 
 /* Window
@@ -221,7 +284,15 @@ struct PerPixelOperations {
 };
 
 // General Shader Input
-enum class BindingType { uniformBuffer, sampler, storageBuffer, storageImage, accelerationStructure };
+enum class BindingType {
+    uniformBuffer,
+    sampler,
+    storageBuffer,
+    storageImage,
+    accelerationStructure,
+    inputAttachment /**<Attachment of the current RenderPass written by an earlier subpass, read with subpassLoad.
+                       Only visible to the fragment shader*/
+};
 
 struct BindingLayout {
     BindingType type;
@@ -232,12 +303,20 @@ struct BindingLayout {
     TGA_SETTER(setCount, uint32_t, count)
 };
 
-using SetLayout = std::vector<BindingLayout>;
-// struct SetLayout {
-//     std::vector<BindingLayout> bindingLayouts;
-//     SetLayout(const std::vector<BindingLayout>& _bindingLayouts = {}) : bindingLayouts(_bindingLayouts) {}
-//     SetLayout(std::initializer_list<BindingLayout> _bindingLayouts) : bindingLayouts(_bindingLayouts){};
-// };
+struct SetLayout {
+    std::vector<BindingLayout> bindingLayouts; /**<The index of a BindingLayout is its slot in the shader*/
+    bool pushOnly{false}; /**<(optional) Bindings of this set are only provided with CommandRecorder::pushBindings.
+                             No InputSets can be created for it*/
+
+    SetLayout(std::vector<BindingLayout> const& _bindingLayouts = {}, bool _pushOnly = false)
+        : bindingLayouts(_bindingLayouts), pushOnly(_pushOnly)
+    {}
+    SetLayout(std::initializer_list<BindingLayout> _bindingLayouts) : bindingLayouts(_bindingLayouts) {}
+
+    // chaining setters for "Info().setX(x).setY(y)" pattern
+    TGA_SETTER(setBindingLayouts, std::vector<BindingLayout> const&, bindingLayouts)
+    TGA_SETTER(setPushOnly, bool, pushOnly)
+};
 
 using InputLayout = std::vector<SetLayout>;
 // struct InputLayout {
@@ -270,6 +349,97 @@ struct VertexLayout {
 
 enum class ClearOperation { none, color, depth, all };
 
+enum class DepthFormat {
+    none, /**<The RenderPass has no depth attachment*/
+    d16,
+    d24s8, /**<Falls back to a 32 bit float depth with 8 bit stencil format if not supported*/
+    d32
+};
+
+enum class LoadOperation {
+    clearOperations, /**<Clear or load as determined by RenderPassInfo::clearOperations*/
+    load,
+    clear,
+    dontCare /**<Previous contents are undefined*/
+};
+
+enum class StoreOperation {
+    store,
+    dontCare /**<Contents are discarded at the end of the RenderPass*/
+};
+
+struct DepthConfig {
+    using DepthTarget = std::variant<std::monostate, Texture, Window>;
+    DepthFormat format{DepthFormat::d32};
+    LoadOperation loadOp{LoadOperation::clearOperations};
+    StoreOperation storeOp{StoreOperation::store};
+    DepthTarget sharedWith{}; /**<(optional) Use the depth buffer of this Texture or Window instead of the one of the
+                                 renderTarget. Both must have the same size*/
+
+    DepthConfig(DepthFormat _format = DepthFormat::d32, LoadOperation _loadOp = LoadOperation::clearOperations,
+                StoreOperation _storeOp = StoreOperation::store, DepthTarget const& _sharedWith = {})
+        : format(_format), loadOp(_loadOp), storeOp(_storeOp), sharedWith(_sharedWith)
+    {}
+    // chaining setters for "Info().setX(x).setY(y)" pattern
+    TGA_SETTER(setFormat, DepthFormat, format)
+    TGA_SETTER(setLoadOp, LoadOperation, loadOp)
+    TGA_SETTER(setStoreOp, StoreOperation, storeOp)
+    TGA_SETTER(setSharedWith, Texture, sharedWith)
+    TGA_SETTER(setSharedWith, Window, sharedWith)
+};
+
+enum class PrimitiveTopology { triangleList, triangleStrip, triangleFan, lineList, lineStrip, pointList };
+
+// Pipeline state that is set while recording instead of being baked into the RenderPass
+enum class DynamicState : uint32_t {
+    none = 0u,
+    cullMode = 1u << 0u,
+    frontFace = 1u << 1u,
+    primitiveTopology = 1u << 2u,
+    depthTest = 1u << 3u,
+    depthWrite = 1u << 4u,
+    depthCompareOp = 1u << 5u
+};
+inline DynamicState operator|(DynamicState a, DynamicState b)
+{
+    return static_cast<DynamicState>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+}
+inline bool operator&(DynamicState a, DynamicState b)
+{
+    return bool(static_cast<uint32_t>(a) & static_cast<uint32_t>(b));
+}
+
+// A single subpass of a RenderPass with several subpasses
+struct SubpassInfo {
+    Shader vertexShader;   /**<The vertex shader executed in this subpass*/
+    Shader fragmentShader; /**<The fragment shader executed in this subpass*/
+    std::vector<uint32_t> colorAttachments; /**<Attachments written by the fragment shader, in the order of its outputs.
+                                               Attachments are numbered like the framebuffer: first the renderTarget,
+                                               then RenderPassInfo::subpassAttachments*/
+    std::vector<uint32_t> inputAttachments; /**<Attachments written by earlier subpasses that are read in this one.
+                                               Bound with BindingType::inputAttachment*/
+    VertexLayout vertexLayout{}; /**<Describes the format of the vertices in the vertex buffer*/
+    InputLayout inputLayout{};   /**<Describes how the Bindings of this subpass are organized*/
+    bool depthAttachment{true};  /**<Whether this subpass uses the depth buffer of the RenderPass*/
+
+    SubpassInfo(Shader _vertexShader, Shader _fragmentShader, std::vector<uint32_t> const& _colorAttachments = {},
+                std::vector<uint32_t> const& _inputAttachments = {}, VertexLayout const& _vertexLayout = {},
+                InputLayout const& _inputLayout = {}, bool _depthAttachment = true)
+        : vertexShader(_vertexShader), fragmentShader(_fragmentShader), colorAttachments(_colorAttachments),
+          inputAttachments(_inputAttachments), vertexLayout(_vertexLayout), inputLayout(_inputLayout),
+          depthAttachment(_depthAttachment)
+    {}
+
+    // chaining setters for "Info().setX(x).setY(y)" pattern
+    TGA_SETTER(setVertexShader, Shader, vertexShader)
+    TGA_SETTER(setFragmentShader, Shader, fragmentShader)
+    TGA_SETTER(setColorAttachments, std::vector<uint32_t> const&, colorAttachments)
+    TGA_SETTER(setInputAttachments, std::vector<uint32_t> const&, inputAttachments)
+    TGA_SETTER(setVertexLayout, VertexLayout const&, vertexLayout)
+    TGA_SETTER(setInputLayout, InputLayout const&, inputLayout)
+    TGA_SETTER(setDepthAttachment, bool, depthAttachment)
+};
+
 struct RenderPassInfo {
     Shader vertexShader;   /**<The vertex shader executed by this RenderPass*/
     Shader fragmentShader; /**<The fragment shader executed by this RenderPass*/
@@ -287,6 +457,22 @@ struct RenderPassInfo {
                                                           depth-buffer and blending*/
     RasterizerConfig rasterizerConfig{};                  /**<Describes the configuration the Rasterizer, i.e
                                                                culling and polygon draw mode*/
+    PrimitiveTopology primitiveTopology{PrimitiveTopology::triangleList}; /**<How vertices are assembled into
+                                                                             primitives*/
+    DynamicState dynamicStates{DynamicState::none}; /**<(optional) State that is set with the CommandRecorder instead.
+                                                       The values above are used until they are overridden. Requires
+                                                       support for extended dynamic state*/
+    bool bindlessTable{false}; /**<(optional) Makes the bindless table available to the shaders as the set following
+                                  the last set of the inputLayout. Requires support for descriptor indexing*/
+    DepthConfig depthConfig{}; /**<(optional) Format and load/store behaviour of the depth buffer*/
+    std::vector<SubpassInfo> subpasses; /**<(optional) Subpasses executed in order, advanced with
+                                           CommandRecorder::nextSubpass. If set, they replace the single subpass
+                                           described by the shaders and layouts above*/
+    std::vector<Texture> subpassAttachments; /**<(optional) Attachments in addition to the renderTarget, e.g. a G-buffer
+                                                that is written and read within the RenderPass. Same size as the
+                                                renderTarget*/
+    StoreOperation subpassAttachmentStoreOp{StoreOperation::store}; /**<(optional) dontCare skips writing the
+                                                                       subpassAttachments back to memory*/
 
     RenderPassInfo(Shader _vertexShader, Shader _fragmentShader, RenderTarget const& _renderTarget = {},
                    VertexLayout const& _vertexLayout = {}, InputLayout const& _inputLayout = {},
@@ -308,12 +494,21 @@ struct RenderPassInfo {
     TGA_SETTER(setClearOperations, ClearOperation, clearOperations)
     TGA_SETTER(setPerPixelOperations, PerPixelOperations, perPixelOperations)
     TGA_SETTER(setRasterizerConfig, RasterizerConfig, rasterizerConfig)
+    TGA_SETTER(setPrimitiveTopology, PrimitiveTopology, primitiveTopology)
+    TGA_SETTER(setDynamicStates, DynamicState, dynamicStates)
+    TGA_SETTER(setBindlessTable, bool, bindlessTable)
+    TGA_SETTER(setDepthConfig, DepthConfig const&, depthConfig)
+    TGA_SETTER(setSubpasses, std::vector<SubpassInfo> const&, subpasses)
+    TGA_SETTER(setSubpassAttachments, std::vector<Texture> const&, subpassAttachments)
+    TGA_SETTER(setSubpassAttachmentStoreOp, StoreOperation, subpassAttachmentStoreOp)
 };
 
 // ComputePass Info
 struct ComputePassInfo {
     Shader computeShader;    /**<The Shader to be executed in this ComoutePass.*/
     InputLayout inputLayout; /**<Describes how the Bindings are organized*/
+    bool bindlessTable{false}; /**<(optional) Makes the bindless table available to the shader as the set following
+                                  the last set of the inputLayout. Requires support for descriptor indexing*/
 
     // Constructor with single window
     ComputePassInfo(Shader const& _computeShader, InputLayout const& _inputLayout = InputLayout())
@@ -323,6 +518,7 @@ struct ComputePassInfo {
     // chaining setters for "Info().setX(x).setY(y)" pattern
     TGA_SETTER(setComputeShader, Shader, computeShader)
     TGA_SETTER(setInputLayout, InputLayout, inputLayout)
+    TGA_SETTER(setBindlessTable, bool, bindlessTable)
 };
 
 /* InputSet
@@ -333,8 +529,12 @@ struct Binding {
     Resource resource;
     uint32_t slot;
     uint32_t arrayElement;
-    Binding(Resource _resource, uint32_t _slot = 0, uint32_t _arrayElement = 0)
-        : resource(_resource), slot(_slot), arrayElement(_arrayElement)
+    size_t offset; /**<(optional) Start of the bound range of a Buffer in bytes. Must be a multiple of the offset
+                      alignment for the type of Binding*/
+    size_t range;  /**<(optional) Size of the bound range of a Buffer in bytes, 0 binds the rest of the Buffer*/
+    Binding(Resource _resource, uint32_t _slot = 0, uint32_t _arrayElement = 0, size_t _offset = 0,
+            size_t _range = 0)
+        : resource(_resource), slot(_slot), arrayElement(_arrayElement), offset(_offset), range(_range)
     {}
 
     // chaining setters for "Info().setX(x).setY(y)" pattern
@@ -342,6 +542,8 @@ struct Binding {
     TGA_SETTER(setResource, Texture, resource)
     TGA_SETTER(setSlot, uint32_t, slot)
     TGA_SETTER(setArrayElement, uint32_t, arrayElement)
+    TGA_SETTER(setOffset, size_t, offset)
+    TGA_SETTER(setRange, size_t, range)
 };
 
 struct InputSetInfo {
@@ -350,8 +552,10 @@ struct InputSetInfo {
     std::vector<Binding> bindings; /**<The collection of Bindings in this InputSet*/
     uint32_t index;                /**<The Index of this InputSet as defined in
                                                      RenderPass.inputLayout*/
-    InputSetInfo(TargetPass _targetPass, std::vector<Binding> const& _bindings = {}, uint32_t _index = 0)
-        : targetPass(_targetPass), bindings(_bindings), index(_index)
+    uint32_t subpass{0}; /**<(optional) The subpass of the RenderPass whose inputLayout the index refers to*/
+    InputSetInfo(TargetPass _targetPass, std::vector<Binding> const& _bindings = {}, uint32_t _index = 0,
+                 uint32_t _subpass = 0)
+        : targetPass(_targetPass), bindings(_bindings), index(_index), subpass(_subpass)
     {}
 
     // chaining setters for "Info().setX(x).setY(y)" pattern
@@ -359,6 +563,7 @@ struct InputSetInfo {
     TGA_SETTER(setTargetPass, ComputePass, targetPass)
     TGA_SETTER(setBindings, std::vector<Binding> const&, bindings)
     TGA_SETTER(setIndex, uint32_t, index)
+    TGA_SETTER(setSubpass, uint32_t, subpass)
 };
 
 /* CommandBuffer
@@ -386,6 +591,44 @@ static_assert(sizeof(DrawIndexedIndirectCommand) == 5 * sizeof(uint32_t));
 
 namespace ext
 {
+    using TransformMatrix = std::array<std::array<float, 4>, 3>; /**<4x3 row major matrix defining the transform of this */
+
+    enum class GeometryFlags : uint32_t {
+        none = 0u,
+        opaque = 1u << 0u,            /**<Any-hit shaders are not invoked for this geometry*/
+        noDuplicateAnyHit = 1u << 1u  /**<The any-hit shader is invoked at most once per primitive and ray*/
+    };
+    inline GeometryFlags operator|(GeometryFlags a, GeometryFlags b)
+    {
+        return static_cast<GeometryFlags>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+    }
+    inline bool operator&(GeometryFlags a, GeometryFlags b)
+    {
+        return bool(static_cast<uint32_t>(a) & static_cast<uint32_t>(b));
+    }
+
+    // One indexed triangle range of a bottom level acceleration structure
+    struct TriangleGeometry {
+        Buffer vertexBuffer;         /**<The vertex buffer defining this geometry*/
+        Buffer indexBuffer;          /**<The index buffer defining this geometry*/
+        size_t vertexStride;         /**< Distance between vertex positions inside the vertex buffer in bytes*/
+        Format vertexPositionFormat; /**< Format of the vertex position data*/
+        uint32_t indexCount;         /**<Same as indexCount of indexed draw*/
+        uint32_t firstIndex;         /**<Same as firstIndex of indexed draw*/
+        uint32_t vertexOffset;       /**<Same as vertexOffset of indexed draw*/
+        std::optional<TransformMatrix> transform; /**<(optional) Applied to the vertex positions during the build*/
+        GeometryFlags flags{GeometryFlags::opaque};
+        TGA_SETTER(setVertexBuffer, Buffer, vertexBuffer)
+        TGA_SETTER(setIndexBuffer, Buffer, indexBuffer)
+        TGA_SETTER(setVertexStride, size_t, vertexStride)
+        TGA_SETTER(setVertexPositionFormat, Format, vertexPositionFormat)
+        TGA_SETTER(setIndexCount, uint32_t, indexCount)
+        TGA_SETTER(setFirstIndex, uint32_t, firstIndex)
+        TGA_SETTER(setVertexOffset, uint32_t, vertexOffset)
+        TGA_SETTER(setTransform, std::optional<TransformMatrix> const&, transform)
+        TGA_SETTER(setFlags, GeometryFlags, flags)
+    };
+
     struct BottomLevelAccelerationStructureInfo {
         Buffer vertexBuffer;         /**<The vertex buffer defining geometry for this acceleration structure*/
         Buffer indexBuffer;          /**<The index buffer defining geometry for this acceleration structure*/
@@ -394,6 +637,12 @@ namespace ext
         uint32_t indexCount;         /**<Same as indexCount of indexed draw*/
         uint32_t firstIndex;         /**<Same as firstIndex of indexed draw*/
         uint32_t vertexOffset;       /**<Same as vertexOffset of indexed draw*/
+        bool allowCompaction{false}; /**<(optional) Shrink the structure to its compacted size after the build. Costs
+                                        an additional wait and copy, saves memory for static geometry*/
+        std::vector<TriangleGeometry> geometries; /**<(optional) Several geometries in one structure, e.g. all
+                                                     submeshes of a mesh. Replaces the single opaque geometry
+                                                     described by the fields above. Hit shaders tell them apart
+                                                     with gl_GeometryIndexEXT*/
         TGA_SETTER(setVertexBuffer, Buffer, vertexBuffer)
         TGA_SETTER(setIndexBuffer, Buffer, indexBuffer)
         TGA_SETTER(setVertexStride, size_t, vertexStride)
@@ -401,18 +650,67 @@ namespace ext
         TGA_SETTER(setIndexCount, uint32_t, indexCount)
         TGA_SETTER(setFirstIndex, uint32_t, firstIndex)
         TGA_SETTER(setVertexOffset, uint32_t, vertexOffset)
+        TGA_SETTER(setAllowCompaction, bool, allowCompaction)
+        TGA_SETTER(setGeometries, std::vector<TriangleGeometry> const&, geometries)
     };
 
-    using TransformMatrix = std::array<std::array<float, 4>, 3>; /**<4x3 row major matrix defining the transform of this */
+    enum class InstanceFlags : uint32_t {
+        none = 0u,
+        triangleCullDisable = 1u << 0u, /**<Back and front faces are both hit*/
+        triangleFlipFacing = 1u << 1u,  /**<Counter-clockwise triangles are front facing*/
+        forceOpaque = 1u << 2u,         /**<Overrides the geometry flags, no any-hit shaders are invoked*/
+        forceNoOpaque = 1u << 3u        /**<Overrides the geometry flags, any-hit shaders are always invoked*/
+    };
+    inline InstanceFlags operator|(InstanceFlags a, InstanceFlags b)
+    {
+        return static_cast<InstanceFlags>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+    }
+    inline bool operator&(InstanceFlags a, InstanceFlags b)
+    {
+        return bool(static_cast<uint32_t>(a) & static_cast<uint32_t>(b));
+    }
 
     struct AccelerationStructureInstanceInfo {
         BottomLevelAccelerationStructure blas;
         TransformMatrix transform; 
+        uint32_t customIndex{0};  /**<Value of gl_InstanceCustomIndexEXT, 24 bits*/
+        uint8_t mask{0xFF};       /**<Instance is only hit if mask & cullMask of the ray != 0*/
+        uint32_t shaderBindingTableRecordOffset{0}; /**<Offset of the instance in the hit shader groups, 24 bits*/
+        InstanceFlags flags{InstanceFlags::forceOpaque | InstanceFlags::triangleCullDisable};
+        TGA_SETTER(setBlas, BottomLevelAccelerationStructure, blas)
+        TGA_SETTER(setTransform, TransformMatrix const&, transform)
+        TGA_SETTER(setCustomIndex, uint32_t, customIndex)
+        TGA_SETTER(setMask, uint8_t, mask)
+        TGA_SETTER(setShaderBindingTableRecordOffset, uint32_t, shaderBindingTableRecordOffset)
+        TGA_SETTER(setFlags, InstanceFlags, flags)
+    };
+
+    /** Instance record as the GPU reads it from an instance Buffer, 64 bytes with the layout of
+     * VkAccelerationStructureInstanceKHR. Shaders that write instances have to use the same layout
+     */
+    struct AccelerationStructureInstance {
+        TransformMatrix transform;
+        uint32_t instanceCustomIndex : 24;             /**<Value of gl_InstanceCustomIndexEXT*/
+        uint32_t mask : 8;                             /**<Instance is only hit if mask & cullMask of the ray != 0*/
+        uint32_t shaderBindingTableRecordOffset : 24;  /**<Offset of the instance in the hit shader groups*/
+        uint32_t flags : 8;                            /**<VkGeometryInstanceFlagsKHR*/
+        uint64_t accelerationStructureReference;       /**<See Interface::getDeviceAddress*/
     };
 
     struct TopLevelAccelerationStructureInfo {
         std::vector<AccelerationStructureInstanceInfo> instanceInfos;
+        bool allowUpdate{false};        /**<(optional) Keep instance and scratch memory to refit the structure in
+                                           place with CommandRecorder::updateTopLevelAccelerationStructure*/
+        Buffer instanceBuffer;          /**<(optional) Read instanceCount AccelerationStructureInstance records from
+                                           this Buffer instead of instanceInfos, e.g. written by a ComputePass.
+                                           Requires BufferUsage::accelerationStructureBuildInput*/
+        uint32_t instanceCount{0};      /**<Number of instances in instanceBuffer*/
+        size_t instanceBufferOffset{0}; /**<Offset of the first instance in instanceBuffer, a multiple of 16*/
         TGA_SETTER(setInstanceInfos, std::vector<AccelerationStructureInstanceInfo> const&, instanceInfos)
+        TGA_SETTER(setAllowUpdate, bool, allowUpdate)
+        TGA_SETTER(setInstanceBuffer, Buffer, instanceBuffer)
+        TGA_SETTER(setInstanceCount, uint32_t, instanceCount)
+        TGA_SETTER(setInstanceBufferOffset, size_t, instanceBufferOffset)
     };
 }  // namespace ext
 
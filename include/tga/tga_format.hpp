@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 
 namespace tga
 {
@@ -41,7 +42,145 @@ namespace tga
         r16_sfloat,
         r16g16_sfloat,
         r16g16b16_sfloat,
-        r16g16b16a16_sfloat
+        r16g16b16a16_sfloat,
+
+        // Block-compressed formats, only usable for sampled Textures
+        bc1_rgb_unorm,
+        bc1_rgb_srgb,
+        bc1_rgba_unorm,
+        bc1_rgba_srgb,
+        bc2_unorm,
+        bc2_srgb,
+        bc3_unorm,
+        bc3_srgb,
+        bc4_unorm,
+        bc4_snorm,
+        bc5_unorm,
+        bc5_snorm,
+        bc6h_ufloat,
+        bc6h_sfloat,
+        bc7_unorm,
+        bc7_srgb,
+        etc2_r8g8b8_unorm,
+        etc2_r8g8b8_srgb,
+        etc2_r8g8b8a1_unorm,
+        etc2_r8g8b8a1_srgb,
+        etc2_r8g8b8a8_unorm,
+        etc2_r8g8b8a8_srgb,
+        astc_4x4_unorm,
+        astc_4x4_srgb,
+        astc_6x6_unorm,
+        astc_6x6_srgb,
+        astc_8x8_unorm,
+        astc_8x8_srgb,
+
+        // 16-bit normalized formats, e.g. for compact vertex attributes. Appended so the values of the formats above
+        // stay the same in files that store them
+        r16_unorm,
+        r16_snorm,
+        r16g16_unorm,
+        r16g16_snorm,
+        r16g16b16a16_unorm,
+        r16g16b16a16_snorm
+    };
+
+    // Memory layout of a format: Texels are stored in blocks of width x height with a size in bytes.
+    // Uncompressed formats have blocks of a single texel
+    struct FormatBlockInfo {
+        uint32_t size;
+        uint32_t width;
+        uint32_t height;
     };
 
+    constexpr FormatBlockInfo formatBlockInfo(Format format)
+    {
+        switch (format) {
+            case Format::r8_uint:
+            case Format::r8_sint:
+            case Format::r8_srgb:
+            case Format::r8_unorm:
+            case Format::r8_snorm: return {1, 1, 1};
+            case Format::r8g8_uint:
+            case Format::r8g8_sint:
+            case Format::r8g8_srgb:
+            case Format::r8g8_unorm:
+            case Format::r8g8_snorm:
+            case Format::r16_sfloat:
+            case Format::r16_unorm:
+            case Format::r16_snorm: return {2, 1, 1};
+            case Format::r8g8b8_uint:
+            case Format::r8g8b8_sint:
+            case Format::r8g8b8_srgb:
+            case Format::r8g8b8_unorm:
+            case Format::r8g8b8_snorm: return {3, 1, 1};
+            case Format::r8g8b8a8_uint:
+            case Format::r8g8b8a8_sint:
+            case Format::r8g8b8a8_srgb:
+            case Format::r8g8b8a8_unorm:
+            case Format::r8g8b8a8_snorm:
+            case Format::r32_uint:
+            case Format::r32_sint:
+            case Format::r32_sfloat:
+            case Format::r16g16_sfloat:
+            case Format::r16g16_unorm:
+            case Format::r16g16_snorm: return {4, 1, 1};
+            case Format::r16g16b16_sfloat: return {6, 1, 1};
+            case Format::r32g32_uint:
+            case Format::r32g32_sint:
+            case Format::r32g32_sfloat:
+            case Format::r16g16b16a16_sfloat:
+            case Format::r16g16b16a16_unorm:
+            case Format::r16g16b16a16_snorm: return {8, 1, 1};
+            case Format::r32g32b32_uint:
+            case Format::r32g32b32_sint:
+            case Format::r32g32b32_sfloat: return {12, 1, 1};
+            case Format::r32g32b32a32_uint:
+            case Format::r32g32b32a32_sint:
+            case Format::r32g32b32a32_sfloat: return {16, 1, 1};
+            case Format::bc1_rgb_unorm:
+            case Format::bc1_rgb_srgb:
+            case Format::bc1_rgba_unorm:
+            case Format::bc1_rgba_srgb:
+            case Format::bc4_unorm:
+            case Format::bc4_snorm:
+            case Format::etc2_r8g8b8_unorm:
+            case Format::etc2_r8g8b8_srgb:
+            case Format::etc2_r8g8b8a1_unorm:
+            case Format::etc2_r8g8b8a1_srgb: return {8, 4, 4};
+            case Format::bc2_unorm:
+            case Format::bc2_srgb:
+            case Format::bc3_unorm:
+            case Format::bc3_srgb:
+            case Format::bc5_unorm:
+            case Format::bc5_snorm:
+            case Format::bc6h_ufloat:
+            case Format::bc6h_sfloat:
+            case Format::bc7_unorm:
+            case Format::bc7_srgb:
+            case Format::etc2_r8g8b8a8_unorm:
+            case Format::etc2_r8g8b8a8_srgb:
+            case Format::astc_4x4_unorm:
+            case Format::astc_4x4_srgb: return {16, 4, 4};
+            case Format::astc_6x6_unorm:
+            case Format::astc_6x6_srgb: return {16, 6, 6};
+            case Format::astc_8x8_unorm:
+            case Format::astc_8x8_srgb: return {16, 8, 8};
+            default: return {0, 1, 1};
+        }
+    }
+
+    constexpr bool isBlockCompressed(Format format)
+    {
+        auto block = formatBlockInfo(format);
+        return block.width > 1 || block.height > 1;
+    }
+
+    // Size in bytes of a single image of a format, e.g. one mip level of one layer of a Texture
+    constexpr uint64_t formatImageSize(Format format, uint32_t width, uint32_t height, uint32_t depth = 1)
+    {
+        auto block = formatBlockInfo(format);
+        return uint64_t((width + block.width - 1) / block.width) * ((height + block.height - 1) / block.height) *
+               depth * block.size;
+    }
+
 }
\ No newline at end of file
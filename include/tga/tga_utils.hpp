@@ -2,6 +2,8 @@
 #include "tga/tga.hpp"
 #include "tga/tga_math.hpp"
 
+#include <span>
+
 #if defined(_MSC_VER)
 #pragma warning(push, 0)
 #elif defined(__GNUC__) || defined(__clang__)
@@ -40,6 +42,20 @@ struct Vertex {
     static tga::VertexLayout layout();
 };
 
+/**
+ * @brief The attributes of a Vertex in 20 instead of 64 bytes, from quantizeObj.
+ * The position is relative to the bounds of its mesh, see CompactObj::positionTransform. Normal and tangent are
+ * octahedral encoded unit vectors, see octahedralDecode
+ */
+struct CompactVertex {
+    uint16_t position[4]; /**<r16g16b16a16_unorm, w is padding as three component 16-bit formats are rarely supported*/
+    int16_t normal[2];    /**<r16g16_snorm*/
+    int16_t tangent[2];   /**<r16g16_snorm*/
+    uint16_t uv[2];       /**<r16g16_sfloat*/
+
+    static tga::VertexLayout layout();
+};
+
 struct TextureBundle {
     Texture texture;
     uint32_t width, height;
@@ -51,6 +67,15 @@ struct Obj {
     std::vector<uint32_t> indexBuffer;
 };
 
+struct CompactObj {
+    std::vector<tga::CompactVertex> vertexBuffer;
+    std::vector<uint32_t> indexBuffer;
+    glm::vec3 boundsMin, boundsMax; /**<Bounds of the positions before quantization*/
+
+    // Maps the quantized positions in [0, 1] back into the bounds, multiply it into the model matrix
+    glm::mat4 positionTransform() const;
+};
+
 struct Image {
     uint32_t width, height;
     uint32_t components;
@@ -65,16 +90,201 @@ struct HDRImage {
 
 tga::Shader loadShader(std::string const& filepath, tga::ShaderType shaderType, tga::Interface& tgai);
 
+// KTX2 and DDS files are loaded with loadCompressedTexture, the format is taken from the file in that case
 TextureBundle loadTexture(std::string const& filepath, tga::Format format, tga::SamplerMode samplerMode,
                           tga::AddressMode addressMode, tga::Interface& tgai,
                           bool doGammaCorrection = false);
 
+// Uploads the mip chain of a KTX2 or DDS file without decoding it. Throws for formats or layouts that are not supported
+TextureBundle loadCompressedTexture(std::string const& filepath, tga::SamplerMode samplerMode,
+                                    tga::AddressMode addressMode, tga::Interface& tgai);
+
 TextureBundle loadTexture(std::string const& filepath, tga::Format format, tga::SamplerMode samplerMode,
                           tga::Interface& tgai, bool doGammaCorrection = false);
 
 Image loadImage(std::string const& filepath);
 HDRImage loadHDRImage(std::string const& filepath, bool doGammaCorrection = false);
 
+/**
+ * @brief Loads the triangles of an OBJ file, polygons are triangulated as fans. The file is parsed on all cores.
+ * Face vertices with equal position, uv and normal share one vertex, its tangent is the average of their faces
+ */
+Obj loadObj(std::string const& filepath);
+
+template <typename T>
+Obj loadObj(T const& filepath)
+{
+    return loadObj(std::string(filepath));
+}
+
+/**
+ * @brief Quantizes the vertices to CompactVertex, the indices stay the same. Run optimizeMesh before, if at all.
+ * Positions keep 16 bits per axis of the bounds. Half float uvs resolve 1/2048 in [0, 1] and get coarser for
+ * larger values, strongly tiling uvs lose precision
+ */
+CompactObj quantizeObj(Obj const& obj);
+
+// loadObj followed by quantizeObj
+CompactObj loadCompactObj(std::string const& filepath);
+
+template <typename T>
+CompactObj loadCompactObj(T const& filepath)
+{
+    return loadCompactObj(std::string(filepath));
+}
+
+/**
+ * @brief Octahedral encoding of a unit vector as two values in [-1, 1]. Zero or invalid vectors encode as +z.
+ * Shaders decode an r16g16_snorm attribute e with:
+ *     vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+ *     float t = max(-n.z, 0.0);
+ *     n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+ *     n = normalize(n);
+ */
+glm::vec2 octahedralEncode(glm::vec3 direction);
+glm::vec3 octahedralDecode(glm::vec2 encoded);
+
+/**
+ * @brief Binary mesh file with the vertex and index data as it is uploaded, plus its VertexLayout and bounds.
+ * Written once from e.g. loadObj with writeMesh, later runs skip parsing and map the file into memory.
+ * The format stores the values of tga::Format, files are only valid for the version of TGA that wrote them
+ */
+class MeshFile {
+public:
+    explicit MeshFile(std::string const& filepath);
+
+    VertexLayout const& vertexLayout() const { return layout; }
+    uint32_t vertexCount() const { return vertices; }
+    uint32_t indexCount() const { return indices; }
+    void const *vertexData() const { return vertexBlob; }  /**<vertexCount * vertexLayout().vertexSize bytes*/
+    uint32_t const *indexData() const { return indexBlob; }
+    glm::vec3 boundsMin() const { return minimum; }
+    glm::vec3 boundsMax() const { return maximum; }
+
+private:
+    std::shared_ptr<void const> mapping;  // Unmaps the file when the last copy of the MeshFile is gone
+    VertexLayout layout;
+    uint32_t vertices, indices;
+    void const *vertexBlob;
+    uint32_t const *indexBlob;
+    glm::vec3 minimum, maximum;
+};
+
+struct MeshBundle {
+    Buffer vertexBuffer;
+    Buffer indexBuffer;
+    uint32_t vertexCount, indexCount;
+    VertexLayout vertexLayout;
+    glm::vec3 boundsMin, boundsMax;
+};
+
+// The bounds are the bounds of the vertex positions, for a CompactObj before quantization
+void writeMesh(std::string const& filepath, Obj const& obj);
+void writeMesh(std::string const& filepath, CompactObj const& obj);
+void writeMesh(std::string const& filepath, VertexLayout const& vertexLayout, void const *vertexData,
+               uint32_t vertexCount, std::vector<uint32_t> const& indexBuffer, glm::vec3 boundsMin,
+               glm::vec3 boundsMax);
+
+// Copies the vertex and index data from the mapped file into one staging buffer and creates both Buffers from it.
+// additionalUsage is added to both, e.g. storage or accelerationStructureBuildInput
+MeshBundle loadMesh(std::string const& filepath, tga::Interface& tgai,
+                    BufferUsage additionalUsage = BufferUsage::undefined);
+
+/* Mesh optimization
+ * The passes reorder triangle lists in place, indexed draws of the result show the same triangles.
+ * Run them in this order: optimizeVertexCache, optimizeOverdraw, optimizeVertexFetch
+ */
+
+// Post transform vertex cache efficiency of a triangle list, simulated with a FIFO cache of cacheSize vertices
+struct VertexCacheStatistics {
+    uint32_t vertexShaderInvocations{0};
+    float acmr{0}; /**<Average cache miss ratio: invocations per triangle, about 0.5 at best for closed meshes*/
+    float atvr{0}; /**<Average transformed vertex ratio: invocations per referenced vertex, 1 at best*/
+};
+
+VertexCacheStatistics analyzeVertexCache(std::span<uint32_t const> indices, uint32_t vertexCount,
+                                         uint32_t cacheSize = 16);
+
+// Reorders the triangles for vertex cache reuse with Tipsify, in time linear in the number of triangles
+void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+/**
+ * @brief Reorders clusters of a cache optimized triangle list so that outward facing clusters are drawn first.
+ * Front faces are expected to be counterclockwise, like the faces of OBJ files.
+ * threshold is the factor by which the ACMR may get worse, larger values allow smaller clusters and less overdraw.
+ * positionData points to the glm::vec3 position of the first vertex, positions are vertexStride bytes apart
+ */
+void optimizeOverdraw(std::span<uint32_t> indices, void const *positionData, size_t vertexStride,
+                      uint32_t vertexCount, uint32_t cacheSize = 16, float threshold = 1.05f);
+
+constexpr uint32_t unusedVertex = ~0u;
+
+/**
+ * @brief Renumbers the vertices in the order in which the indices first reference them, so vertex fetches stream
+ * through the vertex buffer. Vertices without references are dropped.
+ * @return The new index of each vertex or unusedVertex, for remapVertices
+ */
+std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices, uint32_t vertexCount);
+
+template <typename T>
+std::vector<T> remapVertices(std::vector<T> const& vertices, std::vector<uint32_t> const& remap)
+{
+    std::vector<T> result(vertices.size() - std::count(remap.begin(), remap.end(), unusedVertex));
+    for (size_t i = 0; i < vertices.size(); ++i)
+        if (remap[i] != unusedVertex) result[remap[i]] = vertices[i];
+    return result;
+}
+
+// Removes triangles with repeated indices, returns the number of removed triangles
+size_t removeDegenerateTriangles(std::vector<uint32_t>& indices);
+
+struct MeshOptimizationReport {
+    VertexCacheStatistics before, after;
+    size_t removedTriangles{0}; /**<Degenerate triangles*/
+    size_t removedVertices{0};  /**<Vertices without triangles*/
+};
+
+// Runs all passes on the mesh, the tangents and attributes of the vertices stay the same
+MeshOptimizationReport optimizeMesh(Obj& obj, uint32_t cacheSize = 16, float overdrawThreshold = 1.05f);
+
+/* Meshlets
+ * Clusters of neighbouring triangles with bounds to cull them as a whole, e.g. in a compute shader that copies the
+ * triangles of visible meshlets into a compacted index buffer for drawIndexedIndirect
+ */
+constexpr uint32_t maxMeshletVertices = 64;
+constexpr uint32_t maxMeshletTriangles = 124;
+
+// Same layout as a std430 struct of vec3 center, float radius, vec3 coneAxis, float coneCutoff and four uints
+struct Meshlet {
+    glm::vec3 center; /**<Bounding sphere of the vertices*/
+    float radius;
+    glm::vec3 coneAxis; /**<Average normal of the triangles*/
+    float coneCutoff;   /**<Sine of the largest angle between coneAxis and a triangle normal, 1 disables the test*/
+    uint32_t firstIndex; /**<The triangles of the meshlet are contiguous in the reordered index buffer*/
+    uint32_t triangleCount;
+    uint32_t vertexCount;
+    uint32_t padding;
+};
+static_assert(sizeof(Meshlet) == 48);
+
+/**
+ * @brief Groups the triangles into meshlets and reorders the index buffer so each meshlet is a contiguous range.
+ * Meshlets grow over shared vertices, preferring triangles that face like the meshlet so far, which keeps their
+ * normal cones narrow. Disconnected parts continue in index order, run optimizeVertexCache before.
+ * Triangle normals assume counter clockwise front faces
+ */
+std::vector<Meshlet> buildMeshlets(std::span<uint32_t> indices, void const *positionData, size_t vertexStride,
+                                   uint32_t vertexCount, uint32_t maxVertices = maxMeshletVertices,
+                                   uint32_t maxTriangles = maxMeshletTriangles);
+std::vector<Meshlet> buildMeshlets(Obj& obj, uint32_t maxVertices = maxMeshletVertices,
+                                   uint32_t maxTriangles = maxMeshletTriangles);
+
+/**
+ * @brief CPU version of the culling test of a meshlet: false if its bounding sphere is outside of the frustum or
+ * all of its triangles face away from the camera. Both parameters are in the space of the mesh
+ */
+bool meshletVisible(Meshlet const& meshlet, glm::mat4 const& modelViewProjection, glm::vec3 cameraPosition);
+
 void writeHDR(std::string const& filename, uint32_t width, uint32_t height, tga::Format format,
               std::vector<float> const& data);
 
@@ -108,83 +318,3 @@ struct std::hash<tga::Vertex> {
                (std::hash<glm::vec2>()(v.uv) << 1);
     }
 };
-
-namespace tga
-{
-template <typename T>
-Obj loadObj(T const& filepath)
-{
-    // Using tinyobjloader to get the data
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, std::string(filepath).c_str()))
-        throw std::runtime_error(warn + err);
-
-    // Convert the data into our representation
-    std::vector<Vertex> preVertexBuffer;
-    uint32_t pvb_count = 0;
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            Vertex& vertex = preVertexBuffer.emplace_back();
-            vertex.position = {attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1],
-                               attrib.vertices[3 * index.vertex_index + 2]};
-            if (index.normal_index != -1)
-                vertex.normal = {attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1],
-                                 attrib.normals[3 * index.normal_index + 2]};
-            if (index.texcoord_index != -1)
-                vertex.uv = {attrib.texcoords[2 * index.texcoord_index + 0],
-                             1.f - attrib.texcoords[2 * index.texcoord_index + 1]};
-            pvb_count++;
-        }
-    }
-    assert(pvb_count == preVertexBuffer.size());
-    std::unordered_map<Vertex, uint32_t> foundVertices{};
-    std::vector<Vertex> vertexBuffer;
-    std::vector<uint32_t> indexBuffer;
-
-    // Calculate Tangents
-    // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-13-normal-mapping/
-    for (size_t i = 0; i < pvb_count; i += 3) {
-        const auto& p0 = preVertexBuffer[i + 0].position;
-        const auto& p1 = preVertexBuffer[i + 1].position;
-        const auto& p2 = preVertexBuffer[i + 2].position;
-
-        const auto& uv0 = preVertexBuffer[i + 0].uv;
-        const auto& uv1 = preVertexBuffer[i + 1].uv;
-        const auto& uv2 = preVertexBuffer[i + 2].uv;
-
-        auto deltaPos1 = p1 - p0;
-        auto deltaPos2 = p2 - p0;
-
-        auto deltaUV1 = uv1 - uv0;
-        auto deltaUV2 = uv2 - uv0;
-
-        float r = 1.f / (deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x);
-        glm::vec3 tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * r;
-
-        preVertexBuffer[i + 0].tangent = tangent;
-        preVertexBuffer[i + 1].tangent = tangent;
-        preVertexBuffer[i + 2].tangent = tangent;
-    }
-
-    // Fill final vertex and index Buffer
-    uint32_t vb_count = 0;
-    for (const auto& vertex : preVertexBuffer) {
-        if (!foundVertices.count(vertex)) {    // It's a new Vertex
-            foundVertices[vertex] = vb_count;  // static_cast<uint32_t>(vertexBuffer.size());
-            vertexBuffer.emplace_back(vertex);
-            vb_count++;
-        } else {  // Seen before, average the tangents
-            auto& v = vertexBuffer[foundVertices[vertex]];
-            v.tangent += vertex.tangent;
-        }
-        indexBuffer.emplace_back(foundVertices[vertex]);
-    }
-
-    for (auto& vertex : vertexBuffer) vertex.tangent = glm::normalize(vertex.tangent);
-
-    return {vertexBuffer, indexBuffer};
-}
-}  // namespace tga
\ No newline at end of file
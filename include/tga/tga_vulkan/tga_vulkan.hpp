@@ -9,15 +9,19 @@ namespace tga
 /** \brief The Interface Implementation over the Vulkan API
  */
 struct Interface::InternalState {
-    InternalState();
+    InternalState(InterfaceInfo const&);
     // Vulkan Stuff
-    VulkanWSI wsi;
+    std::optional<VulkanWSI> wsi;  // Empty for a headless Interface
+    bool validation;               // Validation layer and debug messenger are enabled
     vk::Instance instance;
     vk::DebugUtilsMessengerEXT debugger;
     vk::PhysicalDevice pDevice;
     uint32_t hostMemoryIndex;
+    uint32_t readbackMemoryIndex;  // Host cached if available
     uint32_t deviceMemoryIndex;
     uint32_t renderQueueFamily;
+    vkData::DeviceFeatures features;
+    vk::PhysicalDeviceLimits limits;
     vk::Device device;
     vk::Queue renderQueue;
     vk::CommandPool cmdPool;
@@ -75,6 +79,43 @@ struct Interface::InternalState {
     vkData::ext::AccelerationStructure& getData(ext::TopLevelAccelerationStructure);
     vkData::ext::AccelerationStructure& getData(ext::BottomLevelAccelerationStructure);
 
+    // Descriptor set allocation, keyed by the set layout the sets are allocated with
+    std::unordered_map<VkDescriptorSetLayout, vkData::DescriptorSetAllocator> descriptorSetAllocators;
+
+    // Created on first use, see getBindlessTable
+    vkData::BindlessTable bindlessTable;
+    vkData::BindlessTable& getBindlessTable();
+
+    VulkanWSI& getWSI();  // Throws for a headless Interface
+
+    vkData::ext::AccelerationStructure createAccelerationStructure(vk::AccelerationStructureTypeKHR, vk::DeviceSize);
+    std::pair<vk::Buffer, vk::DeviceMemory> createScratchBuffer(vk::DeviceSize);
+    std::pair<vk::Buffer, vk::DeviceMemory> createHostAddressBuffer(vk::DeviceSize, uint32_t memoryIndex);
+    std::vector<vk::AccelerationStructureInstanceKHR> toInstances(
+        std::vector<ext::AccelerationStructureInstanceInfo> const&);
+    vk::DeviceAddress instanceBufferAddress(Buffer, size_t offset, uint32_t instanceCount);  // Validates the range
+    void recordTopLevelUpdate(vkData::CommandBuffer&, vkData::ext::AccelerationStructure&, vk::DeviceAddress instances);
+    std::vector<vkData::ext::PendingBuild> pendingBuilds;
+    void releaseFinishedBuilds(bool waitForAll = false);
+
+    vkData::Readbacks readbacks;
+    ReadbackTicket submitReadback(size_t size, ReadbackCallback&&, std::function<void(vk::CommandBuffer, vk::Buffer)>);
+    bool updateReadback(vkData::Readback&);  // Non-blocking, true once the data is visible to the host
+
+    vkData::Layout createLayout(InputLayout const&, bool withBindlessTable = false);
+    void destroyLayout(vkData::Layout&);
+    vkData::Layout& getLayout(InputSetInfo const&);  // Layout of the pass and subpass an InputSet is created for
+    vk::DescriptorSet allocateDescriptorSet(vk::DescriptorSetLayout);
+    vk::DescriptorSet allocateTransientDescriptorSet(vkData::CommandBuffer&, vk::DescriptorSetLayout);
+    vkData::DescriptorWrites collectWrites(vk::DescriptorSet, std::vector<vk::DescriptorType> const& descriptorTypes,
+                                           std::vector<Binding> const& bindings);
+    void writeBindings(vk::DescriptorSet, std::vector<vk::DescriptorType> const& descriptorTypes,
+                       std::vector<Binding> const& bindings);
+
+    std::unordered_map<VkDescriptorSetLayout, vkData::DescriptorUpdateTemplates> descriptorUpdateTemplates;
+    vkData::DescriptorInfo describeBinding(Binding const&, vk::DescriptorType);
+    vk::DescriptorBufferInfo describeBufferRange(Binding const&, vk::DescriptorType);
+
     struct RecordingData {
         vk::CommandBuffer cmdBuffer;
         RenderPass renderPass;
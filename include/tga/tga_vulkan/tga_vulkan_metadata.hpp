@@ -1,11 +1,22 @@
 #pragma once
 #include "tga/tga.hpp"
+#include "tga/tga_hash.hpp"
 #include "vulkan/vulkan.hpp"
 
 namespace tga
 {
 namespace vkData
 {
+    // Optional capabilities of the physical device that TGA makes use of
+    struct DeviceFeatures {
+        bool rayQuery{false};
+        uint32_t minScratchOffsetAlignment{1};  // For acceleration structure builds
+        bool extendedDynamicState{false};
+        bool bindless{false};
+        bool pushDescriptor{false};
+        uint32_t maxPushDescriptors{0};
+    };
+
     struct Shader {
         vk::ShaderModule module{};
         tga::ShaderType type;
@@ -27,40 +38,134 @@ namespace vkData
         vk::Image image{};
         vk::ImageView imageView;
         vk::DeviceMemory memory;
+        vk::Format format;
     };
 
     struct Texture {
         vk::Image image{};
-        vk::ImageView imageView;
+        vk::ImageView imageView;  // Covers all mip levels, used for sampling
         vk::DeviceMemory memory;
         vk::Sampler sampler;
         vk::Extent3D extent;
         vk::Format format;
+        vk::ImageView baseLevelView;  // First mip level only, for attachments and storage images
+        uint32_t mipLevels;
+        uint32_t layers;
+        vk::Filter mipmapFilter;  // Linear if the format supports it
+        tga::Format textureFormat;  // Format the Texture was created with, determines the size of downloads
 
-        DepthBuffer depthBuffer;
+        std::vector<DepthBuffer> depthBuffers;  // Created on demand, at most one per depth format
     };
 
     struct InputSet {
-        vk::DescriptorPool descriptorPool{};
-        vk::DescriptorSet descriptorSet;
+        vk::DescriptorSet descriptorSet{};
+        vk::DescriptorSetLayout setLayout;  // Null once the layout the set was allocated with is destroyed
         vk::PipelineBindPoint pipelineBindPoint;
         vk::PipelineLayout pipelineLayout;
         uint32_t index;
     };
 
+    // Carves descriptor sets of one set layout out of shared pools and recycles freed sets
+    struct DescriptorSetAllocator {
+        static constexpr uint32_t minSetsPerPool = 16;
+        static constexpr uint32_t maxSetsPerPool = 1024;
+
+        std::vector<vk::DescriptorPoolSize> setPoolSizes;  // Descriptors required by a single set
+        std::vector<vk::DescriptorPool> pools;
+        uint32_t setsPerPool{minSetsPerPool};
+        uint32_t remainingSets{0};  // Sets that can still be allocated from pools.back()
+        std::vector<vk::DescriptorSet> freeSets;
+    };
+
+    // Per CommandBuffer pools for descriptor sets that only live until the CommandBuffer is recorded again
+    struct TransientDescriptorArena {
+        static constexpr uint32_t setsPerPool = 256;
+        static constexpr uint32_t descriptorsPerType = 1024;
+
+        std::vector<vk::DescriptorPool> pools;
+        size_t currentPool{0};
+    };
+
+    // Descriptor writes together with the infos they point to
+    struct DescriptorWrites {
+        std::vector<vk::DescriptorImageInfo> imageInfos;
+        std::vector<vk::DescriptorBufferInfo> bufferInfos;
+        std::vector<vk::WriteDescriptorSetAccelerationStructureKHR> accelerationStructureInfos;
+        std::vector<vk::WriteDescriptorSet> writeSets;
+    };
+
+    // Data of a single descriptor as it is read by a descriptor update template
+    union DescriptorInfo {
+        VkDescriptorImageInfo image;
+        VkDescriptorBufferInfo buffer;
+        VkAccelerationStructureKHR accelerationStructure;
+    };
+
+    // Descriptor update templates of one set layout, keyed by the (slot, arrayElement) pairs they write
+    struct DescriptorUpdateTemplates {
+        std::vector<vk::DescriptorType> descriptorTypes;
+        std::map<std::vector<std::pair<uint32_t, uint32_t>>, vk::DescriptorUpdateTemplate> templates;
+    };
+
+    // How the descriptors of a set are provided
+    enum class DescriptorSource {
+        inputSet,        // Sets allocated by createInputSet
+        pushDescriptor,  // Push-only set recorded with vkCmdPushDescriptorSetKHR
+        transient        // Push-only set emulated with sets from the transient arena of the CommandBuffer
+    };
+
     struct Layout {
         vk::PipelineLayout pipelineLayout{};
         std::vector<vk::DescriptorSetLayout> setLayouts;
         std::vector<std::vector<vk::DescriptorType>> setDescriptorTypes;
+        std::vector<DescriptorSource> setSources;
+        bool bindlessTable{false};  // The table is bound as the set after the last entry of setLayouts
     };
 
-    struct RenderPass {
+    // Global update-after-bind descriptor set that shaders index with the handles returned by registerBindless
+    struct BindlessTable {
+        static constexpr uint32_t sampledImageBinding = 0;
+        static constexpr uint32_t storageImageBinding = 1;
+        static constexpr uint32_t storageBufferBinding = 2;
+        static constexpr uint32_t defaultMaxTextures = 16384;
+        static constexpr uint32_t defaultMaxBuffers = 16384;
+
+        vk::DescriptorSetLayout setLayout{};
+        vk::DescriptorPool descriptorPool;
+        vk::DescriptorSet descriptorSet;
+        uint32_t maxTextures;
+        uint32_t maxBuffers;
+
+        std::unordered_map<tga::Texture, uint32_t> textureSlots;
+        std::unordered_map<tga::Buffer, uint32_t> bufferSlots;
+        std::vector<uint32_t> freeTextureSlots;
+        std::vector<uint32_t> freeBufferSlots;
+    };
+
+    // Values of the dynamic states of a pipeline, applied whenever the pipeline is bound
+    struct DynamicState {
+        tga::DynamicState enabled{tga::DynamicState::none};
+        vk::CullModeFlags cullMode;
+        vk::FrontFace frontFace;
+        vk::PrimitiveTopology primitiveTopology;
+        vk::Bool32 depthTestEnable;
+        vk::Bool32 depthWriteEnable;
+        vk::CompareOp depthCompareOp;
+    };
+
+    struct Subpass {
         vk::Pipeline pipeline{};
-        vk::RenderPass renderPass;
+        Layout layout;
+    };
+
+    struct RenderPass {
+        vk::RenderPass renderPass{};
+        std::vector<Subpass> subpasses;  // Always at least one
         std::vector<vk::Framebuffer> framebuffers;
         size_t numColorAttachmentsPerFrameBuffer;
         vk::Extent2D area;
-        Layout layout;
+        DynamicState dynamicState;
+        bool hasDepthAttachment;
     };
 
     struct ComputePass {
@@ -72,6 +177,34 @@ namespace vkData
         vk::CommandBuffer cmdBuffer{};
         vk::Fence completionFence{};
         vk::RenderPass currentRenderPass{};
+        std::variant<std::monostate, tga::RenderPass, tga::ComputePass> currentPass{};  // Target of pushBindings
+        uint32_t currentSubpass{0};
+        TransientDescriptorArena transientDescriptors{};
+    };
+
+    // Host-cached copy destination of a readback, reused once the readback is freed
+    struct ReadbackSlot {
+        vk::Buffer buffer{};
+        vk::DeviceMemory memory;
+        void *mapping;
+        vk::DeviceSize capacity;
+        vk::CommandBuffer cmdBuffer;
+        vk::Fence completionFence;
+    };
+
+    struct Readback {
+        size_t slot;
+        size_t size;
+        tga::ReadbackCallback callback;
+        bool ready{false};  // Fence signaled and memory invalidated
+    };
+
+    // Readbacks in flight and the slots they copy into
+    struct Readbacks {
+        std::vector<ReadbackSlot> slots;
+        std::vector<size_t> freeSlots;
+        std::unordered_map<uint64_t, Readback> pending;
+        uint64_t nextTicket{1};
     };
 
     struct Window {
@@ -89,7 +222,7 @@ namespace vkData
         uint32_t nextRenderSignal{0};
         std::vector<vk::CommandBuffer> toColorAttachmentTransitionCmds{};
         std::vector<vk::CommandBuffer> toPresentSrcTransitionCmds{};
-        DepthBuffer depthBuffer{};
+        std::vector<DepthBuffer> depthBuffers{};  // Created on demand, at most one per depth format
     };
 
     namespace ext
@@ -98,6 +231,23 @@ namespace vkData
             vk::AccelerationStructureKHR accelerationStructure{};
             vk::Buffer buffer;
             vk::DeviceMemory memory;
+
+            // Kept for top level structures that allow updates
+            vk::Buffer instanceBuffer;
+            vk::DeviceMemory instanceMemory;
+            vk::Buffer scratchBuffer;
+            vk::DeviceMemory scratchMemory;
+            uint32_t instanceCount{0};
+        };
+
+        // Builds submitted without waiting, their scratch memory is released once they completed
+        struct PendingBuild {
+            vk::CommandBuffer cmdBuffer{};
+            vk::Fence completionFence;
+            vk::Buffer scratchBuffer;
+            vk::DeviceMemory scratchMemory;
+            vk::Buffer transformBuffer;  // Per-geometry transforms, if any
+            vk::DeviceMemory transformMemory;
         };
     }  // namespace ext
 
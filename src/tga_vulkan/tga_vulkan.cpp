@@ -81,6 +81,40 @@ namespace /*conversion from tga to vulkan*/
             case Format::r16g16_sfloat: return vk::Format::eR16G16Sfloat;
             case Format::r16g16b16_sfloat: return vk::Format::eR16G16B16Sfloat;
             case Format::r16g16b16a16_sfloat: return vk::Format::eR16G16B16A16Sfloat;
+            case Format::bc1_rgb_unorm: return vk::Format::eBc1RgbUnormBlock;
+            case Format::bc1_rgb_srgb: return vk::Format::eBc1RgbSrgbBlock;
+            case Format::bc1_rgba_unorm: return vk::Format::eBc1RgbaUnormBlock;
+            case Format::bc1_rgba_srgb: return vk::Format::eBc1RgbaSrgbBlock;
+            case Format::bc2_unorm: return vk::Format::eBc2UnormBlock;
+            case Format::bc2_srgb: return vk::Format::eBc2SrgbBlock;
+            case Format::bc3_unorm: return vk::Format::eBc3UnormBlock;
+            case Format::bc3_srgb: return vk::Format::eBc3SrgbBlock;
+            case Format::bc4_unorm: return vk::Format::eBc4UnormBlock;
+            case Format::bc4_snorm: return vk::Format::eBc4SnormBlock;
+            case Format::bc5_unorm: return vk::Format::eBc5UnormBlock;
+            case Format::bc5_snorm: return vk::Format::eBc5SnormBlock;
+            case Format::bc6h_ufloat: return vk::Format::eBc6HUfloatBlock;
+            case Format::bc6h_sfloat: return vk::Format::eBc6HSfloatBlock;
+            case Format::bc7_unorm: return vk::Format::eBc7UnormBlock;
+            case Format::bc7_srgb: return vk::Format::eBc7SrgbBlock;
+            case Format::etc2_r8g8b8_unorm: return vk::Format::eEtc2R8G8B8UnormBlock;
+            case Format::etc2_r8g8b8_srgb: return vk::Format::eEtc2R8G8B8SrgbBlock;
+            case Format::etc2_r8g8b8a1_unorm: return vk::Format::eEtc2R8G8B8A1UnormBlock;
+            case Format::etc2_r8g8b8a1_srgb: return vk::Format::eEtc2R8G8B8A1SrgbBlock;
+            case Format::etc2_r8g8b8a8_unorm: return vk::Format::eEtc2R8G8B8A8UnormBlock;
+            case Format::etc2_r8g8b8a8_srgb: return vk::Format::eEtc2R8G8B8A8SrgbBlock;
+            case Format::astc_4x4_unorm: return vk::Format::eAstc4x4UnormBlock;
+            case Format::astc_4x4_srgb: return vk::Format::eAstc4x4SrgbBlock;
+            case Format::astc_6x6_unorm: return vk::Format::eAstc6x6UnormBlock;
+            case Format::astc_6x6_srgb: return vk::Format::eAstc6x6SrgbBlock;
+            case Format::astc_8x8_unorm: return vk::Format::eAstc8x8UnormBlock;
+            case Format::astc_8x8_srgb: return vk::Format::eAstc8x8SrgbBlock;
+            case Format::r16_unorm: return vk::Format::eR16Unorm;
+            case Format::r16_snorm: return vk::Format::eR16Snorm;
+            case Format::r16g16_unorm: return vk::Format::eR16G16Unorm;
+            case Format::r16g16_snorm: return vk::Format::eR16G16Snorm;
+            case Format::r16g16b16a16_unorm: return vk::Format::eR16G16B16A16Unorm;
+            case Format::r16g16b16a16_snorm: return vk::Format::eR16G16B16A16Snorm;
             default: return vk::Format::eUndefined;
         }
     }
@@ -95,16 +129,39 @@ namespace /*conversion from tga to vulkan*/
         }
         return descriptions;
     }
+    vk::CullModeFlags determineCullMode(CullMode cullMode)
+    {
+        switch (cullMode) {
+            case CullMode::front: return vk::CullModeFlagBits::eFront;
+            case CullMode::back: return vk::CullModeFlagBits::eBack;
+            case CullMode::all: return vk::CullModeFlagBits::eFrontAndBack;
+            default: return vk::CullModeFlagBits::eNone;
+        }
+    }
+
+    vk::FrontFace determineFrontFace(FrontFace frontFace)
+    {
+        return frontFace == FrontFace::counterclockwise ? vk::FrontFace::eCounterClockwise : vk::FrontFace::eClockwise;
+    }
+
+    vk::PrimitiveTopology determinePrimitiveTopology(PrimitiveTopology topology)
+    {
+        switch (topology) {
+            case PrimitiveTopology::triangleStrip: return vk::PrimitiveTopology::eTriangleStrip;
+            case PrimitiveTopology::triangleFan: return vk::PrimitiveTopology::eTriangleFan;
+            case PrimitiveTopology::lineList: return vk::PrimitiveTopology::eLineList;
+            case PrimitiveTopology::lineStrip: return vk::PrimitiveTopology::eLineStrip;
+            case PrimitiveTopology::pointList: return vk::PrimitiveTopology::ePointList;
+            default: return vk::PrimitiveTopology::eTriangleList;
+        }
+    }
+
     vk::PipelineRasterizationStateCreateInfo determineRasterizerState(const RasterizerConfig& config)
     {
-        vk::CullModeFlags cullFlags = vk::CullModeFlagBits::eNone;
+        vk::CullModeFlags cullFlags = determineCullMode(config.cullMode);
         vk::PolygonMode polyMode = vk::PolygonMode::eFill;
-        vk::FrontFace frontFace = vk::FrontFace::eClockwise;
-        if (config.cullMode == CullMode::back) cullFlags = vk::CullModeFlagBits::eBack;
-        if (config.cullMode == CullMode::front) cullFlags = vk::CullModeFlagBits::eFront;
-        if (config.cullMode == CullMode::all) cullFlags = vk::CullModeFlagBits::eFrontAndBack;
+        vk::FrontFace frontFace = determineFrontFace(config.frontFace);
         if (config.polygonMode == PolygonMode::wireframe) polyMode = vk::PolygonMode::eLine;
-        if (config.frontFace == FrontFace::counterclockwise) frontFace = vk::FrontFace::eCounterClockwise;
         return {{}, VK_FALSE, VK_FALSE, polyMode, cullFlags, frontFace, VK_FALSE, 0, 0, 0, 1.};
     }
 
@@ -121,6 +178,39 @@ namespace /*conversion from tga to vulkan*/
         }
     }
 
+    vk::Format findDepthFormat(vk::PhysicalDevice& gpu, DepthFormat depthFormat)
+    {
+        // Candidates in order of preference, the first one usable as depth attachment is chosen
+        std::vector<vk::Format> candidates;
+        switch (depthFormat) {
+            case DepthFormat::d16: candidates = {vk::Format::eD16Unorm}; break;
+            case DepthFormat::d24s8: candidates = {vk::Format::eD24UnormS8Uint, vk::Format::eD32SfloatS8Uint}; break;
+            default: candidates = {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint}; break;
+        }
+        for (auto format : candidates) {
+            if (gpu.getFormatProperties(format).optimalTilingFeatures &
+                vk::FormatFeatureFlagBits::eDepthStencilAttachment)
+                return format;
+        }
+        throw std::runtime_error("[TGA Vulkan] Requested depth format is not supported on this system");
+    }
+
+    vk::AttachmentLoadOp determineLoadOp(LoadOperation loadOperation, bool clear)
+    {
+        switch (loadOperation) {
+            case LoadOperation::load: return vk::AttachmentLoadOp::eLoad;
+            case LoadOperation::clear: return vk::AttachmentLoadOp::eClear;
+            case LoadOperation::dontCare: return vk::AttachmentLoadOp::eDontCare;
+            default: return clear ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eLoad;
+        }
+    }
+
+    vk::AttachmentStoreOp determineStoreOp(StoreOperation storeOperation)
+    {
+        return storeOperation == StoreOperation::dontCare ? vk::AttachmentStoreOp::eDontCare
+                                                          : vk::AttachmentStoreOp::eStore;
+    }
+
     vk::BlendFactor determineBlendFactor(BlendFactor blendFactor)
     {
         switch (blendFactor) {
@@ -152,33 +242,82 @@ namespace /*conversion from tga to vulkan*/
                     vk::ColorComponentFlagBits::eA};
     }
 
+
+    vk::GeometryFlagsKHR determineGeometryFlags(ext::GeometryFlags flags)
+    {
+        vk::GeometryFlagsKHR geometryFlags{};
+        if (flags & ext::GeometryFlags::opaque) geometryFlags |= vk::GeometryFlagBitsKHR::eOpaque;
+        if (flags & ext::GeometryFlags::noDuplicateAnyHit)
+            geometryFlags |= vk::GeometryFlagBitsKHR::eNoDuplicateAnyHitInvocation;
+        return geometryFlags;
+    }
+
+    vk::GeometryInstanceFlagsKHR determineInstanceFlags(ext::InstanceFlags flags)
+    {
+        using InstanceFlags = vk::GeometryInstanceFlagBitsKHR;
+        vk::GeometryInstanceFlagsKHR instanceFlags{};
+        if (flags & ext::InstanceFlags::triangleCullDisable) instanceFlags |= InstanceFlags::eTriangleFacingCullDisable;
+        if (flags & ext::InstanceFlags::triangleFlipFacing) instanceFlags |= InstanceFlags::eTriangleFlipFacing;
+        if (flags & ext::InstanceFlags::forceOpaque) instanceFlags |= InstanceFlags::eForceOpaque;
+        if (flags & ext::InstanceFlags::forceNoOpaque) instanceFlags |= InstanceFlags::eForceNoOpaque;
+        return instanceFlags;
+    }
 }  // namespace
 
 namespace /*init vulkan objects*/
 {
-    static const std::array<const char *, 1> vulkanLayers = {"VK_LAYER_KHRONOS_validation"};
-    vk::Instance createInstance(VulkanWSI const& wsi)
+    std::optional<VulkanWSI> createWSI(bool headless)
+    {
+        if (headless) return std::nullopt;
+        return std::optional<VulkanWSI>(std::in_place);
+    }
+
+    // Validation is optional, so that TGA also starts on systems without the Vulkan SDK (e.g. lavapipe in CI)
+    bool validationAvailable()
+    {
+        auto layers = vk::enumerateInstanceLayerProperties();
+        auto extensions = vk::enumerateInstanceExtensionProperties();
+        return std::any_of(layers.begin(), layers.end(),
+                           [](vk::LayerProperties const& props) {
+                               return std::strcmp(props.layerName.data(), "VK_LAYER_KHRONOS_validation") == 0;
+                           }) &&
+               std::any_of(extensions.begin(), extensions.end(), [](vk::ExtensionProperties const& props) {
+                   return std::strcmp(props.extensionName.data(), VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0;
+               });
+    }
+
+    std::vector<const char *> vulkanLayers(bool withValidation)
+    {
+        if (!withValidation) return {};
+        return {"VK_LAYER_KHRONOS_validation"};
+    }
+
+    vk::Instance createInstance(std::optional<VulkanWSI> const& wsi, bool withValidation)
     {
         vk::InstanceCreateFlags iFlags{};
 
-        auto extensions = wsi.getRequiredExtensions();
-        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        // Without WSI no surface extensions are needed
+        std::vector<const char *> extensions;
+        if (wsi) extensions = wsi->getRequiredExtensions();
+        if (withValidation) extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #ifdef __APPLE__
         extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
         iFlags = static_cast<vk::InstanceCreateFlagBits>(VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR);
 #endif
         vk::ApplicationInfo appInfo("TGA", 1, "TGA", 1, VK_API_VERSION_1_2);
+        auto layers = vulkanLayers(withValidation);
         auto instance = vk::createInstance(vk::InstanceCreateInfo()
                                                .setPApplicationInfo(&appInfo)
-                                               .setPEnabledLayerNames(vulkanLayers)
+                                               .setPEnabledLayerNames(layers)
                                                .setPEnabledExtensionNames(extensions)
                                                .setFlags(iFlags));
         loadVkInstanceExtensions(instance);
         return instance;
     }
 
-    vk::DebugUtilsMessengerEXT createDebugMessenger(vk::Instance& instance)
+    vk::DebugUtilsMessengerEXT createDebugMessenger(vk::Instance& instance, bool withValidation)
     {
+        if (!withValidation) return {};
         using MsgSeverity = vk::DebugUtilsMessageSeverityFlagBitsEXT;
         using MsgType = vk::DebugUtilsMessageTypeFlagBitsEXT;
         return instance.createDebugUtilsMessengerEXT(
@@ -213,7 +352,52 @@ namespace /*init vulkan objects*/
         throw std::runtime_error("GPU does not support Queue with graphics and compute");
     }
 
-    vk::Device createDevice(vk::PhysicalDevice& gpu, uint32_t renderQueueFamily)
+    vkData::DeviceFeatures determineDeviceFeatures(vk::PhysicalDevice& gpu)
+    {
+        auto availableExtensions = gpu.enumerateDeviceExtensionProperties();
+        auto isAvailable = [&](const char *extension) {
+            return std::any_of(availableExtensions.begin(), availableExtensions.end(),
+                               [&](vk::ExtensionProperties const& props) {
+                                   return std::strcmp(props.extensionName.data(), extension) == 0;
+                               });
+        };
+
+        vk::PhysicalDeviceFeatures2 features;
+        vk::PhysicalDeviceVulkan12Features features_12;
+        vk::PhysicalDeviceRayQueryFeaturesKHR rayQueryFeature;
+        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicStateFeature;
+        features.pNext = &features_12;
+        features_12.pNext = &rayQueryFeature;
+        rayQueryFeature.pNext = &dynamicStateFeature;
+        gpu.getFeatures2(&features);
+
+        vkData::DeviceFeatures deviceFeatures;
+        deviceFeatures.rayQuery = rayQueryFeature.rayQuery;
+        if (deviceFeatures.rayQuery) {
+            using ASProperties = vk::PhysicalDeviceAccelerationStructurePropertiesKHR;
+            deviceFeatures.minScratchOffsetAlignment = gpu.getProperties2<vk::PhysicalDeviceProperties2, ASProperties>()
+                                                           .get<ASProperties>()
+                                                           .minAccelerationStructureScratchOffsetAlignment;
+        }
+        deviceFeatures.extendedDynamicState =
+            isAvailable(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) && dynamicStateFeature.extendedDynamicState;
+        // Descriptor indexing is core in Vulkan 1.2, the Vulkan12Features are enabled when the device is created
+        deviceFeatures.bindless = features_12.runtimeDescriptorArray && features_12.descriptorBindingPartiallyBound &&
+                                  features_12.descriptorBindingSampledImageUpdateAfterBind &&
+                                  features_12.descriptorBindingStorageImageUpdateAfterBind &&
+                                  features_12.descriptorBindingStorageBufferUpdateAfterBind;
+
+        deviceFeatures.pushDescriptor = isAvailable(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+        if (deviceFeatures.pushDescriptor)
+            deviceFeatures.maxPushDescriptors =
+                gpu.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDevicePushDescriptorPropertiesKHR>()
+                    .get<vk::PhysicalDevicePushDescriptorPropertiesKHR>()
+                    .maxPushDescriptors;
+        return deviceFeatures;
+    }
+
+    vk::Device createDevice(vk::PhysicalDevice& gpu, uint32_t renderQueueFamily,
+                            vkData::DeviceFeatures const& deviceFeatures, bool withSwapchain, bool withValidation)
     {
         vk::PhysicalDeviceFeatures2 features;
         vk::PhysicalDeviceVulkan11Features features_11;
@@ -228,10 +412,9 @@ namespace /*init vulkan objects*/
 
         auto extensions = [](bool withRayQuerySupport) -> std::vector<const char *> {
             if (!withRayQuerySupport)
-                return {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+                return {};
             else
-                return {VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-                        // Ray Query Extension
+                return {// Ray Query Extension
                         VK_KHR_RAY_QUERY_EXTENSION_NAME, VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
                         // Required by VK_KHR_acceleration_structure
                         VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME, VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
@@ -240,13 +423,23 @@ namespace /*init vulkan objects*/
                         VK_KHR_SPIRV_1_4_EXTENSION_NAME,
                         // Required by VK_KHR_spirv_1_4
                         VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME};
-        }(rayQueryFeature.rayQuery);
-        if (rayQueryFeature.rayQuery) std::cout << "Vulkan RayQuery extension enabled\n";
+        }(deviceFeatures.rayQuery);
+        if (deviceFeatures.rayQuery) std::cout << "Vulkan RayQuery extension enabled\n";
+
+        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicStateFeature{VK_TRUE};
+        if (deviceFeatures.extendedDynamicState) {
+            extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+            dynamicStateFeature.pNext = features.pNext;
+            features.pNext = &dynamicStateFeature;
+        }
+        if (deviceFeatures.pushDescriptor) extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+        if (withSwapchain) extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
 #ifdef __APPLE_
         extensions.push_back(VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME);
 #endif
 
+        auto layers = vulkanLayers(withValidation);
         float queuePriority = 1.0f;
         std::array<vk::DeviceQueueCreateInfo, 1> queueInfos{
             vk::DeviceQueueCreateInfo({}, renderQueueFamily, 1, &queuePriority)};
@@ -255,7 +448,7 @@ namespace /*init vulkan objects*/
                                            .setPNext(&features)
                                            .setQueueCreateInfos(queueInfos)
                                            .setPEnabledExtensionNames(extensions)
-                                           .setPEnabledLayerNames(vulkanLayers));
+                                           .setPEnabledLayerNames(layers));
         loadVkDeviceExtensions(device);
         return device;
     }
@@ -304,6 +497,15 @@ namespace /*helper functions*/
 
     constexpr auto deviceMemoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
 
+    // Reads from cached memory are much faster than from write-combined memory
+    uint32_t getReadbackMemoryIndex(vk::PhysicalDevice& pDevice)
+    {
+        auto memoryIndex = getBestMemoryOfType(
+            pDevice, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached);
+        if (memoryIndex != std::numeric_limits<uint32_t>::max()) return memoryIndex;
+        return getBestMemoryOfType(pDevice, hostMemoryProperties);
+    }
+
     template <typename T>
     T toRawHandle(size_t value)
     {
@@ -323,6 +525,52 @@ namespace /*helper functions*/
         return index - 1;
     }
 
+    // Binds the pipeline of a pass together with the bindless table if its layout includes it
+    void bindPipeline(vk::CommandBuffer cmd, vk::PipelineBindPoint bindPoint, vk::Pipeline pipeline,
+                      vkData::Layout const& layout, vk::DescriptorSet bindlessSet)
+    {
+        cmd.bindPipeline(bindPoint, pipeline);
+        if (layout.bindlessTable)
+            cmd.bindDescriptorSets(bindPoint, layout.pipelineLayout, uint32_t(layout.setLayouts.size()), bindlessSet,
+                                   {});
+    }
+
+    // Fills the mip levels of a Texture by downsampling each level into the next. All levels stay in eGeneral
+    void recordMipChain(vk::CommandBuffer cmd, vkData::Texture const& data)
+    {
+        auto levelBarrier = [&](uint32_t level, vk::PipelineStageFlags srcStage) {
+            cmd.pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
+                                vk::ImageMemoryBarrier()
+                                    .setImage(data.image)
+                                    .setSrcAccessMask(vk::AccessFlagBits::eMemoryWrite)
+                                    .setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+                                    .setOldLayout(vk::ImageLayout::eGeneral)
+                                    .setNewLayout(vk::ImageLayout::eGeneral)
+                                    .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                                    .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                                    .setSubresourceRange({vk::ImageAspectFlagBits::eColor, level, 1, 0, data.layers}));
+        };
+
+        vk::Offset3D srcSize{int32_t(data.extent.width), int32_t(data.extent.height), int32_t(data.extent.depth)};
+        levelBarrier(0, vk::PipelineStageFlagBits::eAllCommands);
+        for (uint32_t level = 1; level < data.mipLevels; ++level) {
+            vk::Offset3D dstSize{std::max(srcSize.x / 2, 1), std::max(srcSize.y / 2, 1), std::max(srcSize.z / 2, 1)};
+            cmd.blitImage(data.image, vk::ImageLayout::eGeneral, data.image, vk::ImageLayout::eGeneral,
+                          vk::ImageBlit()
+                              .setSrcSubresource({vk::ImageAspectFlagBits::eColor, level - 1, 0, data.layers})
+                              .setSrcOffsets({vk::Offset3D{}, srcSize})
+                              .setDstSubresource({vk::ImageAspectFlagBits::eColor, level, 0, data.layers})
+                              .setDstOffsets({vk::Offset3D{}, dstSize}),
+                          data.mipmapFilter);
+            // The level that was just written is the source of the next blit
+            levelBarrier(level, vk::PipelineStageFlagBits::eTransfer);
+            srcSize = dstSize;
+        }
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, {}, {},
+                            layoutTransitionBarrier(data.image, vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral,
+                                                    vk::ImageAspectFlagBits::eColor));
+    }
+
     struct OneTimeCommand {
         vk::Device& device;
         vk::CommandPool& cmdPool;
@@ -354,25 +602,36 @@ namespace /*helper functions*/
 
 }  // namespace
 
-Interface::InternalState::InternalState()
-    : wsi(VulkanWSI()),                          // WSI determines part of required extensions
-      instance(createInstance(wsi)),             // Instance is entry point for Vulkan API
-      debugger(createDebugMessenger(instance)),  // A Debugger is nice to have
-      pDevice(choseGPU(instance)),               // A Physical Device is typically a GPU
+Interface::InternalState::InternalState(InterfaceInfo const& interfaceInfo)
+    : wsi(createWSI(interfaceInfo.headless)),                         // WSI determines part of required extensions
+      validation(interfaceInfo.validation && validationAvailable()),  // Only if the layer is installed
+      instance(createInstance(wsi, validation)),                      // Instance is entry point for Vulkan API
+      debugger(createDebugMessenger(instance, validation)),           // A Debugger is nice to have
+      pDevice(choseGPU(instance)),                                    // A Physical Device is typically a GPU
       hostMemoryIndex(getBestMemoryOfType(pDevice, hostMemoryProperties)),      // Shared Memory with driver
+      readbackMemoryIndex(getReadbackMemoryIndex(pDevice)),                     // Shared Memory for the host to read
       deviceMemoryIndex(getBestMemoryOfType(pDevice, deviceMemoryProperties)),  // basically VRAM
       renderQueueFamily(findUniversalQueueFamily(pDevice)),                     // A queue to rule them all
+      features(determineDeviceFeatures(pDevice)),                               // Optional capabilities
+      limits(pDevice.getProperties().limits),
 
-      device(createDevice(pDevice, renderQueueFamily)), renderQueue(device.getQueue(renderQueueFamily, 0)),
+      device(createDevice(pDevice, renderQueueFamily, features, wsi.has_value(), validation)),
+      renderQueue(device.getQueue(renderQueueFamily, 0)),
       cmdPool(device.createCommandPool({vk::CommandPoolCreateFlagBits::eResetCommandBuffer, renderQueueFamily}))
 {}
 
+VulkanWSI& Interface::InternalState::getWSI()
+{
+    if (!wsi) throw std::runtime_error("[TGA Vulkan] Windows are not available in a headless Interface");
+    return *wsi;
+}
+
 // clang-format off
 vkData::Shader& Interface::InternalState::getData(Shader handle) {return shaders[dataIndexFromRawHandle<TgaShader>(handle)]; }
 vkData::Buffer& Interface::InternalState::getData(Buffer handle) {return buffers[dataIndexFromRawHandle<TgaBuffer>(handle)]; }
 vkData::StagingBuffer& Interface::InternalState::getData(StagingBuffer handle) {return stagingBuffers[dataIndexFromRawHandle<TgaStagingBuffer>(handle)]; }
 vkData::Texture& Interface::InternalState::getData(Texture handle) {return textures[dataIndexFromRawHandle<TgaTexture>(handle)]; }
-vkData::Window& Interface::InternalState::getData(Window handle) {return wsi.getWindow(handle); }
+vkData::Window& Interface::InternalState::getData(Window handle) {return getWSI().getWindow(handle); }
 vkData::InputSet& Interface::InternalState::getData(InputSet handle) {return inputSets[dataIndexFromRawHandle<TgaInputSet>(handle)]; }
 vkData::RenderPass& Interface::InternalState::getData(RenderPass handle) {return renderPasses[dataIndexFromRawHandle<TgaRenderPass>(handle)]; }
 vkData::ComputePass& Interface::InternalState::getData(ComputePass handle) {return computePasses[dataIndexFromRawHandle<TgaComputePass>(handle)]; }
@@ -381,7 +640,327 @@ vkData::ext::AccelerationStructure& Interface::InternalState::getData(ext::TopLe
 vkData::ext::AccelerationStructure& Interface::InternalState::getData(ext::BottomLevelAccelerationStructure handle){ return acclerationStructures[dataIndexFromRawHandle<TgaBottomLevelAccelerationStructure>(handle)];};
 // clang-format on
 
-Interface::Interface() : state(std::make_unique<InternalState>()) { std::cout << "TGA Vulkan: Interface opened\n"; }
+vkData::Layout Interface::InternalState::createLayout(InputLayout const& inputLayout, bool withBindlessTable)
+{
+    std::vector<vk::DescriptorSetLayout> descriptorSetLayouts{};
+    // The types need to be remembered since it is can't be infered from the input later
+    std::vector<std::vector<vk::DescriptorType>> setDescriptorTypes{};
+    std::vector<vkData::DescriptorSource> setSources{};
+    for (auto& setLayout : inputLayout) {
+        std::vector<vk::DescriptorSetLayoutBinding> bindings{};
+        std::vector<vk::DescriptorType> bindingTypes{};
+        uint32_t descriptorCount{0};
+        for (uint32_t i = 0; i < setLayout.bindingLayouts.size(); ++i) {
+            auto& bindingLayout = setLayout.bindingLayouts[i];
+            auto type = [&]() {
+                switch (bindingLayout.type) {
+                    case tga::BindingType::sampler: return vk::DescriptorType::eCombinedImageSampler;
+                    case tga::BindingType::storageBuffer: return vk::DescriptorType::eStorageBuffer;
+                    case tga::BindingType::uniformBuffer: return vk::DescriptorType::eUniformBuffer;
+                    case tga::BindingType::storageImage: return vk::DescriptorType::eStorageImage;
+                    case tga::BindingType::accelerationStructure: return vk::DescriptorType::eAccelerationStructureKHR;
+                    case tga::BindingType::inputAttachment: return vk::DescriptorType::eInputAttachment;
+                };
+                return vk::DescriptorType::eCombinedImageSampler;
+            }();
+            // Input attachments can only be read by the fragment shader
+            auto stageFlags = type == vk::DescriptorType::eInputAttachment ? vk::ShaderStageFlagBits::eFragment
+                                                                           : vk::ShaderStageFlagBits::eAll;
+            bindings.push_back(vk::DescriptorSetLayoutBinding(i, type, bindingLayout.count, stageFlags));
+            bindingTypes.push_back(type);
+            descriptorCount += bindingLayout.count;
+        }
+
+        // Only one push descriptor set is allowed per pipeline, further push-only sets use the transient arena
+        auto source = vkData::DescriptorSource::inputSet;
+        if (setLayout.pushOnly) {
+            bool canPush = features.pushDescriptor && descriptorCount <= features.maxPushDescriptors &&
+                           std::find(setSources.begin(), setSources.end(),
+                                     vkData::DescriptorSource::pushDescriptor) == setSources.end();
+            source = canPush ? vkData::DescriptorSource::pushDescriptor : vkData::DescriptorSource::transient;
+        }
+        vk::DescriptorSetLayoutCreateFlags flags{};
+        if (source == vkData::DescriptorSource::pushDescriptor)
+            flags = vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR;
+
+        setDescriptorTypes.push_back(std::move(bindingTypes));
+        setSources.push_back(source);
+        descriptorSetLayouts.push_back(device.createDescriptorSetLayout({flags, bindings}));
+    }
+
+    // The table is owned by the Interface, so it is not part of the setLayouts that are destroyed with the Layout
+    auto pipelineSetLayouts = descriptorSetLayouts;
+    if (withBindlessTable) pipelineSetLayouts.push_back(getBindlessTable().setLayout);
+    auto pipelineLayout = device.createPipelineLayout({{}, pipelineSetLayouts});
+
+    // Every set layout gets its own allocator so that sets of the same layout can be recycled
+    for (size_t i = 0; i < descriptorSetLayouts.size(); ++i) {
+        if (setSources[i] != vkData::DescriptorSource::inputSet) continue;
+        std::map<vk::DescriptorType, uint32_t> descriptorCounts;
+        for (uint32_t j = 0; j < inputLayout[i].bindingLayouts.size(); ++j)
+            descriptorCounts[setDescriptorTypes[i][j]] += inputLayout[i].bindingLayouts[j].count;
+
+        vkData::DescriptorSetAllocator allocator{};
+        for (auto& [type, count] : descriptorCounts)
+            if (count) allocator.setPoolSizes.push_back({type, count});
+        descriptorSetAllocators.emplace(static_cast<VkDescriptorSetLayout>(descriptorSetLayouts[i]),
+                                        std::move(allocator));
+        descriptorUpdateTemplates.emplace(static_cast<VkDescriptorSetLayout>(descriptorSetLayouts[i]),
+                                          vkData::DescriptorUpdateTemplates{setDescriptorTypes[i], {}});
+    }
+    return {pipelineLayout, std::move(descriptorSetLayouts), std::move(setDescriptorTypes), std::move(setSources),
+            withBindlessTable};
+}
+
+vkData::Layout& Interface::InternalState::getLayout(InputSetInfo const& inputSetInfo)
+{
+    if (auto computePass = std::get_if<ComputePass>(&inputSetInfo.targetPass)) return getData(*computePass).layout;
+
+    auto& subpasses = getData(std::get<RenderPass>(inputSetInfo.targetPass)).subpasses;
+    if (inputSetInfo.subpass >= subpasses.size())
+        throw std::runtime_error("[TGA Vulkan] Subpass " + std::to_string(inputSetInfo.subpass) +
+                                 " is not part of the RenderPass");
+    return subpasses[inputSetInfo.subpass].layout;
+}
+
+vkData::BindlessTable& Interface::InternalState::getBindlessTable()
+{
+    using Table = vkData::BindlessTable;
+    if (bindlessTable.setLayout) return bindlessTable;
+    if (!features.bindless)
+        throw std::runtime_error("[TGA Vulkan] The bindless table requires descriptor indexing, which is not supported "
+                                 "on this system");
+
+    // The arrays are as large as the limits for update-after-bind descriptors allow
+    auto properties = pDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>()
+                          .get<vk::PhysicalDeviceVulkan12Properties>();
+    auto resourceBudget = properties.maxPerStageUpdateAfterBindResources / 3;
+    auto& maxTextures = bindlessTable.maxTextures;
+    maxTextures = std::min({Table::defaultMaxTextures, resourceBudget,
+                            properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                            properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                            properties.maxPerStageDescriptorUpdateAfterBindStorageImages,
+                            properties.maxDescriptorSetUpdateAfterBindSamplers,
+                            properties.maxDescriptorSetUpdateAfterBindSampledImages,
+                            properties.maxDescriptorSetUpdateAfterBindStorageImages});
+    auto& maxBuffers = bindlessTable.maxBuffers;
+    maxBuffers = std::min({Table::defaultMaxBuffers, resourceBudget,
+                           properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                           properties.maxDescriptorSetUpdateAfterBindStorageBuffers});
+
+    std::array<vk::DescriptorSetLayoutBinding, 3> bindings{
+        vk::DescriptorSetLayoutBinding(Table::sampledImageBinding, vk::DescriptorType::eCombinedImageSampler,
+                                       maxTextures, vk::ShaderStageFlagBits::eAll),
+        vk::DescriptorSetLayoutBinding(Table::storageImageBinding, vk::DescriptorType::eStorageImage, maxTextures,
+                                       vk::ShaderStageFlagBits::eAll),
+        vk::DescriptorSetLayoutBinding(Table::storageBufferBinding, vk::DescriptorType::eStorageBuffer, maxBuffers,
+                                       vk::ShaderStageFlagBits::eAll)};
+    vk::DescriptorBindingFlags bindingFlag{vk::DescriptorBindingFlagBits::ePartiallyBound |
+                                           vk::DescriptorBindingFlagBits::eUpdateAfterBind};
+    std::array<vk::DescriptorBindingFlags, 3> bindingFlags{bindingFlag, bindingFlag, bindingFlag};
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{bindingFlags};
+
+    bindlessTable.setLayout = device.createDescriptorSetLayout(
+        vk::DescriptorSetLayoutCreateInfo(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, bindings)
+            .setPNext(&bindingFlagsInfo));
+
+    std::array<vk::DescriptorPoolSize, 3> poolSizes{
+        vk::DescriptorPoolSize{vk::DescriptorType::eCombinedImageSampler, maxTextures},
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage, maxTextures},
+        vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, maxBuffers}};
+    bindlessTable.descriptorPool = device.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, 1, poolSizes));
+    bindlessTable.descriptorSet = device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo()
+                                                                    .setDescriptorPool(bindlessTable.descriptorPool)
+                                                                    .setDescriptorSetCount(1)
+                                                                    .setSetLayouts(bindlessTable.setLayout))[0];
+    return bindlessTable;
+}
+
+void Interface::InternalState::destroyLayout(vkData::Layout& layout)
+{
+    for (auto& setLayout : layout.setLayouts) {
+        auto allocator = descriptorSetAllocators.find(static_cast<VkDescriptorSetLayout>(setLayout));
+        if (allocator != descriptorSetAllocators.end()) {
+            for (auto& pool : allocator->second.pools) device.destroy(pool);
+            descriptorSetAllocators.erase(allocator);
+        }
+        auto updateTemplates = descriptorUpdateTemplates.find(static_cast<VkDescriptorSetLayout>(setLayout));
+        if (updateTemplates != descriptorUpdateTemplates.end()) {
+            for (auto& [key, updateTemplate] : updateTemplates->second.templates) device.destroy(updateTemplate);
+            descriptorUpdateTemplates.erase(updateTemplates);
+        }
+        // InputSets outlive their pools, they can only be freed from here on
+        for (auto& inputSet : inputSets.data)
+            if (inputSet.setLayout == setLayout) inputSet.setLayout = vk::DescriptorSetLayout{};
+        device.destroy(setLayout);
+    }
+    device.destroy(layout.pipelineLayout);
+}
+
+vk::DescriptorSet Interface::InternalState::allocateDescriptorSet(vk::DescriptorSetLayout setLayout)
+{
+    auto& allocator = descriptorSetAllocators.at(static_cast<VkDescriptorSetLayout>(setLayout));
+    if (!allocator.freeSets.empty()) {
+        auto descriptorSet = allocator.freeSets.back();
+        allocator.freeSets.pop_back();
+        return descriptorSet;
+    }
+
+    if (!allocator.remainingSets) {
+        // Grow geometrically so that layouts with many sets end up with few pools
+        if (!allocator.pools.empty())
+            allocator.setsPerPool =
+                std::min(allocator.setsPerPool * 2, vkData::DescriptorSetAllocator::maxSetsPerPool);
+
+        auto poolSizes = allocator.setPoolSizes;
+        for (auto& poolSize : poolSizes) poolSize.descriptorCount *= allocator.setsPerPool;
+        allocator.pools.push_back(device.createDescriptorPool(
+            vk::DescriptorPoolCreateInfo().setMaxSets(allocator.setsPerPool).setPoolSizes(poolSizes)));
+        allocator.remainingSets = allocator.setsPerPool;
+    }
+
+    --allocator.remainingSets;
+    return device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo()
+                                             .setDescriptorPool(allocator.pools.back())
+                                             .setDescriptorSetCount(1)
+                                             .setSetLayouts(setLayout))[0];
+}
+
+vk::DescriptorSet Interface::InternalState::allocateTransientDescriptorSet(vkData::CommandBuffer& cmdData,
+                                                                          vk::DescriptorSetLayout setLayout)
+{
+    using Arena = vkData::TransientDescriptorArena;
+    auto& arena = cmdData.transientDescriptors;
+
+    for (; arena.currentPool < arena.pools.size(); ++arena.currentPool) {
+        try {
+            return device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo()
+                                                     .setDescriptorPool(arena.pools[arena.currentPool])
+                                                     .setDescriptorSetCount(1)
+                                                     .setSetLayouts(setLayout))[0];
+        } catch (vk::OutOfPoolMemoryError&) {
+        } catch (vk::FragmentedPoolError&) {
+        }
+    }
+
+    // All pools of the arena are exhausted, a pool that holds a mix of every descriptor type is added
+    std::vector<vk::DescriptorPoolSize> poolSizes{
+        {vk::DescriptorType::eUniformBuffer, Arena::descriptorsPerType},
+        {vk::DescriptorType::eStorageBuffer, Arena::descriptorsPerType},
+        {vk::DescriptorType::eCombinedImageSampler, Arena::descriptorsPerType},
+        {vk::DescriptorType::eStorageImage, Arena::descriptorsPerType},
+        {vk::DescriptorType::eInputAttachment, Arena::descriptorsPerType}};
+    if (features.rayQuery)
+        poolSizes.push_back({vk::DescriptorType::eAccelerationStructureKHR, Arena::descriptorsPerType});
+
+    arena.pools.push_back(device.createDescriptorPool(
+        vk::DescriptorPoolCreateInfo().setMaxSets(Arena::setsPerPool).setPoolSizes(poolSizes)));
+    arena.currentPool = arena.pools.size() - 1;
+    return device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo()
+                                             .setDescriptorPool(arena.pools.back())
+                                             .setDescriptorSetCount(1)
+                                             .setSetLayouts(setLayout))[0];
+}
+
+vkData::DescriptorWrites Interface::InternalState::collectWrites(
+    vk::DescriptorSet descriptorSet, std::vector<vk::DescriptorType> const& descriptorTypes,
+    std::vector<Binding> const& bindings)
+{
+    // The infos are reserved up front, the writes point into them
+    vkData::DescriptorWrites writes;
+    writes.imageInfos.reserve(bindings.size());
+    writes.bufferInfos.reserve(bindings.size());
+    writes.accelerationStructureInfos.reserve(bindings.size());
+    writes.writeSets.reserve(bindings.size());
+    for (auto& binding : bindings) {
+        auto& writeSet = writes.writeSets.emplace_back();
+        writeSet.setDstSet(descriptorSet)
+            .setDescriptorCount(1)
+            .setDstBinding(binding.slot)
+            .setDstArrayElement(binding.arrayElement)
+            .setDescriptorType(descriptorTypes[binding.slot]);
+
+        if (auto texture = std::get_if<Texture>(&binding.resource)) {
+            auto& data = getData(*texture);
+            bool isSampled = writeSet.descriptorType == vk::DescriptorType::eCombinedImageSampler;
+            auto& imageInfo = writes.imageInfos.emplace_back()
+                                  .setImageLayout(vk::ImageLayout::eGeneral)
+                                  .setImageView(isSampled ? data.imageView : data.baseLevelView)
+                                  .setSampler(data.sampler);
+            writeSet.setImageInfo(imageInfo);
+        } else if (auto buffer = std::get_if<Buffer>(&binding.resource)) {
+            auto& bufferInfo = writes.bufferInfos.emplace_back(describeBufferRange(binding, writeSet.descriptorType));
+            writeSet.setBufferInfo(bufferInfo);
+        } else if (auto tlas = std::get_if<ext::TopLevelAccelerationStructure>(&binding.resource)) {
+            auto& data = getData(*tlas);
+            auto& acWriteSet = writes.accelerationStructureInfos.emplace_back();
+            acWriteSet.setAccelerationStructures(data.accelerationStructure);
+            writeSet.setPNext(&acWriteSet);
+        }
+    }
+    return writes;
+}
+
+void Interface::InternalState::writeBindings(vk::DescriptorSet descriptorSet,
+                                             std::vector<vk::DescriptorType> const& descriptorTypes,
+                                             std::vector<Binding> const& bindings)
+{
+    device.updateDescriptorSets(collectWrites(descriptorSet, descriptorTypes, bindings).writeSets, {});
+}
+
+vk::DescriptorBufferInfo Interface::InternalState::describeBufferRange(Binding const& binding,
+                                                                       vk::DescriptorType descriptorType)
+{
+    auto& data = getData(std::get<Buffer>(binding.resource));
+    if (!binding.offset && !binding.range) return {data.buffer, 0, data.size};
+
+    bool isUniform = descriptorType == vk::DescriptorType::eUniformBuffer;
+    vk::DeviceSize alignment =
+        isUniform ? limits.minUniformBufferOffsetAlignment : limits.minStorageBufferOffsetAlignment;
+    vk::DeviceSize maxRange = isUniform ? limits.maxUniformBufferRange : limits.maxStorageBufferRange;
+    if (binding.offset % alignment)
+        throw std::runtime_error("[TGA Vulkan] Binding offset " + std::to_string(binding.offset) +
+                                 " is not a multiple of the required alignment of " + std::to_string(alignment));
+    if (binding.offset >= data.size)
+        throw std::runtime_error("[TGA Vulkan] Binding offset " + std::to_string(binding.offset) +
+                                 " is outside of the Buffer of size " + std::to_string(data.size));
+    // A range of 0 binds the rest of the Buffer, which is subject to the same limit as an explicit range
+    vk::DeviceSize range = binding.range ? binding.range : data.size - binding.offset;
+
+    if (binding.offset + range > data.size)
+        throw std::runtime_error("[TGA Vulkan] Binding range [" + std::to_string(binding.offset) + ", " +
+                                 std::to_string(binding.offset + range) + ") exceeds the Buffer of size " +
+                                 std::to_string(data.size));
+    if (range > maxRange)
+        throw std::runtime_error("[TGA Vulkan] Binding range of " + std::to_string(range) +
+                                 " bytes exceeds the limit of " + std::to_string(maxRange) + " bytes");
+    return {data.buffer, binding.offset, range};
+}
+
+vkData::DescriptorInfo Interface::InternalState::describeBinding(Binding const& binding,
+                                                                 vk::DescriptorType descriptorType)
+{
+    vkData::DescriptorInfo info{};
+    if (auto texture = std::get_if<Texture>(&binding.resource)) {
+        auto& data = getData(*texture);
+        bool isSampled = descriptorType == vk::DescriptorType::eCombinedImageSampler;
+        info.image = vk::DescriptorImageInfo(data.sampler, isSampled ? data.imageView : data.baseLevelView,
+                                             vk::ImageLayout::eGeneral);
+    } else if (std::holds_alternative<Buffer>(binding.resource)) {
+        info.buffer = describeBufferRange(binding, descriptorType);
+    } else if (auto tlas = std::get_if<ext::TopLevelAccelerationStructure>(&binding.resource)) {
+        info.accelerationStructure = static_cast<VkAccelerationStructureKHR>(getData(*tlas).accelerationStructure);
+    }
+    return info;
+}
+
+Interface::Interface() : Interface(InterfaceInfo{}) {}
+
+Interface::Interface(InterfaceInfo const& interfaceInfo) : state(std::make_unique<InternalState>(interfaceInfo))
+{
+    std::cout << "TGA Vulkan: " << (interfaceInfo.headless ? "Headless " : "") << "Interface opened\n";
+}
 
 Interface::~Interface()
 {
@@ -402,9 +981,20 @@ Interface::~Interface()
     for (size_t i = 0; i < state->acclerationStructures.size(); ++i)
         free(toRawHandle<TgaTopLevelAccelerationStructure>(i));
 
-    while (!wsi.windows.empty()) free(wsi.windows.begin()->first);
+    if (wsi)
+        while (!wsi->windows.empty()) free(wsi->windows.begin()->first);
 
     device.waitIdle();
+    state->releaseFinishedBuilds(true);
+    for (auto& slot : state->readbacks.slots) {
+        device.destroy(slot.buffer);
+        device.free(slot.memory);
+        device.destroy(slot.completionFence);
+    }
+    if (state->bindlessTable.setLayout) {
+        device.destroy(state->bindlessTable.descriptorPool);
+        device.destroy(state->bindlessTable.setLayout);
+    }
     device.destroy(cmdPool);
     device.destroy();
     if (debugger) instance.destroy(debugger);
@@ -499,16 +1089,37 @@ Texture Interface::createTexture(TextureInfo const& textureInfo)
 
     vk::ImageType imageType{texType == TextureType::_3D ? vk::ImageType::e3D : vk::ImageType::e2D};
 
+    // A full chain halves the largest dimension until it reaches 1
+    uint32_t maxMipLevels{1};
+    for (uint32_t size = std::max({extent.width, extent.height, extent.depth}); size > 1; size >>= 1) ++maxMipLevels;
+    uint32_t mipLevels = textureInfo.mipLevels == TextureInfo::autoMipLevels
+                             ? maxMipLevels
+                             : std::clamp(textureInfo.mipLevels, 1u, maxMipLevels);
+    vk::Filter mipmapFilter{vk::Filter::eNearest};
+    bool isCompressed = isBlockCompressed(textureInfo.format);
+    // Levels of a block-compressed format can't be rendered or blitted to, they have to come with the srcData
+    bool generateMips = mipLevels > 1 && !textureInfo.srcDataMipChain;
+    if (isCompressed && generateMips)
+        throw std::runtime_error("[TGA Vulkan] Mip levels of the block-compressed format " + vk::to_string(format) +
+                                 " can't be generated, provide them in srcData with srcDataMipChain");
+
     vk::ImageUsageFlags usageFlags{vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst |
                                    vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eColorAttachment |
-                                   vk::ImageUsageFlagBits::eStorage};
+                                   vk::ImageUsageFlagBits::eInputAttachment | vk::ImageUsageFlagBits::eStorage};
+    if (isCompressed)
+        usageFlags = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst |
+                     vk::ImageUsageFlagBits::eTransferSrc;
     // Usage Flags start with everything but some properties might not be available
     {
         auto formatFeatures = pDevice.getFormatProperties(format).optimalTilingFeatures;
         // This is mandatory, since it's otherwise really useles
-        if (!(formatFeatures & vk::FormatFeatureFlagBits::eSampledImage))
+        if (!(formatFeatures & vk::FormatFeatureFlagBits::eSampledImage)) {
+            if (isCompressed)
+                throw std::runtime_error("[TGA Vulkan] Block-compressed format " + vk::to_string(format) +
+                                         " is not supported on this System, use an uncompressed format instead");
             throw std::runtime_error("[TGA Vulkan] Chosen Image Format: " + vk::to_string(format) +
                                      " cannot be used as Texture on this System");
+        }
         // The following are only required if you want to use them for a specific purpose
         // But if you don't it's fine, if you do, expect to get an error
         if (!(formatFeatures & vk::FormatFeatureFlagBits::eTransferDst)) {
@@ -516,10 +1127,11 @@ Texture Interface::createTexture(TextureInfo const& textureInfo)
                       << "\" does not support being filled via buffer-to-image-copy on this system\n";
             usageFlags &= ~vk::ImageUsageFlagBits::eTransferDst;
         }
-        if (!(formatFeatures & vk::FormatFeatureFlagBits::eColorAttachment)) {
+        if ((usageFlags & vk::ImageUsageFlagBits::eColorAttachment) &&
+            !(formatFeatures & vk::FormatFeatureFlagBits::eColorAttachment)) {
             std::cerr << "[TGA Vulkan] Warning: Image format \"" << vk::to_string(format)
                       << "\" does not support being used as a render target on this system\n";
-            usageFlags &= ~vk::ImageUsageFlagBits::eColorAttachment;
+            usageFlags &= ~(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment);
         }
         if (!(formatFeatures & vk::FormatFeatureFlagBits::eTransferSrc)) {
             std::cerr << "[TGA Vulkan] Warning: Image format \"" << vk::to_string(format)
@@ -527,11 +1139,19 @@ Texture Interface::createTexture(TextureInfo const& textureInfo)
             usageFlags &= ~vk::ImageUsageFlagBits::eTransferSrc;
         }
 
-        if (!(formatFeatures & vk::FormatFeatureFlagBits::eStorageImage)) {
+        if ((usageFlags & vk::ImageUsageFlagBits::eStorage) &&
+            !(formatFeatures & vk::FormatFeatureFlagBits::eStorageImage)) {
             std::cerr << "[TGA Vulkan] Warning: Image format \"" << vk::to_string(format)
                       << "\" does not support being used as a storage image on this system\n";
             usageFlags &= ~vk::ImageUsageFlagBits::eStorage;
         }
+
+        // Mip levels are generated with blits
+        constexpr auto blitFeatures = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst;
+        if (generateMips && (formatFeatures & blitFeatures) != blitFeatures)
+            throw std::runtime_error("[TGA Vulkan] Image format " + vk::to_string(format) +
+                                     " does not support generating mip levels on this system");
+        if (formatFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear) mipmapFilter = vk::Filter::eLinear;
     }
 
     vk::Image image = device.createImage(vk::ImageCreateInfo(textureInfo.textureType == TextureType::_Cube
@@ -540,7 +1160,7 @@ Texture Interface::createTexture(TextureInfo const& textureInfo)
                                              .setImageType(imageType)
                                              .setFormat(format)
                                              .setExtent(extent)
-                                             .setMipLevels(1)
+                                             .setMipLevels(mipLevels)
                                              .setArrayLayers(layers)
                                              .setUsage(usageFlags)
                                              .setTiling(vk::ImageTiling::eOptimal));
@@ -548,22 +1168,30 @@ Texture Interface::createTexture(TextureInfo const& textureInfo)
     vk::DeviceMemory memory = device.allocateMemory({mr.size, deviceMemoryIndex});
     device.bindImageMemory(image, memory, 0);
 
-    vk::ImageView view = device.createImageView(
-        vk::ImageViewCreateInfo()
-            .setImage(image)
-            .setViewType([&]() {
-                switch (textureInfo.textureType) {
-                    case TextureType::_2DArray: return vk::ImageViewType::e2DArray;
-                    case TextureType::_3D: return vk::ImageViewType::e3D;
-                    case TextureType::_Cube: return vk::ImageViewType::eCube;
-                    default /* TextureType::_2D*/: return vk::ImageViewType::e2D;
-                };
-            }())
-            .setFormat(format)
-            .setSubresourceRange(
-                vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor).setLayerCount(layers).setLevelCount(1)));
+    auto createView = [&](uint32_t levelCount) {
+        return device.createImageView(
+            vk::ImageViewCreateInfo()
+                .setImage(image)
+                .setViewType([&]() {
+                    switch (textureInfo.textureType) {
+                        case TextureType::_2DArray: return vk::ImageViewType::e2DArray;
+                        case TextureType::_3D: return vk::ImageViewType::e3D;
+                        case TextureType::_Cube: return vk::ImageViewType::eCube;
+                        default /* TextureType::_2D*/: return vk::ImageViewType::e2D;
+                    };
+                }())
+                .setFormat(format)
+                .setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor)
+                                         .setLayerCount(layers)
+                                         .setLevelCount(levelCount)));
+    };
+    vk::ImageView view = createView(mipLevels);
+    // Framebuffers and storage images can only access a single mip level
+    vk::ImageView baseLevelView = mipLevels > 1 ? createView(1) : view;
 
     vk::Filter filter{textureInfo.samplerMode == SamplerMode::linear ? vk::Filter::eLinear : vk::Filter::eNearest};
+    vk::SamplerMipmapMode mipmapMode{textureInfo.samplerMode == SamplerMode::linear ? vk::SamplerMipmapMode::eLinear
+                                                                                    : vk::SamplerMipmapMode::eNearest};
     vk::SamplerAddressMode addressMode{[&]() {
         switch (textureInfo.addressMode) {
             case AddressMode::clampEdge: return vk::SamplerAddressMode::eClampToEdge;
@@ -577,12 +1205,16 @@ Texture Interface::createTexture(TextureInfo const& textureInfo)
     vk::Sampler sampler = device.createSampler(vk::SamplerCreateInfo()
                                                    .setMinFilter(filter)
                                                    .setMagFilter(filter)
-                                                   .setMipmapMode(vk::SamplerMipmapMode::eLinear)
+                                                   .setMipmapMode(mipmapMode)
+                                                   .setMinLod(0)
+                                                   .setMaxLod(static_cast<float>(mipLevels))
                                                    .setAddressModeU(addressMode)
                                                    .setAddressModeV(addressMode)
                                                    .setAddressModeW(addressMode));
 
-    Texture handle{toRawHandle<TgaTexture>(textures.insert({image, view, memory, sampler, extent, format, {}}))};
+    Texture handle{toRawHandle<TgaTexture>(textures.insert(
+        {image, view, memory, sampler, extent, format, baseLevelView, mipLevels, layers, mipmapFilter,
+         textureInfo.format, {}}))};
 
     OneTimeCommand createTexture{device, cmdPool, renderQueue};
     if (textureInfo.srcData) {
@@ -591,16 +1223,26 @@ Texture Interface::createTexture(TextureInfo const& textureInfo)
             vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
             layoutTransitionBarrier(image, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
                                     vk::ImageAspectFlagBits::eColor));
-        createTexture.cmd.copyBufferToImage(stagingData.buffer, image, vk::ImageLayout::eTransferDstOptimal,
-                                            vk::BufferImageCopy()
-                                                .setBufferOffset(textureInfo.srcDataOffset)
-                                                .setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, layers})
-                                                .setImageExtent(extent));
+        // A mip chain in srcData is tightly packed, starting with the largest level
+        std::vector<vk::BufferImageCopy> copies;
+        vk::DeviceSize bufferOffset = textureInfo.srcDataOffset;
+        for (uint32_t level = 0; level < (textureInfo.srcDataMipChain ? mipLevels : 1); ++level) {
+            vk::Extent3D levelExtent{std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u),
+                                     std::max(extent.depth >> level, 1u)};
+            copies.push_back(vk::BufferImageCopy()
+                                 .setBufferOffset(bufferOffset)
+                                 .setImageSubresource({vk::ImageAspectFlagBits::eColor, level, 0, layers})
+                                 .setImageExtent(levelExtent));
+            bufferOffset += layers * formatImageSize(textureInfo.format, levelExtent.width, levelExtent.height,
+                                                     levelExtent.depth);
+        }
+        createTexture.cmd.copyBufferToImage(stagingData.buffer, image, vk::ImageLayout::eTransferDstOptimal, copies);
         createTexture.cmd.pipelineBarrier(
             vk::PipelineStageFlagBits::eTransfer,
             vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eComputeShader, {}, {}, {},
             layoutTransitionBarrier(image, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eGeneral,
                                     vk::ImageAspectFlagBits::eColor));
+        if (generateMips) recordMipChain(createTexture.cmd, state->getData(handle));
     } else {
         createTexture.cmd.pipelineBarrier(
             vk::PipelineStageFlagBits::eTopOfPipe,
@@ -616,7 +1258,7 @@ Window Interface::createWindow(WindowInfo const& windowInfo)
     auto& pDevice = state->pDevice;
     auto& device = state->device;
     auto& renderQueueFamily = state->renderQueueFamily;
-    auto& wsi = state->wsi;
+    auto& wsi = state->getWSI();
 
     auto& cmdPool = state->cmdPool;
 
@@ -662,91 +1304,21 @@ Window Interface::createWindow(WindowInfo const& windowInfo)
 }
 InputSet Interface::createInputSet(InputSetInfo const& inputSetInfo)
 {
-    auto& device = state->device;
-
-    auto& layoutData =
-        std::visit([&](auto& pass) -> vkData::Layout& { return state->getData(pass).layout; }, inputSetInfo.targetPass);
-    auto& descriptorTypes = layoutData.setDescriptorTypes[inputSetInfo.index];
-    auto& setLayouts = layoutData.setLayouts;
-    auto& inputSets = state->inputSets;
+    auto& layoutData = state->getLayout(inputSetInfo);
+    auto setLayout = layoutData.setLayouts[inputSetInfo.index];
+    if (layoutData.setSources[inputSetInfo.index] != vkData::DescriptorSource::inputSet)
+        throw std::runtime_error("[TGA Vulkan] InputSets can't be created for the push-only set " +
+                                 std::to_string(inputSetInfo.index) + ", use pushBindings instead");
 
     vk::PipelineBindPoint bindPoint = std::holds_alternative<tga::RenderPass>(inputSetInfo.targetPass)
                                           ? vk::PipelineBindPoint::eGraphics
                                           : vk::PipelineBindPoint::eCompute;
 
-    std::array<uint32_t, 5> poolSizeCounts{};
-    for (auto& binding : inputSetInfo.bindings) {
-        switch (descriptorTypes[binding.slot]) {
-            case vk::DescriptorType::eUniformBuffer: ++poolSizeCounts[0]; break;
-            case vk::DescriptorType::eStorageBuffer: ++poolSizeCounts[1]; break;
-            case vk::DescriptorType::eCombinedImageSampler: ++poolSizeCounts[2]; break;
-            case vk::DescriptorType::eStorageImage: ++poolSizeCounts[3]; break;
-            case vk::DescriptorType::eAccelerationStructureKHR: ++poolSizeCounts[4]; break;
-            default: break;
-        }
-    }
-
-    std::vector<vk::DescriptorPoolSize> poolSizes;
-    poolSizes.reserve(5);
-    for (size_t i = 0; i < poolSizeCounts.size(); ++i) {
-        if (!poolSizeCounts[i]) continue;
-        switch (i) {
-            case 0: poolSizes.push_back({vk::DescriptorType::eUniformBuffer, poolSizeCounts[i]}); break;
-            case 1: poolSizes.push_back({vk::DescriptorType::eStorageBuffer, poolSizeCounts[i]}); break;
-            case 2: poolSizes.push_back({vk::DescriptorType::eCombinedImageSampler, poolSizeCounts[i]}); break;
-            case 3: poolSizes.push_back({vk::DescriptorType::eStorageImage, poolSizeCounts[i]}); break;
-            case 4: poolSizes.push_back({vk::DescriptorType::eAccelerationStructureKHR, poolSizeCounts[i]}); break;
-        }
-    }
-
-    vk::DescriptorPool descriptorPool =
-        device.createDescriptorPool(vk::DescriptorPoolCreateInfo().setMaxSets(1).setPoolSizes(poolSizes));
-
-    vk::DescriptorSet descriptorSet =
-        device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo()
-                                          .setDescriptorPool(descriptorPool)
-                                          .setDescriptorSetCount(1)
-                                          .setSetLayouts(setLayouts[inputSetInfo.index]))[0];
-
-    std::vector<vk::DescriptorImageInfo> imageInfos;
-    imageInfos.reserve(inputSetInfo.bindings.size());
-    std::vector<vk::DescriptorBufferInfo> bufferInfos;
-    bufferInfos.reserve(inputSetInfo.bindings.size());
-
-    std::vector<vk::WriteDescriptorSet> writeSets;
-    writeSets.reserve(inputSetInfo.bindings.size());
-    std::vector<vk::WriteDescriptorSetAccelerationStructureKHR> accelerationStructsWriteSets;
-    accelerationStructsWriteSets.reserve(inputSetInfo.bindings.size());
-    for (auto& binding : inputSetInfo.bindings) {
-        auto& writeSet = writeSets.emplace_back();
-        writeSet.setDstSet(descriptorSet)
-            .setDescriptorCount(1)
-            .setDstBinding(binding.slot)
-            .setDstArrayElement(binding.arrayElement)
-            .setDescriptorType(descriptorTypes[binding.slot]);
-
-        if (auto texture = std::get_if<Texture>(&binding.resource)) {
-            auto& data = state->getData(*texture);
-            auto& imageInfo = imageInfos.emplace_back()
-                                  .setImageLayout(vk::ImageLayout::eGeneral)
-                                  .setImageView(data.imageView)
-                                  .setSampler(data.sampler);
-            writeSet.setImageInfo(imageInfo);
-        } else if (auto buffer = std::get_if<Buffer>(&binding.resource)) {
-            auto& data = state->getData(*buffer);
-            auto& bufferInfo = bufferInfos.emplace_back().setBuffer(data.buffer).setRange(data.size).setOffset(0);
-            writeSet.setBufferInfo(bufferInfo);
-        } else if (auto tlas = std::get_if<ext::TopLevelAccelerationStructure>(&binding.resource)) {
-            auto& data = state->getData(*tlas);
-            auto& acWriteSet = accelerationStructsWriteSets.emplace_back();
-            acWriteSet.setAccelerationStructures(data.accelerationStructure);
-            writeSet.setPNext(&acWriteSet);
-        }
-    }
-    device.updateDescriptorSets(writeSets, {});
+    auto descriptorSet = state->allocateDescriptorSet(setLayout);
+    state->writeBindings(descriptorSet, layoutData.setDescriptorTypes[inputSetInfo.index], inputSetInfo.bindings);
 
-    return tga::InputSet{toRawHandle<TgaInputSet>(
-        inputSets.insert({descriptorPool, descriptorSet, bindPoint, layoutData.pipelineLayout, inputSetInfo.index}))};
+    return tga::InputSet{toRawHandle<TgaInputSet>(state->inputSets.insert(
+        {descriptorSet, setLayout, bindPoint, layoutData.pipelineLayout, inputSetInfo.index}))};
 }
 
 RenderPass Interface::createRenderPass(RenderPassInfo const& renderPassInfo)
@@ -757,8 +1329,20 @@ RenderPass Interface::createRenderPass(RenderPassInfo const& renderPassInfo)
     auto& renderQueue = state->renderQueue;
     auto& renderPasses = state->renderPasses;
 
-    // This should be widely support. If it isn't, change it
-    constexpr auto depthFormat = vk::Format::eD32Sfloat;
+    if (renderPassInfo.dynamicStates != DynamicState::none && !state->features.extendedDynamicState)
+        throw std::runtime_error("[TGA Vulkan] Dynamic states were requested but extended dynamic state is not "
+                                 "supported on this system");
+    // Created up front so a missing feature is reported before any Vulkan object of the pass exists
+    if (renderPassInfo.bindlessTable) state->getBindlessTable();
+
+    auto& depthConfig = renderPassInfo.depthConfig;
+    bool hasDepthAttachment = depthConfig.format != DepthFormat::none;
+    vk::Format depthFormat = hasDepthAttachment ? findDepthFormat(state->pDevice, depthConfig.format)
+                                                : vk::Format::eUndefined;
+    vk::ImageAspectFlags depthAspect = vk::ImageAspectFlagBits::eDepth;
+    if (depthFormat == vk::Format::eD24UnormS8Uint || depthFormat == vk::Format::eD32SfloatS8Uint)
+        depthAspect |= vk::ImageAspectFlagBits::eStencil;
+
     // Creates a depth buffer for a render target
     auto initDepthBuffer = [&](vk::Extent2D area) -> vkData::DepthBuffer {
         vk::Image image = device.createImage(
@@ -772,21 +1356,64 @@ RenderPass Interface::createRenderPass(RenderPassInfo const& renderPassInfo)
         device.bindImageMemory(image, memory, 0);
         vk::ImageView view = device.createImageView(
             vk::ImageViewCreateInfo({}, image, vk::ImageViewType::e2D, depthFormat)
-                .setSubresourceRange(
-                    vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth).setLayerCount(1).setLevelCount(1)));
+                .setSubresourceRange(vk::ImageSubresourceRange(depthAspect).setLayerCount(1).setLevelCount(1)));
 
         OneTimeCommand{device, cmdPool, renderQueue}.cmd.pipelineBarrier(
             vk::PipelineStageFlagBits::eTopOfPipe,
             vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests, {}, {}, {},
             layoutTransitionBarrier(image, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal,
-                                    vk::ImageAspectFlagBits::eDepth));
+                                    depthAspect));
 
-        return {image, view, memory};
+        return {image, view, memory, depthFormat};
     };
+    // Depth buffers belong to a target and are reused by every RenderPass with the same depth format
+    auto getDepthBuffer = [&](std::vector<vkData::DepthBuffer>& depthBuffers, vk::Extent2D area) {
+        for (auto& depthBuffer : depthBuffers)
+            if (depthBuffer.format == depthFormat) return depthBuffer.imageView;
+        return depthBuffers.emplace_back(initDepthBuffer(area)).imageView;
+    };
+
+    vk::Extent2D renderArea;
+    if (auto texture = std::get_if<Texture>(&renderPassInfo.renderTarget)) {
+        auto& textureData = state->getData(*texture);
+        renderArea = vk::Extent2D{textureData.extent.width, textureData.extent.height};
+    } else if (auto window = std::get_if<Window>(&renderPassInfo.renderTarget)) {
+        renderArea = state->getData(*window).extent;
+    } else {
+        auto& referenceData = state->getData(std::get<std::vector<Texture>>(renderPassInfo.renderTarget)[0]);
+        renderArea = vk::Extent2D{referenceData.extent.width, referenceData.extent.height};
+    }
+
+    vk::ImageView depthView{};
+    if (hasDepthAttachment) {
+        std::vector<vkData::DepthBuffer> *depthBuffers;
+        vk::Extent2D depthArea;
+        if (auto texture = std::get_if<Texture>(&depthConfig.sharedWith)) {
+            auto& textureData = state->getData(*texture);
+            depthBuffers = &textureData.depthBuffers;
+            depthArea = vk::Extent2D{textureData.extent.width, textureData.extent.height};
+        } else if (auto window = std::get_if<Window>(&depthConfig.sharedWith)) {
+            auto& windowData = state->getData(*window);
+            depthBuffers = &windowData.depthBuffers;
+            depthArea = windowData.extent;
+        } else if (auto window = std::get_if<Window>(&renderPassInfo.renderTarget)) {
+            depthBuffers = &state->getData(*window).depthBuffers;
+            depthArea = renderArea;
+        } else if (auto texture = std::get_if<Texture>(&renderPassInfo.renderTarget)) {
+            depthBuffers = &state->getData(*texture).depthBuffers;
+            depthArea = renderArea;
+        } else {
+            depthBuffers = &state->getData(std::get<std::vector<Texture>>(renderPassInfo.renderTarget)[0]).depthBuffers;
+            depthArea = renderArea;
+        }
+        if (depthArea != renderArea)
+            throw std::runtime_error("[TGA Vulkan] Shared depth buffer and render target differ in size");
+        depthView = getDepthBuffer(*depthBuffers, depthArea);
+    }
 
     std::vector<vk::AttachmentDescription> attachmentDescs;
 
-    auto pushColorAttachment = [&](vk::Format format, vk::ImageLayout layout) {
+    auto pushColorAttachment = [&](vk::Format format, vk::ImageLayout layout, vk::AttachmentStoreOp storeOp) {
         attachmentDescs.push_back(vk::AttachmentDescription({}, format)
                                       .setInitialLayout(layout)
                                       .setFinalLayout(layout)
@@ -797,53 +1424,103 @@ RenderPass Interface::createRenderPass(RenderPassInfo const& renderPassInfo)
                                               default: return vk::AttachmentLoadOp::eLoad;
                                           }
                                       }())
-                                      .setStoreOp(vk::AttachmentStoreOp::eStore));
+                                      .setStoreOp(storeOp));
     };
 
     if (auto texture = std::get_if<Texture>(&renderPassInfo.renderTarget)) {
-        auto& textureData = state->getData(*texture);
-        if (!textureData.depthBuffer.image)
-            textureData.depthBuffer = initDepthBuffer({textureData.extent.width, textureData.extent.height});
-        pushColorAttachment(textureData.format, vk::ImageLayout::eGeneral);
-
+        pushColorAttachment(state->getData(*texture).format, vk::ImageLayout::eGeneral, vk::AttachmentStoreOp::eStore);
     } else if (auto window = std::get_if<Window>(&renderPassInfo.renderTarget)) {
-        auto& windowData = state->getData(*window);
-        if (!windowData.depthBuffer.image) windowData.depthBuffer = initDepthBuffer(windowData.extent);
-        pushColorAttachment(windowData.format, vk::ImageLayout::eColorAttachmentOptimal);
+        pushColorAttachment(state->getData(*window).format, vk::ImageLayout::eColorAttachmentOptimal,
+                            vk::AttachmentStoreOp::eStore);
     } else {
-        auto& targets = std::get<std::vector<Texture>>(renderPassInfo.renderTarget);
-        auto& referenceData = state->getData(targets[0]);
-        if (!referenceData.depthBuffer.image)
-            referenceData.depthBuffer = initDepthBuffer({referenceData.extent.width, referenceData.extent.height});
-        for (auto& target : targets) {
-            auto& textureData = state->getData(target);
-            pushColorAttachment(textureData.format, vk::ImageLayout::eGeneral);
-        }
+        for (auto& target : std::get<std::vector<Texture>>(renderPassInfo.renderTarget))
+            pushColorAttachment(state->getData(target).format, vk::ImageLayout::eGeneral,
+                                vk::AttachmentStoreOp::eStore);
+    }
+    for (auto& attachment : renderPassInfo.subpassAttachments) {
+        auto& attachmentData = state->getData(attachment);
+        if (attachmentData.extent.width != renderArea.width || attachmentData.extent.height != renderArea.height)
+            throw std::runtime_error("[TGA Vulkan] Subpass attachments and render target differ in size");
+        pushColorAttachment(attachmentData.format, vk::ImageLayout::eGeneral,
+                            determineStoreOp(renderPassInfo.subpassAttachmentStoreOp));
+    }
+    uint32_t numColorAttachments = static_cast<uint32_t>(attachmentDescs.size());
+
+    if (hasDepthAttachment) {
+        bool clearDepth = renderPassInfo.clearOperations == ClearOperation::depth ||
+                          renderPassInfo.clearOperations == ClearOperation::all;
+        attachmentDescs.push_back(vk::AttachmentDescription({}, depthFormat)
+                                      .setInitialLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+                                      .setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+                                      .setLoadOp(determineLoadOp(depthConfig.loadOp, clearDepth))
+                                      .setStoreOp(determineStoreOp(depthConfig.storeOp))
+                                      .setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+                                      .setStencilStoreOp(vk::AttachmentStoreOp::eDontCare));
     }
-    attachmentDescs.push_back(vk::AttachmentDescription({}, depthFormat)
-                                  .setInitialLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
-                                  .setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
-                                  .setLoadOp([&]() {
-                                      switch (renderPassInfo.clearOperations) {
-                                          case ClearOperation::depth:
-                                          case ClearOperation::all: return vk::AttachmentLoadOp::eClear;
-                                          default: return vk::AttachmentLoadOp::eLoad;
-                                      }
-                                  }())
-                                  .setStoreOp(vk::AttachmentStoreOp::eStore));
-
-    std::vector<vk::AttachmentReference> colorAttachmentRefs;
-    uint32_t numColorAttachments = static_cast<uint32_t>(attachmentDescs.size() - 1);
-    colorAttachmentRefs.reserve(numColorAttachments);
-    for (uint32_t i = 0; i < numColorAttachments; ++i)
-        colorAttachmentRefs.push_back({i, vk::ImageLayout::eColorAttachmentOptimal});
+
+    // Without explicit subpasses the RenderPass consists of a single subpass that writes every color attachment
+    std::vector<SubpassInfo> subpassInfos = renderPassInfo.subpasses;
+    if (subpassInfos.empty()) {
+        std::vector<uint32_t> colorAttachments;
+        for (uint32_t i = 0; i < numColorAttachments; ++i) colorAttachments.push_back(i);
+        subpassInfos.emplace_back(renderPassInfo.vertexShader, renderPassInfo.fragmentShader, colorAttachments,
+                                  std::vector<uint32_t>{}, renderPassInfo.vertexLayout, renderPassInfo.inputLayout);
+    }
+    uint32_t numSubpasses = static_cast<uint32_t>(subpassInfos.size());
+
+    auto usesAttachment = [](SubpassInfo const& subpass, uint32_t attachment) {
+        auto& color = subpass.colorAttachments;
+        auto& input = subpass.inputAttachments;
+        return std::find(color.begin(), color.end(), attachment) != color.end() ||
+               std::find(input.begin(), input.end(), attachment) != input.end();
+    };
+
+    // The references are kept alive until the vk::RenderPass is created
+    std::vector<std::vector<vk::AttachmentReference>> colorAttachmentRefs(numSubpasses);
+    std::vector<std::vector<vk::AttachmentReference>> inputAttachmentRefs(numSubpasses);
+    std::vector<std::vector<uint32_t>> preserveAttachments(numSubpasses);
     vk::AttachmentReference depthAttachmentRef{numColorAttachments, vk::ImageLayout::eDepthStencilAttachmentOptimal};
-    auto subpassDesc = vk::SubpassDescription()
-                           .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
-                           .setColorAttachments(colorAttachmentRefs)
-                           .setPDepthStencilAttachment(&depthAttachmentRef);
+    std::vector<vk::SubpassDescription> subpassDescs;
+    for (uint32_t i = 0; i < numSubpasses; ++i) {
+        auto& subpass = subpassInfos[i];
+        for (auto attachment : subpass.colorAttachments) {
+            if (attachment >= numColorAttachments)
+                throw std::runtime_error("[TGA Vulkan] Subpass " + std::to_string(i) + " writes attachment " +
+                                         std::to_string(attachment) + " which does not exist");
+            colorAttachmentRefs[i].push_back({attachment, vk::ImageLayout::eColorAttachmentOptimal});
+        }
+        for (auto attachment : subpass.inputAttachments) {
+            if (attachment >= numColorAttachments)
+                throw std::runtime_error("[TGA Vulkan] Subpass " + std::to_string(i) + " reads attachment " +
+                                         std::to_string(attachment) + " which does not exist");
+            if (attachment == 0 && std::holds_alternative<Window>(renderPassInfo.renderTarget))
+                throw std::runtime_error("[TGA Vulkan] A Window can't be read as an input attachment");
+            auto& color = subpass.colorAttachments;
+            if (std::find(color.begin(), color.end(), attachment) != color.end())
+                throw std::runtime_error("[TGA Vulkan] Subpass " + std::to_string(i) +
+                                         " can't read and write attachment " + std::to_string(attachment));
+            // Same layout as the Texture descriptors, so the InputSet of an input attachment is written as usual
+            inputAttachmentRefs[i].push_back({attachment, vk::ImageLayout::eGeneral});
+        }
+        // Attachments that are used before and after this subpass have to keep their contents across it
+        for (uint32_t attachment = 0; attachment < numColorAttachments; ++attachment) {
+            if (usesAttachment(subpass, attachment)) continue;
+            auto usedBy = [&](SubpassInfo const& other) { return usesAttachment(other, attachment); };
+            if (std::any_of(subpassInfos.begin(), subpassInfos.begin() + i, usedBy) &&
+                std::any_of(subpassInfos.begin() + i + 1, subpassInfos.end(), usedBy))
+                preserveAttachments[i].push_back(attachment);
+        }
+        subpassDescs.push_back(
+            vk::SubpassDescription()
+                .setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+                .setColorAttachments(colorAttachmentRefs[i])
+                .setInputAttachments(inputAttachmentRefs[i])
+                .setPreserveAttachments(preserveAttachments[i])
+                .setPDepthStencilAttachment(hasDepthAttachment && subpass.depthAttachment ? &depthAttachmentRef
+                                                                                          : nullptr));
+    }
 
-    auto subpassDependency =
+    std::vector<vk::SubpassDependency> subpassDependencies{
         vk::SubpassDependency()
             .setSrcSubpass(VK_SUBPASS_EXTERNAL)
             .setDstSubpass(0)
@@ -851,124 +1528,118 @@ RenderPass Interface::createRenderPass(RenderPassInfo const& renderPassInfo)
                 vk::PipelineStageFlagBits::eColorAttachmentOutput)  // TODO: determine safe stage mask for sync
             .setDstStageMask(vk::PipelineStageFlagBits::eFragmentShader)
             .setSrcAccessMask(vk::AccessFlagBits::eMemoryWrite)
-            .setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite);
+            .setDstAccessMask(vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite)};
+    // Every subpass waits for the earlier ones that wrote an attachment it uses. By region, since a fragment only
+    // reads the input attachments at its own position
+    for (uint32_t dst = 1; dst < numSubpasses; ++dst) {
+        for (uint32_t src = 0; src < dst; ++src) {
+            auto& srcColor = subpassInfos[src].colorAttachments;
+            bool colorHazard = std::any_of(srcColor.begin(), srcColor.end(), [&](uint32_t attachment) {
+                return usesAttachment(subpassInfos[dst], attachment);
+            });
+            bool depthHazard =
+                hasDepthAttachment && subpassInfos[src].depthAttachment && subpassInfos[dst].depthAttachment;
+            if (!colorHazard && !depthHazard) continue;
+            subpassDependencies.push_back(
+                vk::SubpassDependency(src, dst)
+                    .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput |
+                                     vk::PipelineStageFlagBits::eLateFragmentTests)
+                    .setDstStageMask(vk::PipelineStageFlagBits::eFragmentShader |
+                                     vk::PipelineStageFlagBits::eEarlyFragmentTests |
+                                     vk::PipelineStageFlagBits::eLateFragmentTests |
+                                     vk::PipelineStageFlagBits::eColorAttachmentOutput)
+                    .setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite |
+                                      vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+                    .setDstAccessMask(
+                        vk::AccessFlagBits::eInputAttachmentRead | vk::AccessFlagBits::eColorAttachmentRead |
+                        vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentRead |
+                        vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+                    .setDependencyFlags(vk::DependencyFlagBits::eByRegion));
+        }
+    }
 
     auto renderPass = device.createRenderPass(vk::RenderPassCreateInfo()
                                                   .setAttachments(attachmentDescs)
-                                                  .setSubpasses(subpassDesc)
-                                                  .setDependencies(subpassDependency));
+                                                  .setSubpasses(subpassDescs)
+                                                  .setDependencies(subpassDependencies));
 
     std::vector<vk::Framebuffer> framebuffers;
-    vk::Extent2D renderArea;
-    size_t numColorAttachmentsPerFrameBuffer{0};
-
-    if (auto texture = std::get_if<Texture>(&renderPassInfo.renderTarget)) {
-        numColorAttachmentsPerFrameBuffer = 1;
-        auto& textureData = state->getData(*texture);
-        renderArea = vk::Extent2D{textureData.extent.width, textureData.extent.height};
-        std::array<vk::ImageView, 2> attachments{textureData.imageView, textureData.depthBuffer.imageView};
+    size_t numColorAttachmentsPerFrameBuffer{numColorAttachments};
+    auto createFramebuffer = [&](std::vector<vk::ImageView> attachments) {
+        for (auto& attachment : renderPassInfo.subpassAttachments)
+            attachments.push_back(state->getData(attachment).baseLevelView);
+        if (hasDepthAttachment) attachments.push_back(depthView);
         framebuffers.push_back(device.createFramebuffer(vk::FramebufferCreateInfo({}, renderPass)
                                                             .setAttachments(attachments)
-                                                            .setWidth(textureData.extent.width)
-                                                            .setHeight(textureData.extent.height)
+                                                            .setWidth(renderArea.width)
+                                                            .setHeight(renderArea.height)
                                                             .setLayers(1)));
+    };
 
+    if (auto texture = std::get_if<Texture>(&renderPassInfo.renderTarget)) {
+        createFramebuffer({state->getData(*texture).baseLevelView});
     } else if (auto window = std::get_if<Window>(&renderPassInfo.renderTarget)) {
-        numColorAttachmentsPerFrameBuffer = 1;
-        auto& windowData = state->getData(*window);
-        renderArea = vk::Extent2D{windowData.extent.width, windowData.extent.height};
-        for (auto& imageView : windowData.imageViews) {
-            std::array<vk::ImageView, 2> attachments{imageView, windowData.depthBuffer.imageView};
-            framebuffers.push_back(device.createFramebuffer(vk::FramebufferCreateInfo({}, renderPass)
-                                                                .setAttachments(attachments)
-                                                                .setWidth(windowData.extent.width)
-                                                                .setHeight(windowData.extent.height)
-                                                                .setLayers(1)));
-        }
-
+        for (auto& imageView : state->getData(*window).imageViews) createFramebuffer({imageView});
     } else {
-        auto& targets = std::get<std::vector<Texture>>(renderPassInfo.renderTarget);
-        numColorAttachmentsPerFrameBuffer = targets.size();
-        auto& referenceData = state->getData(targets[0]);
-        renderArea = vk::Extent2D{referenceData.extent.width, referenceData.extent.height};
         std::vector<vk::ImageView> attachments;
-        for (auto& target : targets) {
-            auto& textureData = state->getData(target);
-            attachments.push_back(textureData.imageView);
-        }
-        attachments.push_back(referenceData.depthBuffer.imageView);
-        framebuffers.push_back(device.createFramebuffer(vk::FramebufferCreateInfo({}, renderPass)
-                                                            .setAttachments(attachments)
-                                                            .setWidth(referenceData.extent.width)
-                                                            .setHeight(referenceData.extent.height)
-                                                            .setLayers(1)));
-    }
-
-    std::vector<vk::DescriptorSetLayout> descriptorSetLayouts{};
-    // The types need to be remembered since it is can't be infered from the input later
-    std::vector<std::vector<vk::DescriptorType>> setDescriptorTypes{};
-    for (auto& setLayout : renderPassInfo.inputLayout) {
-        std::vector<vk::DescriptorSetLayoutBinding> bindings{};
-        std::vector<vk::DescriptorType> bindingTypes{};
-        for (uint32_t i = 0; i < setLayout.size(); ++i) {
-            auto type = [&]() {
-                switch (setLayout[i].type) {
-                    case tga::BindingType::sampler: return vk::DescriptorType::eCombinedImageSampler;
-                    case tga::BindingType::storageBuffer: return vk::DescriptorType::eStorageBuffer;
-                    case tga::BindingType::uniformBuffer: return vk::DescriptorType::eUniformBuffer;
-                    case tga::BindingType::storageImage: return vk::DescriptorType::eStorageImage;
-                    case tga::BindingType::accelerationStructure: return vk::DescriptorType::eAccelerationStructureKHR;
-                };
-                return vk::DescriptorType::eCombinedImageSampler;
-            }();
-            bindings.push_back(
-                vk::DescriptorSetLayoutBinding(i, type, setLayout[i].count, vk::ShaderStageFlagBits::eAll));
-            bindingTypes.push_back(type);
-        }
-        setDescriptorTypes.push_back(std::move(bindingTypes));
-        descriptorSetLayouts.push_back(device.createDescriptorSetLayout({{}, bindings}));
+        for (auto& target : std::get<std::vector<Texture>>(renderPassInfo.renderTarget))
+            attachments.push_back(state->getData(target).baseLevelView);
+        createFramebuffer(attachments);
     }
 
-    auto pipelineLayout = device.createPipelineLayout({{}, descriptorSetLayouts});
-
-    auto& vertexShader = state->getData(renderPassInfo.vertexShader).module;
-    auto& fragmentShader = state->getData(renderPassInfo.fragmentShader).module;
-    vk::Pipeline pipeline = [&]() {
+    // Initial values of the dynamic states, also used as the static configuration of the pipeline
+    vk::Bool32 depthTest = (renderPassInfo.perPixelOperations.depthCompareOp != CompareOperation::ignore);
+    vkData::DynamicState dynamicState{renderPassInfo.dynamicStates,
+                                      determineCullMode(renderPassInfo.rasterizerConfig.cullMode),
+                                      determineFrontFace(renderPassInfo.rasterizerConfig.frontFace),
+                                      determinePrimitiveTopology(renderPassInfo.primitiveTopology),
+                                      depthTest,
+                                      (!renderPassInfo.perPixelOperations.blendEnabled) && depthTest,
+                                      determineDepthCompareOp(renderPassInfo.perPixelOperations.depthCompareOp)};
+
+    // All subpasses share the fixed function configuration of the RenderPass
+    auto createPipeline = [&](SubpassInfo const& subpass, uint32_t subpassIndex, vk::PipelineLayout pipelineLayout) {
+        auto& vertexShader = state->getData(subpass.vertexShader).module;
+        auto& fragmentShader = state->getData(subpass.fragmentShader).module;
         std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages{
             vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eVertex, vertexShader, "main"),
             vk::PipelineShaderStageCreateInfo({}, vk::ShaderStageFlagBits::eFragment, fragmentShader, "main")};
 
-        vk::VertexInputBindingDescription vertexBinding{0, uint32_t(renderPassInfo.vertexLayout.vertexSize),
+        vk::VertexInputBindingDescription vertexBinding{0, uint32_t(subpass.vertexLayout.vertexSize),
                                                         vk::VertexInputRate::eVertex};
-        uint32_t bindingCount = ((renderPassInfo.vertexLayout.vertexSize > 0) ? 1 : 0);
-        auto vertexAttributes = determineVertexAttributes(renderPassInfo.vertexLayout.vertexAttributes);
+        uint32_t bindingCount = ((subpass.vertexLayout.vertexSize > 0) ? 1 : 0);
+        auto vertexAttributes = determineVertexAttributes(subpass.vertexLayout.vertexAttributes);
         vk::PipelineVertexInputStateCreateInfo vertexInputInfo{
             {}, bindingCount, &vertexBinding, uint32_t(vertexAttributes.size()), vertexAttributes.data()};
 
-        vk::PipelineInputAssemblyStateCreateInfo inputAssembly{{}, vk::PrimitiveTopology::eTriangleList, VK_FALSE};
+        vk::PipelineInputAssemblyStateCreateInfo inputAssembly{{}, dynamicState.primitiveTopology, VK_FALSE};
 
-        std::array<vk::DynamicState, 2> dynamicStates{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
-        vk::PipelineDynamicStateCreateInfo dynamicState{
+        std::vector<vk::DynamicState> dynamicStates{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        auto addDynamicState = [&](tga::DynamicState tgaState, vk::DynamicState vkState) {
+            if (renderPassInfo.dynamicStates & tgaState) dynamicStates.push_back(vkState);
+        };
+        addDynamicState(tga::DynamicState::cullMode, vk::DynamicState::eCullModeEXT);
+        addDynamicState(tga::DynamicState::frontFace, vk::DynamicState::eFrontFaceEXT);
+        addDynamicState(tga::DynamicState::primitiveTopology, vk::DynamicState::ePrimitiveTopologyEXT);
+        addDynamicState(tga::DynamicState::depthTest, vk::DynamicState::eDepthTestEnableEXT);
+        addDynamicState(tga::DynamicState::depthWrite, vk::DynamicState::eDepthWriteEnableEXT);
+        addDynamicState(tga::DynamicState::depthCompareOp, vk::DynamicState::eDepthCompareOpEXT);
+        vk::PipelineDynamicStateCreateInfo dynamicStateInfo{
             {}, static_cast<uint32_t>(dynamicStates.size()), dynamicStates.data()};
         vk::Viewport viewport{0, 0, 1, 1, 0, 1};
         vk::Rect2D scissor{{0, 0}, {1, 1}};
         vk::PipelineViewportStateCreateInfo viewportState{{}, 1, &viewport, 1, &scissor};
         auto rasterizer = determineRasterizerState(renderPassInfo.rasterizerConfig);
         vk::PipelineMultisampleStateCreateInfo multisampling{};
-        vk::Bool32 depthTest = (renderPassInfo.perPixelOperations.depthCompareOp != CompareOperation::ignore);
 
-        auto depthStencil =
-            vk::PipelineDepthStencilStateCreateInfo()
-                .setDepthTestEnable(depthTest)
-                .setDepthWriteEnable((!renderPassInfo.perPixelOperations.blendEnabled) && depthTest)
-                .setDepthCompareOp(determineDepthCompareOp(renderPassInfo.perPixelOperations.depthCompareOp));
+        auto depthStencil = vk::PipelineDepthStencilStateCreateInfo()
+                                .setDepthTestEnable(dynamicState.depthTestEnable)
+                                .setDepthWriteEnable(dynamicState.depthWriteEnable)
+                                .setDepthCompareOp(dynamicState.depthCompareOp);
 
         auto colorBlendAttachment = determineColorBlending(renderPassInfo.perPixelOperations);
 
-        uint32_t numBlendAttachemnts = 1;
-        if (auto targets = std::get_if<std::vector<Texture>>(&renderPassInfo.renderTarget)) {
-            numBlendAttachemnts = static_cast<uint32_t>(targets->size());
-        }
+        uint32_t numBlendAttachemnts = static_cast<uint32_t>(subpass.colorAttachments.size());
         std::vector<vk::PipelineColorBlendAttachmentState> colorBlendAttachments(numBlendAttachemnts,
                                                                                  colorBlendAttachment);
 
@@ -985,15 +1656,23 @@ RenderPass Interface::createRenderPass(RenderPassInfo const& renderPassInfo)
                                             .setPMultisampleState(&multisampling)
                                             .setPDepthStencilState(&depthStencil)
                                             .setPColorBlendState(&colorBlending)
-                                            .setPDynamicState(&dynamicState)
+                                            .setPDynamicState(&dynamicStateInfo)
                                             .setLayout(pipelineLayout)
-                                            .setRenderPass(renderPass))
+                                            .setRenderPass(renderPass)
+                                            .setSubpass(subpassIndex))
             .value;
-    }();
+    };
 
-    return tga::RenderPass{toRawHandle<TgaRenderPass>(renderPasses.insert(
-        {pipeline, renderPass, std::move(framebuffers), numColorAttachmentsPerFrameBuffer, renderArea,
-         vkData::Layout{pipelineLayout, std::move(descriptorSetLayouts), std::move(setDescriptorTypes)}}))};
+    std::vector<vkData::Subpass> subpasses;
+    for (uint32_t i = 0; i < numSubpasses; ++i) {
+        auto layout = state->createLayout(subpassInfos[i].inputLayout, renderPassInfo.bindlessTable);
+        auto pipeline = createPipeline(subpassInfos[i], i, layout.pipelineLayout);
+        subpasses.push_back({pipeline, std::move(layout)});
+    }
+
+    return tga::RenderPass{toRawHandle<TgaRenderPass>(
+        renderPasses.insert({renderPass, std::move(subpasses), std::move(framebuffers),
+                             numColorAttachmentsPerFrameBuffer, renderArea, dynamicState, hasDepthAttachment}))};
 }
 
 ComputePass Interface::createComputePass(ComputePassInfo const& computePassInfo)
@@ -1002,32 +1681,8 @@ ComputePass Interface::createComputePass(ComputePassInfo const& computePassInfo)
     auto& computeShaderModule = state->getData(computePassInfo.computeShader).module;
     auto& computePasses = state->computePasses;
 
-    std::vector<vk::DescriptorSetLayout> descriptorSetLayouts{};
-    // The types need to be remembered since it is can't be infered from the input later
-    std::vector<std::vector<vk::DescriptorType>> setDescriptorTypes{};
-    for (auto& setLayout : computePassInfo.inputLayout) {
-        std::vector<vk::DescriptorSetLayoutBinding> bindings{};
-        std::vector<vk::DescriptorType> bindingTypes{};
-        for (uint32_t i = 0; i < setLayout.size(); ++i) {
-            auto type = [&]() {
-                switch (setLayout[i].type) {
-                    case tga::BindingType::sampler: return vk::DescriptorType::eCombinedImageSampler;
-                    case tga::BindingType::storageBuffer: return vk::DescriptorType::eStorageBuffer;
-                    case tga::BindingType::uniformBuffer: return vk::DescriptorType::eUniformBuffer;
-                    case tga::BindingType::storageImage: return vk::DescriptorType::eStorageImage;
-                    case tga::BindingType::accelerationStructure: return vk::DescriptorType::eAccelerationStructureKHR;
-                };
-                return vk::DescriptorType::eCombinedImageSampler;
-            }();
-            bindings.push_back(
-                vk::DescriptorSetLayoutBinding(i, type, setLayout[i].count, vk::ShaderStageFlagBits::eAll));
-            bindingTypes.push_back(type);
-        }
-        setDescriptorTypes.push_back(std::move(bindingTypes));
-        descriptorSetLayouts.push_back(device.createDescriptorSetLayout({{}, bindings}));
-    }
-
-    auto pipelineLayout = device.createPipelineLayout({{}, descriptorSetLayouts});
+    auto layout = state->createLayout(computePassInfo.inputLayout, computePassInfo.bindlessTable);
+    auto pipelineLayout = layout.pipelineLayout;
 
     auto pipeline =
         device
@@ -1037,9 +1692,92 @@ ComputePass Interface::createComputePass(ComputePassInfo const& computePassInfo)
                                         pipelineLayout})
             .value;
 
-    ;
-    return tga::ComputePass{toRawHandle<TgaComputePass>(computePasses.insert(
-        {pipeline, vkData::Layout{pipelineLayout, std::move(descriptorSetLayouts), std::move(setDescriptorTypes)}}))};
+    return tga::ComputePass{toRawHandle<TgaComputePass>(computePasses.insert({pipeline, std::move(layout)}))};
+}
+
+namespace /*acceleration structure builds*/
+{
+    // Scratch memory a batch of builds may use at once, larger batches are split
+    constexpr vk::DeviceSize scratchBudget = vk::DeviceSize{256} << 20;
+
+    constexpr vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // vkCmdUpdateBuffer is limited to 65536 bytes per call
+    void updateBufferChunked(vk::CommandBuffer cmd, vk::Buffer buffer, void const *data, vk::DeviceSize size)
+    {
+        constexpr vk::DeviceSize maxUpdateSize = 65536;
+        for (vk::DeviceSize offset = 0; offset < size; offset += maxUpdateSize)
+            cmd.updateBuffer(buffer, offset, std::min(maxUpdateSize, size - offset),
+                             static_cast<uint8_t const *>(data) + offset);
+    }
+
+    // The single geometry fields of the info are shorthand for one opaque geometry
+    std::vector<ext::TriangleGeometry> triangleGeometries(ext::BottomLevelAccelerationStructureInfo const& info)
+    {
+        if (!info.geometries.empty()) return info.geometries;
+        return {ext::TriangleGeometry{}
+                    .setVertexBuffer(info.vertexBuffer)
+                    .setIndexBuffer(info.indexBuffer)
+                    .setVertexStride(info.vertexStride)
+                    .setVertexPositionFormat(info.vertexPositionFormat)
+                    .setIndexCount(info.indexCount)
+                    .setFirstIndex(info.firstIndex)
+                    .setVertexOffset(info.vertexOffset)};
+    }
+
+    // The returned info points to the geometry
+    vk::AccelerationStructureBuildGeometryInfoKHR topLevelBuildInfo(
+        vk::AccelerationStructureGeometryKHR const& geometry, bool allowUpdate)
+    {
+        using BuildFlags = vk::BuildAccelerationStructureFlagBitsKHR;
+        vk::BuildAccelerationStructureFlagsKHR flags{BuildFlags::ePreferFastTrace};
+        if (allowUpdate) flags |= BuildFlags::eAllowUpdate;
+        return vk::AccelerationStructureBuildGeometryInfoKHR{}
+            .setType(vk::AccelerationStructureTypeKHR::eTopLevel)
+            .setMode(vk::BuildAccelerationStructureModeKHR::eBuild)
+            .setGeometries(geometry)
+            .setFlags(flags);
+    }
+}  // namespace
+
+static_assert(sizeof(ext::AccelerationStructureInstance) == sizeof(vk::AccelerationStructureInstanceKHR),
+              "ext::AccelerationStructureInstance must match the Vulkan instance layout");
+
+vk::DeviceAddress Interface::InternalState::instanceBufferAddress(Buffer buffer, size_t offset, uint32_t instanceCount)
+{
+    auto& bufferData = getData(buffer);
+    if (!(bufferData.flags & vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR))
+        throw std::runtime_error("[TGA Vulkan] Instance Buffer requires BufferUsage::accelerationStructureBuildInput");
+    if (offset % 16 != 0) throw std::runtime_error("[TGA Vulkan] Instance Buffer offset must be a multiple of 16");
+    if (offset + vk::DeviceSize{instanceCount} * sizeof(vk::AccelerationStructureInstanceKHR) > bufferData.size)
+        throw std::runtime_error("[TGA Vulkan] Instance Buffer is too small for " + std::to_string(instanceCount) +
+                                 " instances");
+    return device.getBufferAddress(bufferData.buffer) + offset;
+}
+
+std::vector<vk::AccelerationStructureInstanceKHR> Interface::InternalState::toInstances(
+    std::vector<ext::AccelerationStructureInstanceInfo> const& instanceInfos)
+{
+    std::vector<vk::AccelerationStructureInstanceKHR> instances;
+    instances.reserve(instanceInfos.size());
+    for (auto& instance : instanceInfos) {
+        // Both are 24 bit fields of the instance record
+        if (instance.customIndex >= (1u << 24) || instance.shaderBindingTableRecordOffset >= (1u << 24))
+            throw std::runtime_error("[TGA Vulkan] Instance customIndex and shaderBindingTableRecordOffset must be "
+                                     "less than 2^24");
+        instances.emplace_back()
+            .setTransform(instance.transform)
+            .setInstanceCustomIndex(instance.customIndex)
+            .setMask(instance.mask)
+            .setInstanceShaderBindingTableRecordOffset(instance.shaderBindingTableRecordOffset)
+            .setAccelerationStructureReference(
+                device.getAccelerationStructureAddressKHR(getData(instance.blas).accelerationStructure))
+            .setFlags(determineInstanceFlags(instance.flags));
+    }
+    return instances;
 }
 
 ext::TopLevelAccelerationStructure Interface::createTopLevelAccelerationStructure(
@@ -1054,142 +1792,215 @@ ext::TopLevelAccelerationStructure Interface::createTopLevelAccelerationStructur
 
     vk::MemoryAllocateFlagsInfo memFlags{vk::MemoryAllocateFlagBits::eDeviceAddress};
 
-    std::vector<vk::AccelerationStructureInstanceKHR> instances;
-
-    for (auto& instance : TLASInfo.instanceInfos) {
-        instances.emplace_back()
-            .setTransform(instance.transform)
-            .setMask(0xFF)
-            .setAccelerationStructureReference(
-                device.getAccelerationStructureAddressKHR(state->getData(instance.blas).accelerationStructure))
-            .setFlags(vk::GeometryInstanceFlagBitsKHR::eForceOpaque |
-                      vk::GeometryInstanceFlagBitsKHR::eTriangleFacingCullDisable);
+    // Instances either come from a user Buffer or are uploaded to an internal one
+    bool userInstances = bool(TLASInfo.instanceBuffer);
+    auto instances = userInstances ? std::vector<vk::AccelerationStructureInstanceKHR>{}
+                                   : state->toInstances(TLASInfo.instanceInfos);
+    auto instanceCount = userInstances ? TLASInfo.instanceCount : static_cast<uint32_t>(instances.size());
+
+    vk::Buffer instanceBuffer;
+    vk::DeviceMemory instanceMem;
+    vk::DeviceAddress instanceAddress;
+    if (userInstances) {
+        instanceAddress =
+            state->instanceBufferAddress(TLASInfo.instanceBuffer, TLASInfo.instanceBufferOffset, instanceCount);
+    } else {
+        // Vulkan does not allow empty buffers
+        auto instanceDataSize =
+            std::max<vk::DeviceSize>(instances.size() * sizeof(vk::AccelerationStructureInstanceKHR), 1);
+        instanceBuffer = device.createBuffer(
+            vk::BufferCreateInfo()
+                .setSize(instanceDataSize)
+                .setUsage(vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
+                          vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eTransferDst)
+                .setQueueFamilyIndices(renderQueueFamily));
+        auto instanceMemReqs = device.getBufferMemoryRequirements(instanceBuffer);
+        instanceMem = device.allocateMemory({instanceMemReqs.size, deviceMemoryIndex, &memFlags});
+        device.bindBufferMemory(instanceBuffer, instanceMem, 0);
+        instanceAddress = device.getBufferAddress(instanceBuffer);
     }
 
-    auto instanceDataSize = instances.size() * sizeof(vk::AccelerationStructureInstanceKHR);
-    auto instanceBuffer = device.createBuffer(
-        vk::BufferCreateInfo()
-            .setSize(instanceDataSize)
-            .setUsage(vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
-                      vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eTransferDst)
-            .setQueueFamilyIndices(renderQueueFamily));
-    auto instanceMemReqs = device.getBufferMemoryRequirements(instanceBuffer);
-    auto instanceMem = device.allocateMemory({instanceMemReqs.size, deviceMemoryIndex, &memFlags});
-    device.bindBufferMemory(instanceBuffer, instanceMem, 0);
-
-    OneTimeCommand{device, cmdPool, renderQueue}.cmd.updateBuffer(instanceBuffer, 0, instanceDataSize,
-                                                                  instances.data());
-    // {
-    //     OneTimeCommand ot{device, cmdPool, renderQueue};
-    //     ot.cmd.updateBuffer(instanceBuffer, 0, instanceDataSize, instances.data());
-    // }
-
-    // TODO one expects many here?
-    auto instanceData =
-        vk::AccelerationStructureGeometryInstancesDataKHR{}.setData(device.getBufferAddress(instanceBuffer));
+    auto instanceData = vk::AccelerationStructureGeometryInstancesDataKHR{}.setData(instanceAddress);
     auto instanceGeometry = vk::AccelerationStructureGeometryKHR{}
                                 .setGeometry(instanceData)
                                 .setGeometryType(vk::GeometryTypeKHR::eInstances);
 
-    auto maxPrimitives = static_cast<uint32_t>(TLASInfo.instanceInfos.size());
-
-    vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
-    buildInfo.setType(vk::AccelerationStructureTypeKHR::eTopLevel)
-        .setMode(vk::BuildAccelerationStructureModeKHR::eBuild)
-        .setGeometries(instanceGeometry)
-        .setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
+    auto buildInfo = topLevelBuildInfo(instanceGeometry, TLASInfo.allowUpdate);
 
     auto buildSizes = device.getAccelerationStructureBuildSizesKHR(vk::AccelerationStructureBuildTypeKHR::eDevice,
-                                                                   buildInfo, maxPrimitives);
+                                                                   buildInfo, instanceCount);
 
-    auto acBuffer = device.createBuffer(vk::BufferCreateInfo()
-                                            .setSize(buildSizes.accelerationStructureSize)
-                                            .setUsage(vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR |
-                                                      vk::BufferUsageFlagBits::eShaderDeviceAddress)
-                                            .setQueueFamilyIndices(renderQueueFamily));
-    auto acMemReq = device.getBufferMemoryRequirements(acBuffer);
-
-    auto acMem = device.allocateMemory({acMemReq.size, deviceMemoryIndex, &memFlags});
-    device.bindBufferMemory(acBuffer, acMem, 0);
-
-    auto scratchBuffer = device.createBuffer(
-        vk::BufferCreateInfo()
-            .setSize(buildSizes.buildScratchSize)
-            .setUsage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress)
-            .setQueueFamilyIndices(renderQueueFamily));
-    auto scratchBufferMemReq = device.getBufferMemoryRequirements(scratchBuffer);
-    auto scratchBufferMem = device.allocateMemory({scratchBufferMemReq.size, deviceMemoryIndex, &memFlags});
-    device.bindBufferMemory(scratchBuffer, scratchBufferMem, 0);
+    auto tlas = state->createAccelerationStructure(vk::AccelerationStructureTypeKHR::eTopLevel,
+                                                   buildSizes.accelerationStructureSize);
+    // Updates reuse the scratch buffer of the initial build
+    auto scratchSize = TLASInfo.allowUpdate ? std::max(buildSizes.buildScratchSize, buildSizes.updateScratchSize)
+                                            : buildSizes.buildScratchSize;
+    auto [scratchBuffer, scratchBufferMem] = state->createScratchBuffer(scratchSize);
 
     buildInfo.setScratchData(device.getBufferAddress(scratchBuffer));
-
-    auto tlas = device.createAccelerationStructureKHR(vk::AccelerationStructureCreateInfoKHR{}
-                                                          .setBuffer(acBuffer)
-                                                          .setSize(buildSizes.accelerationStructureSize)
-                                                          .setType(vk::AccelerationStructureTypeKHR::eTopLevel));
-
-    buildInfo.setDstAccelerationStructure(tlas);
+    buildInfo.setDstAccelerationStructure(tlas.accelerationStructure);
 
     auto rangeInfo = vk::AccelerationStructureBuildRangeInfoKHR{}
-                         .setPrimitiveCount(maxPrimitives)
+                         .setPrimitiveCount(instanceCount)
                          .setFirstVertex(0)
                          .setPrimitiveOffset(0)
                          .setTransformOffset(0);
 
     {
         OneTimeCommand ot{device, cmdPool, renderQueue};
+        if (!userInstances)
+            updateBufferChunked(ot.cmd, instanceBuffer, instances.data(),
+                                instances.size() * sizeof(vk::AccelerationStructureInstanceKHR));
+        // Also makes instances written by previously executed CommandBuffers visible
+        ot.cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                               vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR, {},
+                               vk::MemoryBarrier(vk::AccessFlagBits::eMemoryWrite, vk::AccessFlagBits::eShaderRead),
+                               {}, {});
         ot.cmd.buildAccelerationStructuresKHR(buildInfo, &rangeInfo);
     }
 
-    auto idx = acclerationStructures.insert({tlas, acBuffer, acMem});
-
-    device.destroy(instanceBuffer);
-    device.free(instanceMem);
-    device.destroy(scratchBuffer);
-    device.free(scratchBufferMem);
+    if (TLASInfo.allowUpdate) {
+        tlas.instanceBuffer = instanceBuffer;
+        tlas.instanceMemory = instanceMem;
+        tlas.scratchBuffer = scratchBuffer;
+        tlas.scratchMemory = scratchBufferMem;
+        tlas.instanceCount = instanceCount;
+    } else {
+        device.destroy(instanceBuffer);
+        device.free(instanceMem);
+        device.destroy(scratchBuffer);
+        device.free(scratchBufferMem);
+    }
+    auto idx = acclerationStructures.insert(std::move(tlas));
     return tga::ext::TopLevelAccelerationStructure{toRawHandle<TgaTopLevelAccelerationStructure>(idx)};
 }
 
-ext::BottomLevelAccelerationStructure Interface::createBottomLevelAccelerationStructure(
-    ext::BottomLevelAccelerationStructureInfo const& BLASInfo)
+uint64_t Interface::getDeviceAddress(ext::BottomLevelAccelerationStructure blas)
+{
+    return state->device.getAccelerationStructureAddressKHR(state->getData(blas).accelerationStructure);
+}
+
+namespace /*acceleration structure serialization*/
+{
+    // Header layout of serialized acceleration structures as defined by the Vulkan specification:
+    // driver UUID, compatibility UUID, serialized size, deserialized size, number of referenced handles
+    constexpr size_t serializedVersionSize = 2 * VK_UUID_SIZE;
+    constexpr size_t serializedHeaderSize = serializedVersionSize + 3 * sizeof(uint64_t);
+    // Required alignment of the memory address for serialization copies
+    constexpr vk::DeviceSize serializedDataAlignment = 256;
+
+    uint64_t serializedHeaderField(std::vector<uint8_t> const& data, size_t field)
+    {
+        uint64_t value;
+        std::memcpy(&value, data.data() + serializedVersionSize + field * sizeof(uint64_t), sizeof(value));
+        return value;
+    }
+}  // namespace
+
+std::vector<uint8_t> Interface::serialize(ext::BottomLevelAccelerationStructure blas)
 {
     auto& device = state->device;
-    auto& renderQueue = state->renderQueue;
-    auto& renderQueueFamily = state->renderQueueFamily;
     auto& cmdPool = state->cmdPool;
-    auto& deviceMemoryIndex = state->deviceMemoryIndex;
-    auto& acclerationStructures = state->acclerationStructures;
+    auto& renderQueue = state->renderQueue;
+    auto accelerationStructure = state->getData(blas).accelerationStructure;
 
-    auto& vertexBuffer = state->getData(BLASInfo.vertexBuffer).buffer;
-    auto& indexBuffer = state->getData(BLASInfo.indexBuffer).buffer;
-
-    // for geometry description
-    auto primitiveCount = BLASInfo.indexCount / 3;
-    assert(primitiveCount * 3 == BLASInfo.indexCount);
-    auto triangleData = vk::AccelerationStructureGeometryTrianglesDataKHR{}
-                            .setIndexType(vk::IndexType::eUint32)
-                            .setIndexData(device.getBufferAddress(indexBuffer))
-                            .setVertexData(device.getBufferAddress(vertexBuffer))
-                            .setVertexFormat(tgaFormatToVkFormat(BLASInfo.vertexPositionFormat))
-                            .setVertexStride(BLASInfo.vertexStride)
-                            .setMaxVertex(BLASInfo.firstIndex + BLASInfo.indexCount);
-
-    auto geometry = vk::AccelerationStructureGeometryKHR{}
-                        .setGeometryType(vk::GeometryTypeKHR::eTriangles)
-                        .setFlags(vk::GeometryFlagBitsKHR::eOpaque)
-                        .setGeometry(triangleData);
-
-    vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
-    buildInfo.setType(vk::AccelerationStructureTypeKHR::eBottomLevel)
-        .setMode(vk::BuildAccelerationStructureModeKHR::eBuild)
-        .setGeometries(geometry)
-        .setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
+    // Builds may still be in flight when the structure was created without waitForBuild
+    auto buildStage = vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR;
+    auto buildBarrier = vk::MemoryBarrier(vk::AccessFlagBits::eAccelerationStructureWriteKHR,
+                                          vk::AccessFlagBits::eAccelerationStructureReadKHR);
 
-    auto buildSizes = device.getAccelerationStructureBuildSizesKHR(vk::AccelerationStructureBuildTypeKHR::eDevice,
-                                                                   buildInfo, primitiveCount);
+    auto sizeQuery = device.createQueryPool(
+        vk::QueryPoolCreateInfo({}, vk::QueryType::eAccelerationStructureSerializationSizeKHR, 1));
+    {
+        OneTimeCommand ot{device, cmdPool, renderQueue};
+        ot.cmd.pipelineBarrier(buildStage, buildStage, {}, buildBarrier, {}, {});
+        ot.cmd.resetQueryPool(sizeQuery, 0, 1);
+        ot.cmd.writeAccelerationStructuresPropertiesKHR(
+            accelerationStructure, vk::QueryType::eAccelerationStructureSerializationSizeKHR, sizeQuery, 0);
+    }
+    auto serializedSize = device
+                              .getQueryPoolResults<vk::DeviceSize>(
+                                  sizeQuery, 0, 1, sizeof(vk::DeviceSize), sizeof(vk::DeviceSize),
+                                  vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait)
+                              .value[0];
+    device.destroy(sizeQuery);
+
+    // Over-allocate, the start of the allocation is not guaranteed to be aligned
+    auto [buffer, memory] =
+        state->createHostAddressBuffer(serializedSize + serializedDataAlignment, state->readbackMemoryIndex);
+    auto bufferAddress = device.getBufferAddress(buffer);
+    auto dataOffset = alignUp(bufferAddress, serializedDataAlignment) - bufferAddress;
+    {
+        OneTimeCommand ot{device, cmdPool, renderQueue};
+        ot.cmd.pipelineBarrier(buildStage, buildStage, {}, buildBarrier, {}, {});
+        ot.cmd.copyAccelerationStructureToMemoryKHR(vk::CopyAccelerationStructureToMemoryInfoKHR(
+            accelerationStructure, bufferAddress + dataOffset, vk::CopyAccelerationStructureModeKHR::eSerialize));
+        ot.cmd.pipelineBarrier(buildStage, vk::PipelineStageFlagBits::eHost, {},
+                               vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead),
+                               {}, {});
+    }
+
+    std::vector<uint8_t> data(serializedSize);
+    auto mapping = static_cast<uint8_t const *>(device.mapMemory(memory, 0, VK_WHOLE_SIZE));
+    // The memory is not necessarily coherent
+    device.invalidateMappedMemoryRanges(vk::MappedMemoryRange(memory, 0, VK_WHOLE_SIZE));
+    std::memcpy(data.data(), mapping + dataOffset, serializedSize);
+    device.unmapMemory(memory);
+    device.destroy(buffer);
+    device.free(memory);
+    return data;
+}
+
+bool Interface::canDeserialize(std::vector<uint8_t> const& data)
+{
+    if (data.size() < serializedHeaderSize) return false;
+    // Serialized size and handle count, bottom level structures don't reference other structures
+    if (serializedHeaderField(data, 0) != data.size() || serializedHeaderField(data, 2) != 0) return false;
+    auto compatibility =
+        state->device.getAccelerationStructureCompatibilityKHR(vk::AccelerationStructureVersionInfoKHR{data.data()});
+    return compatibility == vk::AccelerationStructureCompatibilityKHR::eCompatible;
+}
+
+ext::BottomLevelAccelerationStructure Interface::deserialize(std::vector<uint8_t> const& data)
+{
+    if (!canDeserialize(data))
+        throw std::runtime_error("[TGA Vulkan] deserialize: The data is not a serialized bottom level acceleration "
+                                 "structure of this driver and device, rebuild it instead");
+    auto& device = state->device;
+
+    auto [buffer, memory] =
+        state->createHostAddressBuffer(data.size() + serializedDataAlignment, state->hostMemoryIndex);
+    auto bufferAddress = device.getBufferAddress(buffer);
+    auto dataOffset = alignUp(bufferAddress, serializedDataAlignment) - bufferAddress;
+    auto mapping = static_cast<uint8_t *>(device.mapMemory(memory, 0, VK_WHOLE_SIZE));
+    std::memcpy(mapping + dataOffset, data.data(), data.size());
+    device.unmapMemory(memory);
 
+    auto blas = state->createAccelerationStructure(vk::AccelerationStructureTypeKHR::eBottomLevel,
+                                                   serializedHeaderField(data, 1));
+    {
+        OneTimeCommand ot{device, state->cmdPool, state->renderQueue};
+        ot.cmd.copyMemoryToAccelerationStructureKHR(vk::CopyMemoryToAccelerationStructureInfoKHR(
+            bufferAddress + dataOffset, blas.accelerationStructure,
+            vk::CopyAccelerationStructureModeKHR::eDeserialize));
+        ot.cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+                               vk::PipelineStageFlagBits::eAllCommands, {},
+                               vk::MemoryBarrier(vk::AccessFlagBits::eAccelerationStructureWriteKHR,
+                                                 vk::AccessFlagBits::eAccelerationStructureReadKHR),
+                               {}, {});
+    }
+    device.destroy(buffer);
+    device.free(memory);
+
+    auto idx = state->acclerationStructures.insert(std::move(blas));
+    return tga::ext::BottomLevelAccelerationStructure{toRawHandle<TgaBottomLevelAccelerationStructure>(idx)};
+}
+
+vkData::ext::AccelerationStructure Interface::InternalState::createAccelerationStructure(
+    vk::AccelerationStructureTypeKHR type, vk::DeviceSize size)
+{
     auto acBuffer = device.createBuffer(vk::BufferCreateInfo()
-                                            .setSize(buildSizes.accelerationStructureSize)
+                                            .setSize(size)
                                             .setUsage(vk::BufferUsageFlagBits::eAccelerationStructureStorageKHR |
                                                       vk::BufferUsageFlagBits::eShaderDeviceAddress)
                                             .setQueueFamilyIndices(renderQueueFamily));
@@ -1198,38 +2009,265 @@ ext::BottomLevelAccelerationStructure Interface::createBottomLevelAccelerationSt
     auto acMem = device.allocateMemory({acMemReq.size, deviceMemoryIndex, &memFlags});
     device.bindBufferMemory(acBuffer, acMem, 0);
 
+    auto accelerationStructure = device.createAccelerationStructureKHR(
+        vk::AccelerationStructureCreateInfoKHR{}.setBuffer(acBuffer).setSize(size).setType(type));
+    return {accelerationStructure, acBuffer, acMem};
+}
+
+std::pair<vk::Buffer, vk::DeviceMemory> Interface::InternalState::createScratchBuffer(vk::DeviceSize size)
+{
     auto scratchBuffer = device.createBuffer(
         vk::BufferCreateInfo()
-            .setSize(buildSizes.buildScratchSize)
+            .setSize(size)
             .setUsage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress)
             .setQueueFamilyIndices(renderQueueFamily));
     auto scratchBufferMemReq = device.getBufferMemoryRequirements(scratchBuffer);
+    vk::MemoryAllocateFlagsInfo memFlags{vk::MemoryAllocateFlagBits::eDeviceAddress};
     auto scratchBufferMem = device.allocateMemory({scratchBufferMemReq.size, deviceMemoryIndex, &memFlags});
     device.bindBufferMemory(scratchBuffer, scratchBufferMem, 0);
+    return {scratchBuffer, scratchBufferMem};
+}
 
-    buildInfo.setScratchData(device.getBufferAddress(scratchBuffer));
+std::pair<vk::Buffer, vk::DeviceMemory> Interface::InternalState::createHostAddressBuffer(vk::DeviceSize size,
+                                                                                         uint32_t memoryIndex)
+{
+    auto buffer = device.createBuffer(vk::BufferCreateInfo()
+                                          .setSize(size)
+                                          .setUsage(vk::BufferUsageFlagBits::eShaderDeviceAddress)
+                                          .setQueueFamilyIndices(renderQueueFamily));
+    auto memReq = device.getBufferMemoryRequirements(buffer);
+    vk::MemoryAllocateFlagsInfo memFlags{vk::MemoryAllocateFlagBits::eDeviceAddress};
+    auto memory = device.allocateMemory({memReq.size, memoryIndex, &memFlags});
+    device.bindBufferMemory(buffer, memory, 0);
+    return {buffer, memory};
+}
 
-    auto blas = device.createAccelerationStructureKHR(vk::AccelerationStructureCreateInfoKHR{}
-                                                          .setBuffer(acBuffer)
-                                                          .setSize(buildSizes.accelerationStructureSize)
-                                                          .setType(vk::AccelerationStructureTypeKHR::eBottomLevel));
-    buildInfo.setDstAccelerationStructure(blas);
+void Interface::InternalState::releaseFinishedBuilds(bool waitForAll)
+{
+    std::erase_if(pendingBuilds, [&](vkData::ext::PendingBuild& build) {
+        if (waitForAll)
+            std::ignore = device.waitForFences(build.completionFence, true, std::numeric_limits<uint64_t>::max());
+        else if (device.getFenceStatus(build.completionFence) != vk::Result::eSuccess)
+            return false;
+        device.freeCommandBuffers(cmdPool, build.cmdBuffer);
+        device.destroy(build.completionFence);
+        device.destroy(build.scratchBuffer);
+        device.free(build.scratchMemory);
+        device.destroy(build.transformBuffer);
+        device.free(build.transformMemory);
+        return true;
+    });
+}
 
-    auto rangeInfo = vk::AccelerationStructureBuildRangeInfoKHR{}
-                         .setFirstVertex(BLASInfo.vertexOffset)
-                         .setPrimitiveCount(primitiveCount)
-                         .setPrimitiveOffset(sizeof(uint32_t) * BLASInfo.firstIndex);
+ext::BottomLevelAccelerationStructure Interface::createBottomLevelAccelerationStructure(
+    ext::BottomLevelAccelerationStructureInfo const& BLASInfo)
+{
+    return createBottomLevelAccelerationStructures({BLASInfo}).front();
+}
 
-    {
-        OneTimeCommand ot{device, cmdPool, renderQueue};
-        ot.cmd.buildAccelerationStructuresKHR(buildInfo, &rangeInfo);
+std::vector<ext::BottomLevelAccelerationStructure> Interface::createBottomLevelAccelerationStructures(
+    std::vector<ext::BottomLevelAccelerationStructureInfo> const& BLASInfos, bool waitForBuild)
+{
+    auto& device = state->device;
+    auto& renderQueue = state->renderQueue;
+    auto& cmdPool = state->cmdPool;
+    auto& acclerationStructures = state->acclerationStructures;
+
+    state->releaseFinishedBuilds();
+    if (BLASInfos.empty()) return {};
+
+    // The build infos point into these, so they must not be resized after this
+    std::vector<std::vector<vk::AccelerationStructureGeometryKHR>> geometries(BLASInfos.size());
+    std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> buildInfos(BLASInfos.size());
+    std::vector<std::vector<vk::AccelerationStructureBuildRangeInfoKHR>> rangeInfos(BLASInfos.size());
+    std::vector<vk::DeviceSize> scratchSizes(BLASInfos.size());
+    std::vector<ext::BottomLevelAccelerationStructure> handles;
+    handles.reserve(BLASInfos.size());
+    vk::DeviceSize scratchAlignment = state->features.minScratchOffsetAlignment;
+
+    // Per-geometry transforms of all builds are uploaded into one buffer
+    std::vector<vk::TransformMatrixKHR> transforms;
+    for (auto& BLASInfo : BLASInfos)
+        for (auto& geometry : BLASInfo.geometries)
+            if (geometry.transform) transforms.push_back(*geometry.transform);
+    vk::Buffer transformBuffer;
+    vk::DeviceMemory transformMemory;
+    vk::DeviceAddress transformAddress{0};
+    if (!transforms.empty()) {
+        transformBuffer = device.createBuffer(
+            vk::BufferCreateInfo()
+                .setSize(transforms.size() * sizeof(vk::TransformMatrixKHR))
+                .setUsage(vk::BufferUsageFlagBits::eAccelerationStructureBuildInputReadOnlyKHR |
+                          vk::BufferUsageFlagBits::eShaderDeviceAddress | vk::BufferUsageFlagBits::eTransferDst)
+                .setQueueFamilyIndices(state->renderQueueFamily));
+        auto transformMemReqs = device.getBufferMemoryRequirements(transformBuffer);
+        vk::MemoryAllocateFlagsInfo memFlags{vk::MemoryAllocateFlagBits::eDeviceAddress};
+        transformMemory = device.allocateMemory({transformMemReqs.size, state->deviceMemoryIndex, &memFlags});
+        device.bindBufferMemory(transformBuffer, transformMemory, 0);
+        transformAddress = device.getBufferAddress(transformBuffer);
     }
 
-    auto idx = acclerationStructures.insert({blas, acBuffer, acMem});
+    uint32_t transformIndex{0};
+    for (size_t i = 0; i < BLASInfos.size(); ++i) {
+        auto& BLASInfo = BLASInfos[i];
+        std::vector<uint32_t> primitiveCounts;
+        for (auto& geometry : triangleGeometries(BLASInfo)) {
+            auto& vertexBuffer = state->getData(geometry.vertexBuffer).buffer;
+            auto& indexBuffer = state->getData(geometry.indexBuffer).buffer;
+
+            // for geometry description
+            auto primitiveCount = geometry.indexCount / 3;
+            assert(primitiveCount * 3 == geometry.indexCount);
+            auto triangleData = vk::AccelerationStructureGeometryTrianglesDataKHR{}
+                                    .setIndexType(vk::IndexType::eUint32)
+                                    .setIndexData(device.getBufferAddress(indexBuffer))
+                                    .setVertexData(device.getBufferAddress(vertexBuffer))
+                                    .setVertexFormat(tgaFormatToVkFormat(geometry.vertexPositionFormat))
+                                    .setVertexStride(geometry.vertexStride)
+                                    .setMaxVertex(geometry.firstIndex + geometry.indexCount);
+            auto rangeInfo = vk::AccelerationStructureBuildRangeInfoKHR{}
+                                 .setFirstVertex(geometry.vertexOffset)
+                                 .setPrimitiveCount(primitiveCount)
+                                 .setPrimitiveOffset(sizeof(uint32_t) * geometry.firstIndex);
+            if (geometry.transform) {
+                triangleData.setTransformData(transformAddress);
+                rangeInfo.setTransformOffset(sizeof(vk::TransformMatrixKHR) * transformIndex++);
+            }
+
+            geometries[i].push_back(vk::AccelerationStructureGeometryKHR{}
+                                        .setGeometryType(vk::GeometryTypeKHR::eTriangles)
+                                        .setFlags(determineGeometryFlags(geometry.flags))
+                                        .setGeometry(triangleData));
+            rangeInfos[i].push_back(rangeInfo);
+            primitiveCounts.push_back(primitiveCount);
+        }
 
-    device.destroy(scratchBuffer);
-    device.free(scratchBufferMem);
-    return tga::ext::BottomLevelAccelerationStructure{toRawHandle<TgaBottomLevelAccelerationStructure>(idx)};
+        buildInfos[i]
+            .setType(vk::AccelerationStructureTypeKHR::eBottomLevel)
+            .setMode(vk::BuildAccelerationStructureModeKHR::eBuild)
+            .setGeometries(geometries[i])
+            .setFlags(vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace);
+        if (BLASInfo.allowCompaction)
+            buildInfos[i].flags |= vk::BuildAccelerationStructureFlagBitsKHR::eAllowCompaction;
+
+        auto buildSizes = device.getAccelerationStructureBuildSizesKHR(
+            vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfos[i], primitiveCounts);
+        scratchSizes[i] = alignUp(buildSizes.buildScratchSize, scratchAlignment);
+
+        auto blas = state->createAccelerationStructure(vk::AccelerationStructureTypeKHR::eBottomLevel,
+                                                       buildSizes.accelerationStructureSize);
+        buildInfos[i].setDstAccelerationStructure(blas.accelerationStructure);
+        handles.push_back(
+            toRawHandle<TgaBottomLevelAccelerationStructure>(acclerationStructures.insert(std::move(blas))));
+    }
+
+    // One scratch buffer for everything, unless that exceeds the budget. A single larger build still gets its size
+    vk::DeviceSize totalScratchSize{0};
+    for (auto size : scratchSizes) totalScratchSize += size;
+    auto scratchSize = std::max(std::min(totalScratchSize, scratchBudget),
+                                *std::max_element(scratchSizes.begin(), scratchSizes.end()));
+    auto [scratchBuffer, scratchMemory] = state->createScratchBuffer(scratchSize);
+    auto scratchAddress = device.getBufferAddress(scratchBuffer);
+
+    auto cmd = device.allocateCommandBuffers({cmdPool, vk::CommandBufferLevel::ePrimary, 1})[0];
+    cmd.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    std::vector<vk::AccelerationStructureBuildRangeInfoKHR const *> rangeInfoPtrs;
+    for (auto& rangeInfo : rangeInfos) rangeInfoPtrs.push_back(rangeInfo.data());
+    if (transformBuffer) {
+        updateBufferChunked(cmd, transformBuffer, transforms.data(),
+                            transforms.size() * sizeof(vk::TransformMatrixKHR));
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                            vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR, {},
+                            vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead), {},
+                            {});
+    }
+
+    // Builds of a batch run concurrently, each in its own part of the scratch buffer
+    auto buildBatch = [&](size_t first, size_t last) {
+        cmd.buildAccelerationStructuresKHR(static_cast<uint32_t>(last - first), buildInfos.data() + first,
+                                           rangeInfoPtrs.data() + first);
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+                            vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR |
+                                vk::PipelineStageFlagBits::eAllCommands,
+                            {},
+                            vk::MemoryBarrier(vk::AccessFlagBits::eAccelerationStructureWriteKHR,
+                                              vk::AccessFlagBits::eAccelerationStructureReadKHR |
+                                                  vk::AccessFlagBits::eAccelerationStructureWriteKHR),
+                            {}, {});
+    };
+    size_t batchStart{0};
+    vk::DeviceSize scratchOffset{0};
+    for (size_t i = 0; i < buildInfos.size(); ++i) {
+        if (scratchOffset + scratchSizes[i] > scratchSize) {
+            buildBatch(batchStart, i);
+            batchStart = i;
+            scratchOffset = 0;
+        }
+        buildInfos[i].setScratchData(scratchAddress + scratchOffset);
+        scratchOffset += scratchSizes[i];
+    }
+    buildBatch(batchStart, buildInfos.size());
+
+    // The compacted sizes are written by the GPU once the builds are done
+    std::vector<size_t> compactable;
+    for (size_t i = 0; i < BLASInfos.size(); ++i)
+        if (BLASInfos[i].allowCompaction) compactable.push_back(i);
+    auto compactCount = static_cast<uint32_t>(compactable.size());
+    vk::QueryPool compactedSizeQueries;
+    if (compactCount) {
+        compactedSizeQueries = device.createQueryPool(
+            vk::QueryPoolCreateInfo({}, vk::QueryType::eAccelerationStructureCompactedSizeKHR, compactCount));
+        std::vector<vk::AccelerationStructureKHR> structures;
+        for (auto i : compactable) structures.push_back(buildInfos[i].dstAccelerationStructure);
+        cmd.resetQueryPool(compactedSizeQueries, 0, compactCount);
+        cmd.writeAccelerationStructuresPropertiesKHR(
+            structures, vk::QueryType::eAccelerationStructureCompactedSizeKHR, compactedSizeQueries, 0);
+    }
+    cmd.end();
+
+    auto completionFence = device.createFence({});
+    renderQueue.submit(vk::SubmitInfo().setCommandBuffers(cmd), completionFence);
+    state->pendingBuilds.push_back(
+        {cmd, completionFence, scratchBuffer, scratchMemory, transformBuffer, transformMemory});
+    if (waitForBuild || compactCount) {
+        std::ignore = device.waitForFences(completionFence, true, std::numeric_limits<uint64_t>::max());
+        state->releaseFinishedBuilds();
+    }
+    if (!compactCount) return handles;
+
+    // Copy into right-sized structures and release the originals, the handles stay the same
+    auto compactedSizes = device
+                              .getQueryPoolResults<vk::DeviceSize>(
+                                  compactedSizeQueries, 0, compactCount, compactCount * sizeof(vk::DeviceSize),
+                                  sizeof(vk::DeviceSize),
+                                  vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait)
+                              .value;
+    device.destroy(compactedSizeQueries);
+
+    std::vector<vkData::ext::AccelerationStructure> compacted;
+    {
+        OneTimeCommand ot{device, cmdPool, renderQueue};
+        for (uint32_t j = 0; j < compactCount; ++j) {
+            compacted.push_back(
+                state->createAccelerationStructure(vk::AccelerationStructureTypeKHR::eBottomLevel, compactedSizes[j]));
+            ot.cmd.copyAccelerationStructureKHR(vk::CopyAccelerationStructureInfoKHR(
+                buildInfos[compactable[j]].dstAccelerationStructure, compacted.back().accelerationStructure,
+                vk::CopyAccelerationStructureModeKHR::eCompact));
+        }
+        ot.cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+                               vk::PipelineStageFlagBits::eAllCommands, {},
+                               vk::MemoryBarrier(vk::AccessFlagBits::eAccelerationStructureWriteKHR,
+                                                 vk::AccessFlagBits::eAccelerationStructureReadKHR),
+                               {}, {});
+    }
+    for (uint32_t j = 0; j < compactCount; ++j) {
+        auto& data = state->getData(handles[compactable[j]]);
+        device.destroyAccelerationStructureKHR(data.accelerationStructure);
+        device.destroy(data.buffer);
+        device.free(data.memory);
+        data = std::move(compacted[j]);
+    }
+    return handles;
 }
 
 CommandBuffer Interface::beginCommandBuffer(CommandBuffer cmdBuffer)
@@ -1246,6 +2284,12 @@ CommandBuffer Interface::beginCommandBuffer(CommandBuffer cmdBuffer)
 
     std::ignore = device.waitForFences(cmdData.completionFence, true, std::numeric_limits<uint64_t>::max());
     device.resetFences(cmdData.completionFence);
+    cmdData.currentPass = {};
+
+    // The previous recording has finished executing, so its transient descriptor sets can be recycled
+    for (auto& pool : cmdData.transientDescriptors.pools) device.resetDescriptorPool(pool);
+    cmdData.transientDescriptors.currentPool = 0;
+
     cmdData.cmdBuffer.begin({vk::CommandBufferUsageFlagBits::eSimultaneousUse});
 
     return cmdBuffer;
@@ -1267,6 +2311,56 @@ void Interface::bindInputSet(CommandBuffer cmdBuffer, InputSet inputSet)
                                                            inputSetData.index, 1, &inputSetData.descriptorSet, 0,
                                                            nullptr);
 }
+void Interface::bindTransientInputSet(CommandBuffer cmdBuffer, InputSetInfo const& inputSetInfo)
+{
+    auto& cmdData = state->getData(cmdBuffer);
+    auto& layoutData = state->getLayout(inputSetInfo);
+    vk::PipelineBindPoint bindPoint = std::holds_alternative<tga::RenderPass>(inputSetInfo.targetPass)
+                                          ? vk::PipelineBindPoint::eGraphics
+                                          : vk::PipelineBindPoint::eCompute;
+    if (layoutData.setSources[inputSetInfo.index] == vkData::DescriptorSource::pushDescriptor)
+        throw std::runtime_error("[TGA Vulkan] Transient InputSets can't be created for the push descriptor set " +
+                                 std::to_string(inputSetInfo.index) + ", use pushBindings instead");
+
+    auto descriptorSet = state->allocateTransientDescriptorSet(cmdData, layoutData.setLayouts[inputSetInfo.index]);
+    state->writeBindings(descriptorSet, layoutData.setDescriptorTypes[inputSetInfo.index], inputSetInfo.bindings);
+    cmdData.cmdBuffer.bindDescriptorSets(bindPoint, layoutData.pipelineLayout, inputSetInfo.index, 1, &descriptorSet,
+                                         0, nullptr);
+}
+void Interface::pushBindings(CommandBuffer cmdBuffer, uint32_t setIndex, std::vector<Binding> const& bindings)
+{
+    auto& cmdData = state->getData(cmdBuffer);
+    auto renderPass = std::get_if<tga::RenderPass>(&cmdData.currentPass);
+    auto computePass = std::get_if<tga::ComputePass>(&cmdData.currentPass);
+    if (!renderPass && !computePass)
+        throw std::runtime_error("[TGA Vulkan] pushBindings requires a RenderPass or ComputePass to be set");
+
+    auto& layoutData = renderPass ? state->getData(*renderPass).subpasses[cmdData.currentSubpass].layout
+                                  : state->getData(*computePass).layout;
+    vk::PipelineBindPoint bindPoint = renderPass ? vk::PipelineBindPoint::eGraphics : vk::PipelineBindPoint::eCompute;
+    if (setIndex >= layoutData.setLayouts.size())
+        throw std::runtime_error("[TGA Vulkan] pushBindings: Set " + std::to_string(setIndex) +
+                                 " is not part of the inputLayout of the current pass");
+    auto& descriptorTypes = layoutData.setDescriptorTypes[setIndex];
+
+    switch (layoutData.setSources[setIndex]) {
+        case vkData::DescriptorSource::pushDescriptor: {
+            // Recorded directly into the command buffer, no descriptor pool is involved
+            auto writes = state->collectWrites({}, descriptorTypes, bindings);
+            cmdData.cmdBuffer.pushDescriptorSetKHR(bindPoint, layoutData.pipelineLayout, setIndex, writes.writeSets);
+            break;
+        }
+        case vkData::DescriptorSource::transient: {
+            auto descriptorSet = state->allocateTransientDescriptorSet(cmdData, layoutData.setLayouts[setIndex]);
+            state->writeBindings(descriptorSet, descriptorTypes, bindings);
+            cmdData.cmdBuffer.bindDescriptorSets(bindPoint, layoutData.pipelineLayout, setIndex, descriptorSet, {});
+            break;
+        }
+        case vkData::DescriptorSource::inputSet:
+            throw std::runtime_error("[TGA Vulkan] Set " + std::to_string(setIndex) +
+                                     " is not push-only, it is provided with InputSets");
+    }
+}
 void Interface::draw(CommandBuffer cmdBuffer, uint32_t vertexCount, uint32_t firstVertex, uint32_t instanceCount,
                      uint32_t firstInstance)
 {
@@ -1287,6 +2381,31 @@ void Interface::drawIndexedIndirect(CommandBuffer cmdBuffer, Buffer buffer, uint
     state->getData(cmdBuffer).cmdBuffer.drawIndexedIndirect(state->getData(buffer).buffer, offset, drawCount, stride);
 }
 
+void Interface::setCullMode(CommandBuffer cmdBuffer, CullMode cullMode)
+{
+    state->getData(cmdBuffer).cmdBuffer.setCullModeEXT(determineCullMode(cullMode));
+}
+void Interface::setFrontFace(CommandBuffer cmdBuffer, FrontFace frontFace)
+{
+    state->getData(cmdBuffer).cmdBuffer.setFrontFaceEXT(determineFrontFace(frontFace));
+}
+void Interface::setPrimitiveTopology(CommandBuffer cmdBuffer, PrimitiveTopology primitiveTopology)
+{
+    state->getData(cmdBuffer).cmdBuffer.setPrimitiveTopologyEXT(determinePrimitiveTopology(primitiveTopology));
+}
+void Interface::setDepthTestEnabled(CommandBuffer cmdBuffer, bool enabled)
+{
+    state->getData(cmdBuffer).cmdBuffer.setDepthTestEnableEXT(enabled);
+}
+void Interface::setDepthWriteEnabled(CommandBuffer cmdBuffer, bool enabled)
+{
+    state->getData(cmdBuffer).cmdBuffer.setDepthWriteEnableEXT(enabled);
+}
+void Interface::setDepthCompareOp(CommandBuffer cmdBuffer, CompareOperation compareOperation)
+{
+    state->getData(cmdBuffer).cmdBuffer.setDepthCompareOpEXT(determineDepthCompareOp(compareOperation));
+}
+
 void Interface::barrier(CommandBuffer cmdBuffer, PipelineStage srcStage, PipelineStage dstStage)
 {
     auto tgaToVkStage = [](tga::PipelineStage stage) -> vk::PipelineStageFlagBits {
@@ -1337,30 +2456,218 @@ void Interface::bufferDownload(CommandBuffer cmdBuffer, Buffer src, StagingBuffe
     state->getData(cmdBuffer).cmdBuffer.copyBuffer(srcBuffer, dstBuffer, vk::BufferCopy(srcOffset, dstOffset, size));
 }
 
-void Interface::textureDownload(CommandBuffer cmdBuffer, Texture src, StagingBuffer dst, size_t dstOffset)
+namespace /*texture transfers*/
 {
+    // Copy instructions of a region, validated against the Texture
+    vk::BufferImageCopy regionCopy(vkData::Texture const& texture, TextureRegion const& region, char const *command)
+    {
+        auto fail = [&](std::string const& reason) {
+            return std::runtime_error(std::string("[TGA Vulkan] ") + command + ": " + reason);
+        };
+        if (region.mipLevel >= texture.mipLevels)
+            throw fail("Mip level " + std::to_string(region.mipLevel) + " does not exist, the Texture has " +
+                       std::to_string(texture.mipLevels));
+        if (region.layerCount == 0 || region.baseLayer + region.layerCount > texture.layers)
+            throw fail("Layers [" + std::to_string(region.baseLayer) + ", " +
+                       std::to_string(region.baseLayer + region.layerCount) + ") exceed the " +
+                       std::to_string(texture.layers) + " layers of the Texture");
+
+        vk::Extent3D levelExtent{std::max(texture.extent.width >> region.mipLevel, 1u),
+                                 std::max(texture.extent.height >> region.mipLevel, 1u),
+                                 std::max(texture.extent.depth >> region.mipLevel, 1u)};
+        if (region.x >= levelExtent.width || region.y >= levelExtent.height || region.z >= levelExtent.depth)
+            throw fail("Region offset lies outside of mip level " + std::to_string(region.mipLevel));
+        vk::Extent3D extent{region.width ? region.width : levelExtent.width - region.x,
+                            region.height ? region.height : levelExtent.height - region.y,
+                            region.depth ? region.depth : levelExtent.depth - region.z};
+        if (region.x + extent.width > levelExtent.width || region.y + extent.height > levelExtent.height ||
+            region.z + extent.depth > levelExtent.depth)
+            throw fail("Region exceeds mip level " + std::to_string(region.mipLevel));
+
+        // Block-compressed regions have to consist of whole blocks, except at the edge of the level
+        auto block = formatBlockInfo(texture.textureFormat);
+        bool alignedOffset = region.x % block.width == 0 && region.y % block.height == 0;
+        bool alignedExtent = (extent.width % block.width == 0 || region.x + extent.width == levelExtent.width) &&
+                             (extent.height % block.height == 0 || region.y + extent.height == levelExtent.height);
+        if (!alignedOffset || !alignedExtent)
+            throw fail("Region is not aligned to the " + std::to_string(block.width) + "x" +
+                       std::to_string(block.height) + " blocks of the format");
+        if (block.size && region.bufferOffset % block.size != 0)
+            throw fail("Buffer offset must be a multiple of the texel block size of " + std::to_string(block.size));
+
+        return vk::BufferImageCopy(region.bufferOffset)
+            .setImageOffset({static_cast<int32_t>(region.x), static_cast<int32_t>(region.y),
+                             static_cast<int32_t>(region.z)})
+            .setImageExtent(extent)
+            .setImageSubresource(
+                {vk::ImageAspectFlagBits::eColor, region.mipLevel, region.baseLayer, region.layerCount});
+    }
+
+    std::vector<vk::BufferImageCopy> regionCopies(vkData::Texture const& texture,
+                                                  std::vector<TextureRegion> const& regions, char const *command)
+    {
+        std::vector<vk::BufferImageCopy> copies;
+        copies.reserve(regions.size());
+        for (auto& region : regions) copies.push_back(regionCopy(texture, region, command));
+        return copies;
+    }
+
+    // Copies are not allowed inside a render pass, so the commands that record them end the current one
+    void endRenderPass(vkData::CommandBuffer& cmdData)
+    {
+        if (!cmdData.currentRenderPass) return;
+        cmdData.cmdBuffer.endRenderPass();
+        cmdData.currentRenderPass = vk::RenderPass{};
+        cmdData.currentPass = {};
+    }
+
+    // Textures are read and written by shaders and rendered into as color or depth attachments
+    constexpr auto textureAccessStages =
+        vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader |
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eColorAttachmentOutput |
+        vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+    // Transfers also wait for earlier transfers into the Texture, e.g. by generateMipmaps
+    constexpr auto textureWriteStages = textureAccessStages | vk::PipelineStageFlagBits::eTransfer;
+    constexpr auto textureWriteAccess = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eColorAttachmentWrite |
+                                        vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+                                        vk::AccessFlagBits::eTransferWrite;
+}  // namespace
+
+void Interface::textureDownload(CommandBuffer cmdBuffer, Texture src, StagingBuffer dst, size_t dstOffset,
+                                uint32_t mipLevel)
+{
+    textureDownload(cmdBuffer, src, dst, {TextureRegion{dstOffset, mipLevel}});
+}
+
+void Interface::textureUpload(CommandBuffer cmdBuffer, StagingBuffer src, Texture dst,
+                              std::vector<TextureRegion> const& regions)
+{
+    if (regions.empty()) return;
+    auto& imageData = state->getData(dst);
+    auto srcBuffer = state->getData(src).buffer;
+    auto& cmdData = state->getData(cmdBuffer);
+    auto copies = regionCopies(imageData, regions, "textureUpload");
+
+    endRenderPass(cmdData);
+    auto& cmd = cmdData.cmdBuffer;
+    cmd.pipelineBarrier(textureWriteStages, vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
+                        layoutTransitionBarrier(imageData.image, vk::ImageLayout::eGeneral,
+                                                vk::ImageLayout::eTransferDstOptimal, vk::ImageAspectFlagBits::eColor)
+                            .setSrcAccessMask(textureWriteAccess));
+    cmd.copyBufferToImage(srcBuffer, imageData.image, vk::ImageLayout::eTransferDstOptimal, copies);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, textureAccessStages, {}, {}, {},
+                        layoutTransitionBarrier(imageData.image, vk::ImageLayout::eTransferDstOptimal,
+                                                vk::ImageLayout::eGeneral, vk::ImageAspectFlagBits::eColor));
+}
+
+void Interface::textureDownload(CommandBuffer cmdBuffer, Texture src, StagingBuffer dst,
+                                std::vector<TextureRegion> const& regions)
+{
+    if (regions.empty()) return;
     auto& imageData = state->getData(src);
     auto dstBuffer = state->getData(dst).buffer;
-    auto& cmd = state->getData(cmdBuffer).cmdBuffer;
+    auto& cmdData = state->getData(cmdBuffer);
+    auto copies = regionCopies(imageData, regions, "textureDownload");
 
-    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eFragmentShader,
-                        vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
+    endRenderPass(cmdData);
+    auto& cmd = cmdData.cmdBuffer;
+    cmd.pipelineBarrier(textureWriteStages, vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
                         layoutTransitionBarrier(imageData.image, vk::ImageLayout::eGeneral,
-                                                vk::ImageLayout::eTransferSrcOptimal, vk::ImageAspectFlagBits::eColor));
-    cmd.copyImageToBuffer(imageData.image, vk::ImageLayout::eTransferSrcOptimal, dstBuffer,
-                          vk::BufferImageCopy(dstOffset)
-                              .setImageExtent(imageData.extent)
-                              .setImageSubresource(vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor}
-                                                       .setLayerCount(1)
-                                                       .setBaseArrayLayer(0)
-                                                       .setMipLevel(0)));
-    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                        vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eComputeShader, {}, {},
-                        {},
+                                                vk::ImageLayout::eTransferSrcOptimal, vk::ImageAspectFlagBits::eColor)
+                            .setSrcAccessMask(textureWriteAccess));
+    cmd.copyImageToBuffer(imageData.image, vk::ImageLayout::eTransferSrcOptimal, dstBuffer, copies);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, textureAccessStages, {}, {}, {},
                         layoutTransitionBarrier(imageData.image, vk::ImageLayout::eTransferSrcOptimal,
                                                 vk::ImageLayout::eGeneral, vk::ImageAspectFlagBits::eColor));
 }
 
+void Interface::generateMipmaps(CommandBuffer cmdBuffer, Texture texture)
+{
+    auto& cmdData = state->getData(cmdBuffer);
+    auto& textureData = state->getData(texture);
+    if (textureData.mipLevels < 2) return;
+    constexpr auto blitFeatures = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst;
+    if ((state->pDevice.getFormatProperties(textureData.format).optimalTilingFeatures & blitFeatures) != blitFeatures)
+        throw std::runtime_error("[TGA Vulkan] generateMipmaps: Image format " + vk::to_string(textureData.format) +
+                                 " does not support generating mip levels on this system");
+
+    // Blits are not allowed inside a render pass
+    endRenderPass(cmdData);
+    recordMipChain(cmdData.cmdBuffer, textureData);
+}
+
+void Interface::InternalState::recordTopLevelUpdate(vkData::CommandBuffer& cmdData,
+                                                    vkData::ext::AccelerationStructure& tlasData,
+                                                    vk::DeviceAddress instances)
+{
+    auto instanceGeometry =
+        vk::AccelerationStructureGeometryKHR{}
+            .setGeometry(vk::AccelerationStructureGeometryInstancesDataKHR{}.setData(instances))
+            .setGeometryType(vk::GeometryTypeKHR::eInstances);
+    auto buildInfo = topLevelBuildInfo(instanceGeometry, true)
+                         .setMode(vk::BuildAccelerationStructureModeKHR::eUpdate)
+                         .setSrcAccelerationStructure(tlasData.accelerationStructure)
+                         .setDstAccelerationStructure(tlasData.accelerationStructure)
+                         .setScratchData(device.getBufferAddress(tlasData.scratchBuffer));
+    auto rangeInfo = vk::AccelerationStructureBuildRangeInfoKHR{}.setPrimitiveCount(tlasData.instanceCount);
+
+    auto& cmd = cmdData.cmdBuffer;
+    auto buildStage = vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR;
+    // Instances may have been written by transfers or shaders, and previous traces must be done with the structure
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, buildStage, {},
+                        vk::MemoryBarrier(vk::AccessFlagBits::eMemoryWrite, vk::AccessFlagBits::eShaderRead), {}, {});
+    cmd.buildAccelerationStructuresKHR(buildInfo, &rangeInfo);
+    cmd.pipelineBarrier(buildStage, vk::PipelineStageFlagBits::eAllCommands, {},
+                        vk::MemoryBarrier(vk::AccessFlagBits::eAccelerationStructureWriteKHR,
+                                          vk::AccessFlagBits::eAccelerationStructureReadKHR),
+                        {}, {});
+}
+
+void Interface::updateTopLevelAccelerationStructure(
+    CommandBuffer cmdBuffer, ext::TopLevelAccelerationStructure tlas,
+    std::vector<ext::AccelerationStructureInstanceInfo> const& instances)
+{
+    auto& device = state->device;
+    auto& cmdData = state->getData(cmdBuffer);
+    auto& tlasData = state->getData(tlas);
+    if (!tlasData.scratchBuffer)
+        throw std::runtime_error("[TGA Vulkan] updateTopLevelAccelerationStructure: The acceleration structure was not "
+                                 "created with allowUpdate");
+    if (!tlasData.instanceBuffer)
+        throw std::runtime_error("[TGA Vulkan] updateTopLevelAccelerationStructure: The acceleration structure was "
+                                 "created from an instance Buffer, update it from a Buffer as well");
+    if (instances.size() != tlasData.instanceCount)
+        throw std::runtime_error("[TGA Vulkan] updateTopLevelAccelerationStructure: Expected " +
+                                 std::to_string(tlasData.instanceCount) + " instances, got " +
+                                 std::to_string(instances.size()) + ". Create a new structure to change the count");
+
+    auto vkInstances = state->toInstances(instances);
+
+    // Transfers and builds are not allowed inside a render pass
+    endRenderPass(cmdData);
+    auto& cmd = cmdData.cmdBuffer;
+    // Previous builds must be done with the instances before they are overwritten
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, {});
+    updateBufferChunked(cmd, tlasData.instanceBuffer, vkInstances.data(),
+                        vkInstances.size() * sizeof(vk::AccelerationStructureInstanceKHR));
+    state->recordTopLevelUpdate(cmdData, tlasData, device.getBufferAddress(tlasData.instanceBuffer));
+}
+
+void Interface::updateTopLevelAccelerationStructure(CommandBuffer cmdBuffer, ext::TopLevelAccelerationStructure tlas,
+                                                    Buffer instanceBuffer, size_t instanceBufferOffset)
+{
+    auto& cmdData = state->getData(cmdBuffer);
+    auto& tlasData = state->getData(tlas);
+    if (!tlasData.scratchBuffer)
+        throw std::runtime_error("[TGA Vulkan] updateTopLevelAccelerationStructure: The acceleration structure was not "
+                                 "created with allowUpdate");
+    auto instances = state->instanceBufferAddress(instanceBuffer, instanceBufferOffset, tlasData.instanceCount);
+
+    // Builds are not allowed inside a render pass
+    endRenderPass(cmdData);
+    state->recordTopLevelUpdate(cmdData, tlasData, instances);
+}
+
 void Interface::setRenderPass(CommandBuffer cmdBuffer, RenderPass renderPass, uint32_t framebufferIndex,
                               std::array<float, 4> const& colorClearValue, float depthClearValue)
 {
@@ -1368,10 +2675,12 @@ void Interface::setRenderPass(CommandBuffer cmdBuffer, RenderPass renderPass, ui
     auto& renderPassData = state->getData(renderPass);
     if (cmdData.currentRenderPass) cmdData.cmdBuffer.endRenderPass();
     cmdData.currentRenderPass = renderPassData.renderPass;
+    cmdData.currentPass = renderPass;
+    cmdData.currentSubpass = 0;
 
     std::vector<vk::ClearValue> clearValues(renderPassData.numColorAttachmentsPerFrameBuffer,
                                             vk::ClearColorValue(colorClearValue));
-    clearValues.push_back(vk::ClearDepthStencilValue(depthClearValue, 0));
+    if (renderPassData.hasDepthAttachment) clearValues.push_back(vk::ClearDepthStencilValue(depthClearValue, 0));
 
     uint32_t frameIndex = std::min(framebufferIndex, uint32_t(renderPassData.framebuffers.size() - 1));
     cmdData.cmdBuffer.beginRenderPass(
@@ -1380,19 +2689,53 @@ void Interface::setRenderPass(CommandBuffer cmdBuffer, RenderPass renderPass, ui
             .setRenderArea(vk::Rect2D().setExtent(renderPassData.area)),
         vk::SubpassContents::eInline);
 
-    cmdData.cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, renderPassData.pipeline);
+    auto& subpass = renderPassData.subpasses[0];
+    bindPipeline(cmdData.cmdBuffer, vk::PipelineBindPoint::eGraphics, subpass.pipeline, subpass.layout,
+                 state->bindlessTable.descriptorSet);
     cmdData.cmdBuffer.setViewport(0, vk::Viewport()
                                          .setWidth(static_cast<float>(renderPassData.area.width))
                                          .setHeight(static_cast<float>(renderPassData.area.height))
                                          .setMinDepth(0)
                                          .setMaxDepth(1));
     cmdData.cmdBuffer.setScissor(0, {{{}, renderPassData.area}});
+
+    auto& dynamicState = renderPassData.dynamicState;
+    auto& cmd = cmdData.cmdBuffer;
+    if (dynamicState.enabled & DynamicState::cullMode) cmd.setCullModeEXT(dynamicState.cullMode);
+    if (dynamicState.enabled & DynamicState::frontFace) cmd.setFrontFaceEXT(dynamicState.frontFace);
+    if (dynamicState.enabled & DynamicState::primitiveTopology)
+        cmd.setPrimitiveTopologyEXT(dynamicState.primitiveTopology);
+    if (dynamicState.enabled & DynamicState::depthTest) cmd.setDepthTestEnableEXT(dynamicState.depthTestEnable);
+    if (dynamicState.enabled & DynamicState::depthWrite) cmd.setDepthWriteEnableEXT(dynamicState.depthWriteEnable);
+    if (dynamicState.enabled & DynamicState::depthCompareOp) cmd.setDepthCompareOpEXT(dynamicState.depthCompareOp);
+}
+
+void Interface::nextSubpass(CommandBuffer cmdBuffer)
+{
+    auto& cmdData = state->getData(cmdBuffer);
+    auto renderPass = std::get_if<tga::RenderPass>(&cmdData.currentPass);
+    if (!renderPass || !cmdData.currentRenderPass)
+        throw std::runtime_error("[TGA Vulkan] nextSubpass requires a RenderPass to be set");
+
+    auto& subpasses = state->getData(*renderPass).subpasses;
+    if (cmdData.currentSubpass + 1 >= subpasses.size())
+        throw std::runtime_error("[TGA Vulkan] nextSubpass: The RenderPass has no subpass after subpass " +
+                                 std::to_string(cmdData.currentSubpass));
+
+    // Viewport, scissor and the dynamic states are left untouched by binding the pipeline of the next subpass
+    auto& subpass = subpasses[++cmdData.currentSubpass];
+    cmdData.cmdBuffer.nextSubpass(vk::SubpassContents::eInline);
+    bindPipeline(cmdData.cmdBuffer, vk::PipelineBindPoint::eGraphics, subpass.pipeline, subpass.layout,
+                 state->bindlessTable.descriptorSet);
 }
 
 void Interface::setComputePass(CommandBuffer cmdBuffer, ComputePass computePass)
 {
-    state->getData(cmdBuffer).cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
-                                                     state->getData(computePass).pipeline);
+    auto& cmdData = state->getData(cmdBuffer);
+    auto& computePassData = state->getData(computePass);
+    cmdData.currentPass = computePass;
+    bindPipeline(cmdData.cmdBuffer, vk::PipelineBindPoint::eCompute, computePassData.pipeline, computePassData.layout,
+                 state->bindlessTable.descriptorSet);
 }
 
 void Interface::endCommandBuffer(CommandBuffer cmdBuffer)
@@ -1421,16 +2764,319 @@ void Interface::waitForCompletion(CommandBuffer cmdBuffer)
 
 void *Interface::getMapping(StagingBuffer stagingBuffer) { return state->getData(stagingBuffer).mapping; }
 
+ReadbackTicket Interface::InternalState::submitReadback(
+    size_t size, ReadbackCallback&& callback, std::function<void(vk::CommandBuffer, vk::Buffer)> recordCopy)
+{
+    auto& slots = readbacks.slots;
+    auto& freeSlots = readbacks.freeSlots;
+
+    // Take the smallest free slot that fits, otherwise grow the largest one
+    size_t slotIndex;
+    if (freeSlots.empty()) {
+        slotIndex = slots.size();
+        slots.push_back({});
+        slots.back().cmdBuffer = device.allocateCommandBuffers({cmdPool, vk::CommandBufferLevel::ePrimary, 1})[0];
+        slots.back().completionFence = device.createFence({});
+    } else {
+        auto best = freeSlots.begin();
+        for (auto it = freeSlots.begin(); it != freeSlots.end(); ++it) {
+            auto capacity = slots[*it].capacity;
+            auto bestCapacity = slots[*best].capacity;
+            bool fits = capacity >= size;
+            bool bestFits = bestCapacity >= size;
+            if ((fits && (!bestFits || capacity < bestCapacity)) || (!fits && !bestFits && capacity > bestCapacity))
+                best = it;
+        }
+        slotIndex = *best;
+        freeSlots.erase(best);
+    }
+
+    auto& slot = slots[slotIndex];
+    if (slot.capacity < size) {
+        if (slot.buffer) {
+            device.destroy(slot.buffer);
+            device.free(slot.memory);
+        }
+        slot.buffer = device.createBuffer(vk::BufferCreateInfo()
+                                              .setSize(size)
+                                              .setUsage(vk::BufferUsageFlagBits::eTransferDst)
+                                              .setQueueFamilyIndices(renderQueueFamily));
+        auto mr = device.getBufferMemoryRequirements(slot.buffer);
+        slot.memory = device.allocateMemory({mr.size, readbackMemoryIndex});
+        device.bindBufferMemory(slot.buffer, slot.memory, 0);
+        slot.mapping = device.mapMemory(slot.memory, 0, VK_WHOLE_SIZE);
+        slot.capacity = size;
+    }
+
+    auto& cmd = slot.cmdBuffer;
+    cmd.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    // Writes of previously submitted CommandBuffers have to be visible to the copy
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer, {},
+                        vk::MemoryBarrier(vk::AccessFlagBits::eMemoryWrite, vk::AccessFlagBits::eTransferRead), {},
+                        {});
+    recordCopy(cmd, slot.buffer);
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {},
+                        vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead), {}, {});
+    cmd.end();
+    renderQueue.submit(vk::SubmitInfo().setCommandBuffers(cmd), slot.completionFence);
+
+    auto ticket = readbacks.nextTicket++;
+    readbacks.pending.emplace(ticket, vkData::Readback{slotIndex, size, std::move(callback)});
+    return {ticket};
+}
+
+bool Interface::InternalState::updateReadback(vkData::Readback& readback)
+{
+    if (readback.ready) return true;
+    auto& slot = readbacks.slots[readback.slot];
+    if (device.getFenceStatus(slot.completionFence) != vk::Result::eSuccess) return false;
+    // The memory is not necessarily coherent
+    device.invalidateMappedMemoryRanges(vk::MappedMemoryRange(slot.memory, 0, VK_WHOLE_SIZE));
+    readback.ready = true;
+    return true;
+}
+
+ReadbackTicket Interface::readback(Buffer src, size_t size, size_t srcOffset, ReadbackCallback callback)
+{
+    auto& bufferData = state->getData(src);
+    if (size == 0 || srcOffset + size > bufferData.size)
+        throw std::runtime_error("[TGA Vulkan] readback: Range [" + std::to_string(srcOffset) + ", " +
+                                 std::to_string(srcOffset + size) + ") is empty or exceeds the Buffer size of " +
+                                 std::to_string(bufferData.size));
+    auto srcBuffer = bufferData.buffer;
+    return state->submitReadback(size, std::move(callback), [&](vk::CommandBuffer cmd, vk::Buffer dst) {
+        cmd.copyBuffer(srcBuffer, dst, vk::BufferCopy(srcOffset, 0, size));
+    });
+}
+
+ReadbackTicket Interface::readback(Texture src, uint32_t mipLevel, ReadbackCallback callback)
+{
+    auto& imageData = state->getData(src);
+    if (mipLevel >= imageData.mipLevels)
+        throw std::runtime_error("[TGA Vulkan] readback: Mip level " + std::to_string(mipLevel) +
+                                 " does not exist, the Texture has " + std::to_string(imageData.mipLevels));
+    vk::Extent3D levelExtent{std::max(imageData.extent.width >> mipLevel, 1u),
+                             std::max(imageData.extent.height >> mipLevel, 1u),
+                             std::max(imageData.extent.depth >> mipLevel, 1u)};
+    auto size = imageData.layers * formatImageSize(imageData.textureFormat, levelExtent.width, levelExtent.height,
+                                                   levelExtent.depth);
+    auto image = imageData.image;
+    auto layers = imageData.layers;
+
+    return state->submitReadback(size, std::move(callback), [&](vk::CommandBuffer cmd, vk::Buffer dst) {
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, {}, {},
+                            layoutTransitionBarrier(image, vk::ImageLayout::eGeneral,
+                                                    vk::ImageLayout::eTransferSrcOptimal,
+                                                    vk::ImageAspectFlagBits::eColor));
+        cmd.copyImageToBuffer(
+            image, vk::ImageLayout::eTransferSrcOptimal, dst,
+            vk::BufferImageCopy(0).setImageExtent(levelExtent).setImageSubresource(
+                {vk::ImageAspectFlagBits::eColor, mipLevel, 0, layers}));
+        cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, {}, {},
+                            {},
+                            layoutTransitionBarrier(image, vk::ImageLayout::eTransferSrcOptimal,
+                                                    vk::ImageLayout::eGeneral, vk::ImageAspectFlagBits::eColor));
+    });
+}
+
+bool Interface::readbackReady(ReadbackTicket ticket)
+{
+    auto readback = state->readbacks.pending.find(ticket.id);
+    if (readback == state->readbacks.pending.end())
+        throw std::runtime_error("[TGA Vulkan] readbackReady: Unknown or already freed ReadbackTicket");
+    return state->updateReadback(readback->second);
+}
+
+void const *Interface::getReadbackData(ReadbackTicket ticket)
+{
+    auto readback = state->readbacks.pending.find(ticket.id);
+    if (readback == state->readbacks.pending.end())
+        throw std::runtime_error("[TGA Vulkan] getReadbackData: Unknown or already freed ReadbackTicket");
+    if (!state->updateReadback(readback->second))
+        throw std::runtime_error("[TGA Vulkan] getReadbackData: Readback is not ready, check readbackReady first");
+    return state->readbacks.slots[readback->second.slot].mapping;
+}
+
+uint32_t Interface::pollReadbacks()
+{
+    auto& pending = state->readbacks.pending;
+    std::vector<uint64_t> finished;
+    for (auto& [ticket, readback] : pending)
+        if (readback.callback && state->updateReadback(readback)) finished.push_back(ticket);
+
+    // Callbacks may start or free readbacks, so nothing from the map is kept across a call
+    uint32_t invoked{0};
+    for (auto ticket : finished) {
+        auto readback = pending.find(ticket);
+        if (readback == pending.end()) continue;
+        auto callback = std::move(readback->second.callback);
+        auto data = state->readbacks.slots[readback->second.slot].mapping;
+        auto size = readback->second.size;
+        callback(data, size);
+        free(ReadbackTicket{ticket});
+        ++invoked;
+    }
+    return invoked;
+}
+
+namespace /*bindless table slots*/
+{
+    template <typename T>
+    std::pair<uint32_t, bool> acquireBindlessSlot(std::unordered_map<T, uint32_t>& slots,
+                                                  std::vector<uint32_t>& freeSlots, T handle, uint32_t maxSlots)
+    {
+        if (auto slot = slots.find(handle); slot != slots.end()) return {slot->second, false};
+        uint32_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            // Without free slots every index below the number of registered handles is in use
+            index = static_cast<uint32_t>(slots.size());
+            if (index >= maxSlots)
+                throw std::runtime_error("[TGA Vulkan] The bindless table is full, it can hold " +
+                                         std::to_string(maxSlots) + " entries of this type");
+        }
+        slots.emplace(handle, index);
+        return {index, true};
+    }
+
+    template <typename T>
+    void releaseBindlessSlot(std::unordered_map<T, uint32_t>& slots, std::vector<uint32_t>& freeSlots, T handle)
+    {
+        auto slot = slots.find(handle);
+        if (slot == slots.end()) return;
+        // The stale descriptor stays in the table. Partially bound bindings only allow this as long as no shader
+        // accesses the index, which unregisterBindless documents as the contract for freed indices
+        freeSlots.push_back(slot->second);
+        slots.erase(slot);
+    }
+}  // namespace
+
+void Interface::updateInputSet(InputSet inputSet, std::vector<Binding> const& bindings)
+{
+    auto& device = state->device;
+    auto& data = state->getData(inputSet);
+    if (!data.setLayout)
+        throw std::runtime_error("[TGA Vulkan] InputSet can't be updated, the pass it was created for has been freed");
+    if (bindings.empty()) return;
+
+    // Ordered by slot and array element, if a descriptor is listed more than once the last Binding wins
+    std::map<std::pair<uint32_t, uint32_t>, Binding const *> orderedBindings;
+    for (auto& binding : bindings) orderedBindings[{binding.slot, binding.arrayElement}] = &binding;
+
+    auto& updateTemplates = state->descriptorUpdateTemplates.at(static_cast<VkDescriptorSetLayout>(data.setLayout));
+    auto& descriptorTypes = updateTemplates.descriptorTypes;
+
+    std::vector<std::pair<uint32_t, uint32_t>> key;
+    key.reserve(orderedBindings.size());
+    std::vector<vkData::DescriptorInfo> descriptorInfos;
+    descriptorInfos.reserve(orderedBindings.size());
+    for (auto& [descriptor, binding] : orderedBindings) {
+        key.push_back(descriptor);
+        descriptorInfos.push_back(state->describeBinding(*binding, descriptorTypes[descriptor.first]));
+    }
+
+    auto& updateTemplate = updateTemplates.templates[key];
+    if (!updateTemplate) {
+        // Consecutive array elements of the same slot are written by a single entry
+        std::vector<vk::DescriptorUpdateTemplateEntry> entries;
+        for (size_t i = 0; i < key.size(); ++i) {
+            auto [slot, arrayElement] = key[i];
+            if (!entries.empty() && entries.back().dstBinding == slot &&
+                entries.back().dstArrayElement + entries.back().descriptorCount == arrayElement) {
+                ++entries.back().descriptorCount;
+                continue;
+            }
+            entries.push_back(vk::DescriptorUpdateTemplateEntry(slot, arrayElement, 1, descriptorTypes[slot],
+                                                                i * sizeof(vkData::DescriptorInfo),
+                                                                sizeof(vkData::DescriptorInfo)));
+        }
+        updateTemplate = device.createDescriptorUpdateTemplate(
+            vk::DescriptorUpdateTemplateCreateInfo()
+                .setDescriptorUpdateEntries(entries)
+                .setTemplateType(vk::DescriptorUpdateTemplateType::eDescriptorSet)
+                .setDescriptorSetLayout(data.setLayout));
+    }
+    device.updateDescriptorSetWithTemplate(data.descriptorSet, updateTemplate,
+                                           static_cast<const void *>(descriptorInfos.data()));
+}
+
+uint32_t Interface::registerBindless(Texture texture)
+{
+    using Table = vkData::BindlessTable;
+    auto& table = state->getBindlessTable();
+    auto& data = state->getData(texture);
+    auto [index, isNew] = acquireBindlessSlot(table.textureSlots, table.freeTextureSlots, texture, table.maxTextures);
+    if (!isNew) return index;
+
+    auto imageInfo = vk::DescriptorImageInfo()
+                         .setImageLayout(vk::ImageLayout::eGeneral)
+                         .setImageView(data.imageView)
+                         .setSampler(data.sampler);
+    std::vector<vk::WriteDescriptorSet> writeSets{vk::WriteDescriptorSet()
+                                                      .setDstSet(table.descriptorSet)
+                                                      .setDstBinding(Table::sampledImageBinding)
+                                                      .setDstArrayElement(index)
+                                                      .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                                                      .setImageInfo(imageInfo)};
+    // Formats without storage support are only available as sampled images
+    auto formatFeatures = state->pDevice.getFormatProperties(data.format).optimalTilingFeatures;
+    auto storageImageInfo = vk::DescriptorImageInfo(imageInfo).setImageView(data.baseLevelView);
+    if (formatFeatures & vk::FormatFeatureFlagBits::eStorageImage)
+        writeSets.push_back(vk::WriteDescriptorSet()
+                                .setDstSet(table.descriptorSet)
+                                .setDstBinding(Table::storageImageBinding)
+                                .setDstArrayElement(index)
+                                .setDescriptorType(vk::DescriptorType::eStorageImage)
+                                .setImageInfo(storageImageInfo));
+    state->device.updateDescriptorSets(writeSets, {});
+    return index;
+}
+
+uint32_t Interface::registerBindless(Buffer buffer)
+{
+    using Table = vkData::BindlessTable;
+    auto& table = state->getBindlessTable();
+    auto& data = state->getData(buffer);
+    auto [index, isNew] = acquireBindlessSlot(table.bufferSlots, table.freeBufferSlots, buffer, table.maxBuffers);
+    if (!isNew) return index;
+
+    auto bufferInfo = vk::DescriptorBufferInfo().setBuffer(data.buffer).setOffset(0).setRange(data.size);
+    state->device.updateDescriptorSets(vk::WriteDescriptorSet()
+                                           .setDstSet(table.descriptorSet)
+                                           .setDstBinding(Table::storageBufferBinding)
+                                           .setDstArrayElement(index)
+                                           .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                                           .setBufferInfo(bufferInfo),
+                                       {});
+    return index;
+}
+
+void Interface::unregisterBindless(Texture texture)
+{
+    auto& table = state->bindlessTable;
+    releaseBindlessSlot(table.textureSlots, table.freeTextureSlots, texture);
+}
+
+void Interface::unregisterBindless(Buffer buffer)
+{
+    auto& table = state->bindlessTable;
+    releaseBindlessSlot(table.bufferSlots, table.freeBufferSlots, buffer);
+}
+
 uint32_t Interface::backbufferCount(Window window)
 {
-    return static_cast<uint32_t>(state->wsi.getWindow(window).imageViews.size());
+    return static_cast<uint32_t>(state->getWSI().getWindow(window).imageViews.size());
 }
 
 uint32_t Interface::nextFrame(Window window)
 {
+    pollReadbacks();
+
     auto& device = state->device;
     auto& renderQueue = state->renderQueue;
-    auto& wsi = state->wsi;
+    auto& wsi = state->getWSI();
     auto& windowData = state->getData(window);
 
     wsi.pollEvents(window);
@@ -1461,7 +3107,7 @@ uint32_t Interface::nextFrame(Window window)
     return nextFrameIndex;
 }
 
-void Interface::pollEvents(Window window) { state->wsi.pollEvents(window); }
+void Interface::pollEvents(Window window) { state->getWSI().pollEvents(window); }
 
 void Interface::present(Window window, uint32_t imageIndex)
 {
@@ -1484,16 +3130,16 @@ void Interface::present(Window window, uint32_t imageIndex)
 
 void Interface::setWindowTitle(Window window, const std::string& title)
 {
-    state->wsi.setWindowTitle(window, title.c_str());
+    state->getWSI().setWindowTitle(window, title.c_str());
 }
 
-bool Interface::windowShouldClose(Window window) { return state->wsi.windowShouldClose(window); }
+bool Interface::windowShouldClose(Window window) { return state->getWSI().windowShouldClose(window); }
 
-bool Interface::keyDown(Window window, Key key) { return state->wsi.keyDown(window, key); }
+bool Interface::keyDown(Window window, Key key) { return state->getWSI().keyDown(window, key); }
 
-std::pair<int, int> Interface::mousePosition(Window window) { return state->wsi.mousePosition(window); }
+std::pair<int, int> Interface::mousePosition(Window window) { return state->getWSI().mousePosition(window); }
 
-std::pair<uint32_t, uint32_t> Interface::screenResolution() { return state->wsi.screenResolution(); }
+std::pair<uint32_t, uint32_t> Interface::screenResolution() { return state->getWSI().screenResolution(); }
 
 void Interface::free(Shader shader)
 {
@@ -1529,6 +3175,7 @@ void Interface::free(Buffer buffer)
     if (!data.buffer) return;
 
     device.waitIdle();
+    unregisterBindless(buffer);
     device.destroy(data.buffer);
     device.free(data.memory);
     state->buffers.free(dataIndexFromRawHandle(buffer));
@@ -1542,14 +3189,16 @@ void Interface::free(Texture texture)
     if (!data.image) return;
 
     device.waitIdle();
-    if (data.depthBuffer.image) {
-        device.destroy(data.depthBuffer.imageView);
-        device.destroy(data.depthBuffer.image);
-        device.free(data.depthBuffer.memory);
-        data.depthBuffer = {};
+    unregisterBindless(texture);
+    for (auto& depthBuffer : data.depthBuffers) {
+        device.destroy(depthBuffer.imageView);
+        device.destroy(depthBuffer.image);
+        device.free(depthBuffer.memory);
     }
+    data.depthBuffers.clear();
 
     device.destroy(data.sampler);
+    if (data.baseLevelView != data.imageView) device.destroy(data.baseLevelView);
     device.destroy(data.imageView);
     device.destroy(data.image);
     device.free(data.memory);
@@ -1561,16 +3210,16 @@ void Interface::free(Window window)
     auto& instance = state->instance;
     auto& device = state->device;
     auto& cmdPool = state->cmdPool;
-    auto& wsi = state->wsi;
+    auto& wsi = state->getWSI();
     auto& windowData = state->getData(window);
 
     device.waitIdle();
-    if (windowData.depthBuffer.image) {
-        device.destroy(windowData.depthBuffer.imageView);
-        device.destroy(windowData.depthBuffer.image);
-        device.free(windowData.depthBuffer.memory);
-        windowData.depthBuffer = {};
+    for (auto& depthBuffer : windowData.depthBuffers) {
+        device.destroy(depthBuffer.imageView);
+        device.destroy(depthBuffer.image);
+        device.free(depthBuffer.memory);
     }
+    windowData.depthBuffers.clear();
 
     device.freeCommandBuffers(cmdPool, windowData.toColorAttachmentTransitionCmds);
     device.freeCommandBuffers(cmdPool, windowData.toPresentSrcTransitionCmds);
@@ -1582,10 +3231,14 @@ void Interface::free(InputSet inputSet)
     if (!inputSet) return;
     auto& device = state->device;
     auto& data = state->getData(inputSet);
-    if (!data.descriptorPool) return;
+    if (!data.descriptorSet) return;
 
     device.waitIdle();
-    device.destroy(data.descriptorPool);
+    // The set is handed out again by the next createInputSet with the same layout
+    if (data.setLayout) {
+        auto& allocator = state->descriptorSetAllocators.at(static_cast<VkDescriptorSetLayout>(data.setLayout));
+        allocator.freeSets.push_back(data.descriptorSet);
+    }
     state->inputSets.free(dataIndexFromRawHandle(inputSet));
 }
 void Interface::free(RenderPass renderPass)
@@ -1593,15 +3246,16 @@ void Interface::free(RenderPass renderPass)
     if (!renderPass) return;
     auto& device = state->device;
     auto& data = state->getData(renderPass);
-    if (!data.pipeline) return;
+    if (!data.renderPass) return;
 
     device.waitIdle();
     for (auto& fb : data.framebuffers) device.destroy(fb);
     device.destroy(data.renderPass);
 
-    for (auto& sl : data.layout.setLayouts) device.destroy(sl);
-    device.destroy(data.pipeline);
-    device.destroy(data.layout.pipelineLayout);
+    for (auto& subpass : data.subpasses) {
+        device.destroy(subpass.pipeline);
+        state->destroyLayout(subpass.layout);
+    }
     state->renderPasses.free(dataIndexFromRawHandle(renderPass));
 }
 
@@ -1613,9 +3267,8 @@ void Interface::free(ComputePass computePass)
     if (!data.pipeline) return;
 
     device.waitIdle();
-    for (auto& sl : data.layout.setLayouts) device.destroy(sl);
     device.destroy(data.pipeline);
-    device.destroy(data.layout.pipelineLayout);
+    state->destroyLayout(data.layout);
     state->computePasses.free(dataIndexFromRawHandle(computePass));
 }
 
@@ -1629,9 +3282,26 @@ void Interface::free(CommandBuffer commandBuffer)
     device.waitIdle();
     device.freeCommandBuffers(cmdPool, {data.cmdBuffer});
     device.destroy(data.completionFence);
+    for (auto& pool : data.transientDescriptors.pools) device.destroy(pool);
     state->commandBuffers.free(dataIndexFromRawHandle(commandBuffer));
 }
 
+void Interface::free(ReadbackTicket ticket)
+{
+    if (!ticket) return;
+    auto& device = state->device;
+    auto& readbacks = state->readbacks;
+    auto readback = readbacks.pending.find(ticket.id);
+    if (readback == readbacks.pending.end()) return;
+    auto& slot = readbacks.slots[readback->second.slot];
+    // The slot can only be reused once its copy finished
+    if (!readback->second.ready)
+        std::ignore = device.waitForFences(slot.completionFence, true, std::numeric_limits<uint64_t>::max());
+    device.resetFences(slot.completionFence);
+    readbacks.freeSlots.push_back(readback->second.slot);
+    readbacks.pending.erase(readback);
+}
+
 void Interface::free(ext::TopLevelAccelerationStructure acStructure)
 {
     if (!acStructure) return;
@@ -1642,6 +3312,10 @@ void Interface::free(ext::TopLevelAccelerationStructure acStructure)
     device.destroyAccelerationStructureKHR(data.accelerationStructure);
     device.destroy(data.buffer);
     device.free(data.memory);
+    device.destroy(data.instanceBuffer);
+    device.free(data.instanceMemory);
+    device.destroy(data.scratchBuffer);
+    device.free(data.scratchMemory);
     state->acclerationStructures.free(dataIndexFromRawHandle(acStructure));
 }
 void Interface::free(ext::BottomLevelAccelerationStructure acStructure)
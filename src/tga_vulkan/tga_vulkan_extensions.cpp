@@ -31,8 +31,9 @@ namespace tga
 {
 void loadVkInstanceExtensions(vk::Instance& instance)
 {
-    PFN_INIT_REQUIRED(instance, vkCreateDebugUtilsMessengerEXT);
-    PFN_INIT_REQUIRED(instance, vkDestroyDebugUtilsMessengerEXT);
+    // Only present if validation is enabled
+    PFN_INIT(instance, vkCreateDebugUtilsMessengerEXT);
+    PFN_INIT(instance, vkDestroyDebugUtilsMessengerEXT);
 }
 }  // namespace tga
 
@@ -72,15 +73,105 @@ PFN_FUN(void, vkCmdBuildAccelerationStructuresKHR,
     return pfn_vkCmdBuildAccelerationStructuresKHR(commandBuffer, infoCount, pInfos, ppBuildRangeInfos);
 }
 
+PFN_FUN(void, vkCmdWriteAccelerationStructuresPropertiesKHR,
+        (VkCommandBuffer commandBuffer, uint32_t accelerationStructureCount,
+         const VkAccelerationStructureKHR *pAccelerationStructures, VkQueryType queryType, VkQueryPool queryPool,
+         uint32_t firstQuery))
+{
+    return pfn_vkCmdWriteAccelerationStructuresPropertiesKHR(commandBuffer, accelerationStructureCount,
+                                                             pAccelerationStructures, queryType, queryPool, firstQuery);
+}
+
+PFN_FUN(void, vkCmdCopyAccelerationStructureKHR,
+        (VkCommandBuffer commandBuffer, const VkCopyAccelerationStructureInfoKHR *pInfo))
+{
+    return pfn_vkCmdCopyAccelerationStructureKHR(commandBuffer, pInfo);
+}
+
+PFN_FUN(void, vkCmdCopyAccelerationStructureToMemoryKHR,
+        (VkCommandBuffer commandBuffer, const VkCopyAccelerationStructureToMemoryInfoKHR *pInfo))
+{
+    return pfn_vkCmdCopyAccelerationStructureToMemoryKHR(commandBuffer, pInfo);
+}
+
+PFN_FUN(void, vkCmdCopyMemoryToAccelerationStructureKHR,
+        (VkCommandBuffer commandBuffer, const VkCopyMemoryToAccelerationStructureInfoKHR *pInfo))
+{
+    return pfn_vkCmdCopyMemoryToAccelerationStructureKHR(commandBuffer, pInfo);
+}
+
+PFN_FUN(void, vkGetDeviceAccelerationStructureCompatibilityKHR,
+        (VkDevice device, const VkAccelerationStructureVersionInfoKHR *pVersionInfo,
+         VkAccelerationStructureCompatibilityKHR *pCompatibility))
+{
+    return pfn_vkGetDeviceAccelerationStructureCompatibilityKHR(device, pVersionInfo, pCompatibility);
+}
+
+// Extended dynamic state
+
+PFN_FUN(void, vkCmdSetCullModeEXT, (VkCommandBuffer commandBuffer, VkCullModeFlags cullMode))
+{
+    return pfn_vkCmdSetCullModeEXT(commandBuffer, cullMode);
+}
+
+PFN_FUN(void, vkCmdSetFrontFaceEXT, (VkCommandBuffer commandBuffer, VkFrontFace frontFace))
+{
+    return pfn_vkCmdSetFrontFaceEXT(commandBuffer, frontFace);
+}
+
+PFN_FUN(void, vkCmdSetPrimitiveTopologyEXT, (VkCommandBuffer commandBuffer, VkPrimitiveTopology primitiveTopology))
+{
+    return pfn_vkCmdSetPrimitiveTopologyEXT(commandBuffer, primitiveTopology);
+}
+
+PFN_FUN(void, vkCmdSetDepthTestEnableEXT, (VkCommandBuffer commandBuffer, VkBool32 depthTestEnable))
+{
+    return pfn_vkCmdSetDepthTestEnableEXT(commandBuffer, depthTestEnable);
+}
+
+PFN_FUN(void, vkCmdSetDepthWriteEnableEXT, (VkCommandBuffer commandBuffer, VkBool32 depthWriteEnable))
+{
+    return pfn_vkCmdSetDepthWriteEnableEXT(commandBuffer, depthWriteEnable);
+}
+
+PFN_FUN(void, vkCmdSetDepthCompareOpEXT, (VkCommandBuffer commandBuffer, VkCompareOp depthCompareOp))
+{
+    return pfn_vkCmdSetDepthCompareOpEXT(commandBuffer, depthCompareOp);
+}
+
+// Push descriptors
+
+PFN_FUN(void, vkCmdPushDescriptorSetKHR,
+        (VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t set,
+         uint32_t descriptorWriteCount, const VkWriteDescriptorSet *pDescriptorWrites))
+{
+    return pfn_vkCmdPushDescriptorSetKHR(commandBuffer, pipelineBindPoint, layout, set, descriptorWriteCount,
+                                         pDescriptorWrites);
+}
+
 namespace tga
 {
 void loadVkDeviceExtensions(vk::Device& device)
 {
+    PFN_INIT(device, vkCmdPushDescriptorSetKHR);
+
+    PFN_INIT(device, vkCmdSetCullModeEXT);
+    PFN_INIT(device, vkCmdSetFrontFaceEXT);
+    PFN_INIT(device, vkCmdSetPrimitiveTopologyEXT);
+    PFN_INIT(device, vkCmdSetDepthTestEnableEXT);
+    PFN_INIT(device, vkCmdSetDepthWriteEnableEXT);
+    PFN_INIT(device, vkCmdSetDepthCompareOpEXT);
+
     PFN_INIT(device, vkCreateAccelerationStructureKHR);
     PFN_INIT(device, vkDestroyAccelerationStructureKHR);
     PFN_INIT(device, vkGetAccelerationStructureDeviceAddressKHR);
     PFN_INIT(device, vkGetAccelerationStructureBuildSizesKHR);
     PFN_INIT(device, vkCmdBuildAccelerationStructuresKHR);
+    PFN_INIT(device, vkCmdWriteAccelerationStructuresPropertiesKHR);
+    PFN_INIT(device, vkCmdCopyAccelerationStructureKHR);
+    PFN_INIT(device, vkCmdCopyAccelerationStructureToMemoryKHR);
+    PFN_INIT(device, vkCmdCopyMemoryToAccelerationStructureKHR);
+    PFN_INIT(device, vkGetDeviceAccelerationStructureCompatibilityKHR);
 
     if (!pfn_vkCreateAccelerationStructureKHR || !pfn_vkDestroyAccelerationStructureKHR ||
         !pfn_vkGetAccelerationStructureDeviceAddressKHR || !pfn_vkGetAccelerationStructureBuildSizesKHR ||
@@ -0,0 +1,803 @@
+#include "tga/tga_bvh.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+namespace tga
+{
+namespace cpu
+{
+    void RayPacket::setRay(uint32_t lane, Ray const& ray)
+    {
+        originX[lane] = ray.origin.x;
+        originY[lane] = ray.origin.y;
+        originZ[lane] = ray.origin.z;
+        directionX[lane] = ray.direction.x;
+        directionY[lane] = ray.direction.y;
+        directionZ[lane] = ray.direction.z;
+        tMin[lane] = ray.tMin;
+        tMax[lane] = ray.tMax;
+    }
+
+    Hit HitPacket::getHit(uint32_t lane) const
+    {
+        Hit hit;
+        hit.t = t[lane];
+        hit.barycentrics = {u[lane], v[lane]};
+        hit.primitiveIndex = primitiveIndex[lane];
+        hit.geometryIndex = geometryIndex[lane];
+        hit.instanceIndex = instanceIndex[lane];
+        hit.instanceCustomIndex = instanceCustomIndex[lane];
+        return hit;
+    }
+
+    namespace /*bvh construction*/
+    {
+        using detail::Bounds;
+        using detail::Node;
+
+        constexpr uint32_t binCount = 16;
+        constexpr uint32_t maxLeafSize = 8;
+        // Deeper nodes become leaves, which keeps the traversal stacks bounded
+        constexpr uint32_t maxDepth = 48;
+        // Smaller subtrees are built by the thread that reached them
+        constexpr uint32_t parallelBuildThreshold = 4096;
+
+        void grow(Bounds& bounds, glm::vec3 const& point)
+        {
+            bounds.min = glm::min(bounds.min, point);
+            bounds.max = glm::max(bounds.max, point);
+        }
+
+        void grow(Bounds& bounds, Bounds const& other)
+        {
+            bounds.min = glm::min(bounds.min, other.min);
+            bounds.max = glm::max(bounds.max, other.max);
+        }
+
+        float halfArea(Bounds const& bounds)
+        {
+            if (bounds.min.x > bounds.max.x) return 0.f;
+            auto extent = bounds.max - bounds.min;
+            return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+        }
+
+        class Builder {
+        public:
+            Builder(std::vector<Bounds> const& _primitiveBounds, std::vector<uint32_t>& _order,
+                    std::vector<Node>& _nodes)
+                : primitiveBounds(_primitiveBounds), order(_order), nodes(_nodes)
+            {
+                centroids.reserve(primitiveBounds.size());
+                for (auto& bounds : primitiveBounds) centroids.push_back((bounds.min + bounds.max) * 0.5f);
+                // Enough tasks to keep every core busy while the top of the tree is split
+                for (auto threads = std::max(std::thread::hardware_concurrency(), 1u); threads > 1; threads >>= 1)
+                    ++parallelDepth;
+                ++parallelDepth;
+            }
+
+            void build(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth)
+            {
+                auto& node = nodes[nodeIndex];
+                Bounds bounds, centroidBounds;
+                for (uint32_t i = first; i < first + count; ++i) {
+                    grow(bounds, primitiveBounds[order[i]]);
+                    grow(centroidBounds, centroids[order[i]]);
+                }
+                node.boundsMin = bounds.min;
+                node.boundsMax = bounds.max;
+                node.leftOrFirst = first;
+                node.count = count;
+                if (count <= 2 || depth >= maxDepth) return;
+
+                // Cheapest split between bins over all axes, costs are relative to the area of the node
+                float bestCost = std::numeric_limits<float>::infinity();
+                int bestAxis = -1;
+                uint32_t bestSplit = 0;
+                for (int axis = 0; axis < 3; ++axis) {
+                    float low = centroidBounds.min[axis];
+                    float high = centroidBounds.max[axis];
+                    if (high <= low) continue;
+                    float scale = binCount / (high - low);
+
+                    std::array<Bounds, binCount> bins;
+                    std::array<uint32_t, binCount> binCounts{};
+                    for (uint32_t i = first; i < first + count; ++i) {
+                        auto bin = binOf(centroids[order[i]][axis], low, scale);
+                        ++binCounts[bin];
+                        grow(bins[bin], primitiveBounds[order[i]]);
+                    }
+
+                    std::array<float, binCount> leftCosts{};
+                    Bounds left;
+                    uint32_t leftCount{0};
+                    for (uint32_t bin = 0; bin < binCount - 1; ++bin) {
+                        grow(left, bins[bin]);
+                        leftCount += binCounts[bin];
+                        leftCosts[bin] = leftCount ? leftCount * halfArea(left) : -1.f;
+                    }
+                    Bounds right;
+                    uint32_t rightCount{0};
+                    for (uint32_t bin = binCount - 1; bin > 0; --bin) {
+                        grow(right, bins[bin]);
+                        rightCount += binCounts[bin];
+                        if (!rightCount || leftCosts[bin - 1] < 0.f) continue;
+                        float cost = leftCosts[bin - 1] + rightCount * halfArea(right);
+                        if (cost < bestCost) {
+                            bestCost = cost;
+                            bestAxis = axis;
+                            bestSplit = bin;
+                        }
+                    }
+                }
+
+                // Traversing the node costs as much as intersecting one primitive
+                float nodeArea = halfArea(bounds);
+                if (bestAxis < 0 || (bestCost + nodeArea >= count * nodeArea && count <= maxLeafSize)) return;
+
+                float low = centroidBounds.min[bestAxis];
+                float scale = binCount / (centroidBounds.max[bestAxis] - low);
+                auto begin = order.begin() + first;
+                auto middle = std::partition(begin, begin + count, [&](uint32_t primitive) {
+                    return binOf(centroids[primitive][bestAxis], low, scale) < bestSplit;
+                });
+                auto leftCount = static_cast<uint32_t>(middle - begin);
+
+                auto leftChild = nodesUsed.fetch_add(2);
+                node.leftOrFirst = leftChild;
+                node.count = 0;
+                if (depth < parallelDepth && count > parallelBuildThreshold) {
+                    auto leftTask = std::async(std::launch::async,
+                                               [=, this] { build(leftChild, first, leftCount, depth + 1); });
+                    build(leftChild + 1, first + leftCount, count - leftCount, depth + 1);
+                    leftTask.get();
+                } else {
+                    build(leftChild, first, leftCount, depth + 1);
+                    build(leftChild + 1, first + leftCount, count - leftCount, depth + 1);
+                }
+            }
+
+            uint32_t nodeCount() const { return nodesUsed; }
+
+        private:
+            static uint32_t binOf(float centroid, float low, float scale)
+            {
+                return std::min(binCount - 1, static_cast<uint32_t>((centroid - low) * scale));
+            }
+
+            std::vector<Bounds> const& primitiveBounds;
+            std::vector<uint32_t>& order;
+            std::vector<Node>& nodes;
+            std::vector<glm::vec3> centroids;
+            std::atomic<uint32_t> nodesUsed{1};
+            uint32_t parallelDepth{0};
+        };
+    }  // namespace
+
+    std::vector<detail::Node> detail::buildBVH(std::vector<Bounds> const& primitiveBounds, std::vector<uint32_t>& order)
+    {
+        auto count = static_cast<uint32_t>(primitiveBounds.size());
+        order.resize(count);
+        std::iota(order.begin(), order.end(), 0u);
+        if (!count) return {};
+
+        // A binary tree with at most one primitive per leaf has 2n-1 nodes
+        std::vector<Node> nodes(2 * size_t{count} - 1);
+        Builder builder(primitiveBounds, order, nodes);
+        builder.build(0, 0, count, 0);
+        nodes.resize(builder.nodeCount());
+        return nodes;
+    }
+
+    namespace /*bvh traversal*/
+    {
+        using detail::Node;
+
+        constexpr float infinity = std::numeric_limits<float>::infinity();
+
+        // Avoids NaNs from 0 * inf in the slab test for axis-parallel rays
+        float safeInverse(float value)
+        {
+            constexpr float tiny = 1e-20f;
+            return 1.f / (std::abs(value) > tiny ? value : std::copysign(tiny, value));
+        }
+
+        struct RayData {
+            glm::vec3 origin, direction, inverseDirection;
+            float tMin;
+
+            RayData(glm::vec3 const& _origin, glm::vec3 const& _direction, float _tMin)
+                : origin(_origin), direction(_direction),
+                  inverseDirection(safeInverse(_direction.x), safeInverse(_direction.y), safeInverse(_direction.z)),
+                  tMin(_tMin)
+            {}
+        };
+
+        // Entry distance of the ray into the node, infinity if it misses
+        float entryDistance(Node const& node, RayData const& ray, float tMax)
+        {
+            auto t0 = (node.boundsMin - ray.origin) * ray.inverseDirection;
+            auto t1 = (node.boundsMax - ray.origin) * ray.inverseDirection;
+            auto tNear = glm::min(t0, t1);
+            auto tFar = glm::max(t0, t1);
+            float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, ray.tMin));
+            float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+            return entry <= exit ? entry : infinity;
+        }
+
+        // Front to back traversal, leaf(first, count, tMax) may shorten tMax and returns true to stop
+        template <typename LeafFunction>
+        void traverse(std::vector<Node> const& nodes, RayData const& ray, float& tMax, LeafFunction&& leaf)
+        {
+            if (nodes.empty() || entryDistance(nodes[0], ray, tMax) == infinity) return;
+            struct Entry {
+                uint32_t node;
+                float distance;
+            };
+            std::array<Entry, 2 * maxDepth> stack;
+            uint32_t stackSize{0};
+            uint32_t current{0};
+            while (true) {
+                auto& node = nodes[current];
+                if (node.count) {
+                    if (leaf(node.leftOrFirst, node.count, tMax)) return;
+                } else {
+                    uint32_t nearChild = node.leftOrFirst;
+                    uint32_t farChild = nearChild + 1;
+                    float nearDistance = entryDistance(nodes[nearChild], ray, tMax);
+                    float farDistance = entryDistance(nodes[farChild], ray, tMax);
+                    if (farDistance < nearDistance) {
+                        std::swap(nearChild, farChild);
+                        std::swap(nearDistance, farDistance);
+                    }
+                    if (nearDistance != infinity) {
+                        if (farDistance != infinity) stack[stackSize++] = {farChild, farDistance};
+                        current = nearChild;
+                        continue;
+                    }
+                }
+                // Skip nodes that are behind a hit found after they were pushed
+                do {
+                    if (!stackSize) return;
+                    --stackSize;
+                } while (stack[stackSize].distance > tMax);
+                current = stack[stackSize].node;
+            }
+        }
+
+        struct PacketData {
+            PacketFloat originX, originY, originZ;
+            PacketFloat directionX, directionY, directionZ;
+            PacketFloat inverseX, inverseY, inverseZ;
+            PacketFloat tMin;
+
+            explicit PacketData(RayPacket const& packet)
+                : originX(packet.originX), originY(packet.originY), originZ(packet.originZ),
+                  directionX(packet.directionX), directionY(packet.directionY), directionZ(packet.directionZ),
+                  tMin(packet.tMin)
+            {
+                for (uint32_t i = 0; i < packetSize; ++i) {
+                    inverseX[i] = safeInverse(directionX[i]);
+                    inverseY[i] = safeInverse(directionY[i]);
+                    inverseZ[i] = safeInverse(directionZ[i]);
+                }
+            }
+        };
+
+        // Per lane results are packed into a bit mask in a separate loop, which keeps the loops over the lanes free of
+        // cross lane dependencies so the compiler may vectorize them
+        constexpr PacketIndex laneBits{1u << 0, 1u << 1, 1u << 2, 1u << 3, 1u << 4, 1u << 5, 1u << 6, 1u << 7};
+        static_assert(laneBits.size() == packetSize);
+
+        uint32_t toLaneMask(PacketIndex const& results)
+        {
+            uint32_t mask{0};
+            for (uint32_t i = 0; i < packetSize; ++i) mask |= results[i] << i;
+            return mask;
+        }
+
+        // Lanes that enter the node, a slab test per lane without branches
+        uint32_t enteringLanes(Node const& node, PacketData const& packet, PacketFloat const& tMax, uint32_t lanes,
+                               float& minEntry)
+        {
+            PacketFloat entries;
+            PacketIndex entering;
+            for (uint32_t i = 0; i < packetSize; ++i) {
+                float x0 = (node.boundsMin.x - packet.originX[i]) * packet.inverseX[i];
+                float x1 = (node.boundsMax.x - packet.originX[i]) * packet.inverseX[i];
+                float y0 = (node.boundsMin.y - packet.originY[i]) * packet.inverseY[i];
+                float y1 = (node.boundsMax.y - packet.originY[i]) * packet.inverseY[i];
+                float z0 = (node.boundsMin.z - packet.originZ[i]) * packet.inverseZ[i];
+                float z1 = (node.boundsMax.z - packet.originZ[i]) * packet.inverseZ[i];
+                float entry = std::max(std::max(std::min(x0, x1), std::min(y0, y1)),
+                                       std::max(std::min(z0, z1), packet.tMin[i]));
+                float exit = std::min(std::min(std::max(x0, x1), std::max(y0, y1)),
+                                      std::min(std::max(z0, z1), tMax[i]));
+                entering[i] = uint32_t(entry <= exit) & uint32_t((lanes & laneBits[i]) != 0);
+                entries[i] = entering[i] ? entry : infinity;
+            }
+            minEntry = infinity;
+            for (uint32_t i = 0; i < packetSize; ++i) minEntry = std::min(minEntry, entries[i]);
+            return toLaneMask(entering);
+        }
+
+        // Like traverse, for all lanes of a packet at once. leaf(first, count, lanes) returns the lanes that are done
+        template <typename LeafFunction>
+        void traversePacket(std::vector<Node> const& nodes, PacketData const& packet, PacketFloat const& tMax,
+                            uint32_t lanes, LeafFunction&& leaf)
+        {
+            float entry;
+            if (nodes.empty()) return;
+            lanes = enteringLanes(nodes[0], packet, tMax, lanes, entry);
+            if (!lanes) return;
+            struct Entry {
+                uint32_t node;
+                uint32_t lanes;
+            };
+            std::array<Entry, 2 * maxDepth> stack;
+            uint32_t stackSize{0};
+            uint32_t current{0};
+            uint32_t alive = lanes;
+            while (true) {
+                auto& node = nodes[current];
+                if (node.count) {
+                    alive &= ~leaf(node.leftOrFirst, node.count, lanes);
+                } else {
+                    float nearEntry, farEntry;
+                    uint32_t nearChild = node.leftOrFirst;
+                    uint32_t farChild = nearChild + 1;
+                    uint32_t nearLanes = enteringLanes(nodes[nearChild], packet, tMax, lanes, nearEntry);
+                    uint32_t farLanes = enteringLanes(nodes[farChild], packet, tMax, lanes, farEntry);
+                    if (farEntry < nearEntry) {
+                        std::swap(nearChild, farChild);
+                        std::swap(nearLanes, farLanes);
+                    }
+                    if (nearLanes) {
+                        if (farLanes) stack[stackSize++] = {farChild, farLanes};
+                        current = nearChild;
+                        lanes = nearLanes;
+                        continue;
+                    }
+                    if (farLanes) {
+                        current = farChild;
+                        lanes = farLanes;
+                        continue;
+                    }
+                }
+                do {
+                    if (!stackSize || !alive) return;
+                    --stackSize;
+                    lanes = stack[stackSize].lanes & alive;
+                } while (!lanes);
+                current = stack[stackSize].node;
+            }
+        }
+
+        glm::vec3 transformPoint(glm::mat4 const& matrix, glm::vec3 const& point)
+        {
+            return glm::vec3(matrix * glm::vec4(point, 1.f));
+        }
+
+        glm::vec3 transformDirection(glm::mat4 const& matrix, glm::vec3 const& direction)
+        {
+            return glm::vec3(matrix * glm::vec4(direction, 0.f));
+        }
+
+        // The rows of the 3x4 matrix are the first three rows of the 4x4 matrix
+        glm::mat4 toMat4(ext::TransformMatrix const& transform)
+        {
+            glm::mat4 matrix(1.f);
+            for (int row = 0; row < 3; ++row)
+                for (int column = 0; column < 4; ++column) matrix[column][row] = transform[row][column];
+            return matrix;
+        }
+
+        // An affine transform does not change t, as long as the direction is not normalized
+        RayPacket transformPacket(glm::mat4 const& matrix, RayPacket const& packet)
+        {
+            RayPacket result = packet;
+            for (uint32_t i = 0; i < packetSize; ++i) {
+                glm::vec3 origin{packet.originX[i], packet.originY[i], packet.originZ[i]};
+                glm::vec3 direction{packet.directionX[i], packet.directionY[i], packet.directionZ[i]};
+                origin = transformPoint(matrix, origin);
+                direction = transformDirection(matrix, direction);
+                result.originX[i] = origin.x;
+                result.originY[i] = origin.y;
+                result.originZ[i] = origin.z;
+                result.directionX[i] = direction.x;
+                result.directionY[i] = direction.y;
+                result.directionZ[i] = direction.z;
+            }
+            return result;
+        }
+    }  // namespace
+
+    namespace /*bottom level*/
+    {
+        uint32_t positionComponents(Format format)
+        {
+            switch (format) {
+                case Format::r32g32_sfloat: return 2;
+                case Format::r32g32b32_sfloat:
+                case Format::r32g32b32a32_sfloat: return 3;
+                default:
+                    throw std::runtime_error(
+                        "[TGA] Utils: BottomLevelBVH supports r32g32_sfloat, r32g32b32_sfloat and r32g32b32a32_sfloat "
+                        "vertex positions");
+            }
+        }
+
+        // The single geometry fields of the info are shorthand for one geometry, as for the GPU structure
+        std::vector<TriangleGeometry> hostGeometries(ext::BottomLevelAccelerationStructureInfo const& info,
+                                                     BufferData const& bufferData)
+        {
+            auto toHost = [&](ext::TriangleGeometry const& geometry) {
+                return TriangleGeometry{bufferData(geometry.vertexBuffer), geometry.vertexStride,
+                                        static_cast<uint32_t const *>(bufferData(geometry.indexBuffer)),
+                                        geometry.indexCount, geometry.vertexPositionFormat}
+                    .setFirstIndex(geometry.firstIndex)
+                    .setVertexOffset(geometry.vertexOffset)
+                    .setTransform(geometry.transform);
+            };
+            if (info.geometries.empty())
+                return {toHost(ext::TriangleGeometry{}
+                                   .setVertexBuffer(info.vertexBuffer)
+                                   .setIndexBuffer(info.indexBuffer)
+                                   .setVertexStride(info.vertexStride)
+                                   .setVertexPositionFormat(info.vertexPositionFormat)
+                                   .setIndexCount(info.indexCount)
+                                   .setFirstIndex(info.firstIndex)
+                                   .setVertexOffset(info.vertexOffset))};
+            std::vector<TriangleGeometry> geometries;
+            for (auto& geometry : info.geometries) geometries.push_back(toHost(geometry));
+            return geometries;
+        }
+
+        // Möller-Trumbore with precomputed edges
+        bool intersectTriangle(glm::vec3 const& v0, glm::vec3 const& edge1, glm::vec3 const& edge2,
+                               glm::vec3 const& origin, glm::vec3 const& direction, float tMin, float tMax, float& t,
+                               float& u, float& v)
+        {
+            auto p = glm::cross(direction, edge2);
+            float determinant = glm::dot(edge1, p);
+            if (determinant == 0.f) return false;
+            float inverseDeterminant = 1.f / determinant;
+            auto s = origin - v0;
+            u = glm::dot(s, p) * inverseDeterminant;
+            if (u < 0.f || u > 1.f) return false;
+            auto q = glm::cross(s, edge1);
+            v = glm::dot(direction, q) * inverseDeterminant;
+            if (v < 0.f || u + v > 1.f) return false;
+            t = glm::dot(edge2, q) * inverseDeterminant;
+            return t >= tMin && t < tMax;
+        }
+    }  // namespace
+
+    BottomLevelBVH::BottomLevelBVH(std::vector<TriangleGeometry> const& geometries)
+    {
+        std::vector<detail::Bounds> primitiveBounds;
+        for (uint32_t geometryIndex = 0; geometryIndex < geometries.size(); ++geometryIndex) {
+            auto& geometry = geometries[geometryIndex];
+            auto components = positionComponents(geometry.vertexPositionFormat);
+            if (geometry.indexCount % 3)
+                throw std::runtime_error("[TGA] Utils: BottomLevelBVH indexCount must be a multiple of 3");
+            if (geometry.indexCount && (!geometry.vertexData || !geometry.indexData))
+                throw std::runtime_error("[TGA] Utils: BottomLevelBVH geometry without vertex or index data");
+            auto transform = geometry.transform ? toMat4(*geometry.transform) : glm::mat4(1.f);
+
+            auto position = [&](uint32_t index) {
+                auto vertex = static_cast<uint8_t const *>(geometry.vertexData) +
+                              size_t{index + geometry.vertexOffset} * geometry.vertexStride;
+                glm::vec3 result{0.f};
+                std::memcpy(&result, vertex, components * sizeof(float));
+                return transformPoint(transform, result);
+            };
+            auto indices = geometry.indexData + geometry.firstIndex;
+            for (uint32_t primitive = 0; primitive < geometry.indexCount / 3; ++primitive) {
+                auto v0 = position(indices[3 * primitive + 0]);
+                auto v1 = position(indices[3 * primitive + 1]);
+                auto v2 = position(indices[3 * primitive + 2]);
+                triangles.push_back({v0, v1 - v0, v2 - v0, primitive, geometryIndex});
+                auto& bounds = primitiveBounds.emplace_back();
+                grow(bounds, v0);
+                grow(bounds, v1);
+                grow(bounds, v2);
+            }
+        }
+
+        std::vector<uint32_t> order;
+        nodes = detail::buildBVH(primitiveBounds, order);
+        // Leaves reference consecutive triangles
+        std::vector<Triangle> ordered;
+        ordered.reserve(triangles.size());
+        for (auto index : order) ordered.push_back(triangles[index]);
+        triangles = std::move(ordered);
+    }
+
+    BottomLevelBVH::BottomLevelBVH(ext::BottomLevelAccelerationStructureInfo const& info,
+                                   BufferData const& bufferData)
+        : BottomLevelBVH(hostGeometries(info, bufferData))
+    {}
+
+    detail::Bounds BottomLevelBVH::bounds() const
+    {
+        if (nodes.empty()) return {};
+        return {nodes[0].boundsMin, nodes[0].boundsMax};
+    }
+
+    bool BottomLevelBVH::intersect(Ray const& ray, Hit& hit) const
+    {
+        RayData rayData(ray.origin, ray.direction, ray.tMin);
+        float tMax = std::min(ray.tMax, hit.t);
+        bool found{false};
+        traverse(nodes, rayData, tMax, [&](uint32_t first, uint32_t count, float& closest) {
+            for (uint32_t i = first; i < first + count; ++i) {
+                auto& triangle = triangles[i];
+                float t, u, v;
+                if (!intersectTriangle(triangle.v0, triangle.edge1, triangle.edge2, ray.origin, ray.direction,
+                                       ray.tMin, closest, t, u, v))
+                    continue;
+                closest = t;
+                hit.t = t;
+                hit.barycentrics = {u, v};
+                hit.primitiveIndex = triangle.primitiveIndex;
+                hit.geometryIndex = triangle.geometryIndex;
+                found = true;
+            }
+            return false;
+        });
+        return found;
+    }
+
+    bool BottomLevelBVH::occluded(Ray const& ray) const
+    {
+        RayData rayData(ray.origin, ray.direction, ray.tMin);
+        float tMax = ray.tMax;
+        bool found{false};
+        traverse(nodes, rayData, tMax, [&](uint32_t first, uint32_t count, float& closest) {
+            for (uint32_t i = first; i < first + count && !found; ++i) {
+                auto& triangle = triangles[i];
+                float t, u, v;
+                found = intersectTriangle(triangle.v0, triangle.edge1, triangle.edge2, ray.origin, ray.direction,
+                                          ray.tMin, closest, t, u, v);
+            }
+            return found;
+        });
+        return found;
+    }
+
+    namespace /*bottom level packets*/
+    {
+        struct TrianglePacketHits {
+            PacketFloat t, u, v;
+            uint32_t lanes; /**<Lanes that hit the triangle*/
+        };
+
+        // Möller-Trumbore for all lanes, written without branches. The results are returned by value, outputs behind
+        // references could alias the inputs and keep the compiler from vectorizing the loop
+        TrianglePacketHits intersectTrianglePacket(glm::vec3 const& v0, glm::vec3 const& edge1, glm::vec3 const& edge2,
+                                                   PacketData const& packet, PacketFloat const& tMax)
+        {
+            PacketFloat t, u, v;
+            PacketIndex hits;
+            for (uint32_t i = 0; i < packetSize; ++i) {
+                // p = direction x edge2
+                float px = packet.directionY[i] * edge2.z - packet.directionZ[i] * edge2.y;
+                float py = packet.directionZ[i] * edge2.x - packet.directionX[i] * edge2.z;
+                float pz = packet.directionX[i] * edge2.y - packet.directionY[i] * edge2.x;
+                float determinant = edge1.x * px + edge1.y * py + edge1.z * pz;
+                float inverseDeterminant = 1.f / determinant;
+                float sx = packet.originX[i] - v0.x;
+                float sy = packet.originY[i] - v0.y;
+                float sz = packet.originZ[i] - v0.z;
+                u[i] = (sx * px + sy * py + sz * pz) * inverseDeterminant;
+                // q = s x edge1
+                float qx = sy * edge1.z - sz * edge1.y;
+                float qy = sz * edge1.x - sx * edge1.z;
+                float qz = sx * edge1.y - sy * edge1.x;
+                v[i] = (packet.directionX[i] * qx + packet.directionY[i] * qy + packet.directionZ[i] * qz) *
+                       inverseDeterminant;
+                t[i] = (edge2.x * qx + edge2.y * qy + edge2.z * qz) * inverseDeterminant;
+                hits[i] = uint32_t(determinant != 0.f) & uint32_t(u[i] >= 0.f) & uint32_t(v[i] >= 0.f) &
+                          uint32_t(u[i] + v[i] <= 1.f) & uint32_t(t[i] >= packet.tMin[i]) & uint32_t(t[i] < tMax[i]);
+            }
+            return {t, u, v, toLaneMask(hits)};
+        }
+    }  // namespace
+
+    uint32_t BottomLevelBVH::intersect(RayPacket const& packet, HitPacket& hits, uint32_t activeLanes) const
+    {
+        PacketData packetData(packet);
+        PacketFloat tMax;
+        for (uint32_t i = 0; i < packetSize; ++i) tMax[i] = std::min(packet.tMax[i], hits.t[i]);
+        uint32_t found{0};
+        traversePacket(nodes, packetData, tMax, activeLanes & packet.activeLanes,
+                       [&](uint32_t first, uint32_t count, uint32_t lanes) {
+                           for (uint32_t index = first; index < first + count; ++index) {
+                               auto& triangle = triangles[index];
+                               auto triangleHits = intersectTrianglePacket(triangle.v0, triangle.edge1,
+                                                                           triangle.edge2, packetData, tMax);
+                               auto hitLanes = triangleHits.lanes & lanes;
+                               for (uint32_t i = 0; i < packetSize; ++i) {
+                                   if (!(hitLanes & (1u << i))) continue;
+                                   tMax[i] = hits.t[i] = triangleHits.t[i];
+                                   hits.u[i] = triangleHits.u[i];
+                                   hits.v[i] = triangleHits.v[i];
+                                   hits.primitiveIndex[i] = triangle.primitiveIndex;
+                                   hits.geometryIndex[i] = triangle.geometryIndex;
+                               }
+                               found |= hitLanes;
+                           }
+                           return 0u;
+                       });
+        return found;
+    }
+
+    uint32_t BottomLevelBVH::occluded(RayPacket const& packet, uint32_t activeLanes) const
+    {
+        PacketData packetData(packet);
+        uint32_t found{0};
+        traversePacket(nodes, packetData, packet.tMax, activeLanes & packet.activeLanes,
+                       [&](uint32_t first, uint32_t count, uint32_t lanes) {
+                           for (uint32_t index = first; index < first + count && (lanes & ~found); ++index) {
+                               auto& triangle = triangles[index];
+                               found |= intersectTrianglePacket(triangle.v0, triangle.edge1, triangle.edge2,
+                                                                packetData, packet.tMax)
+                                            .lanes &
+                                        lanes;
+                           }
+                           return found;
+                       });
+        return found;
+    }
+
+    namespace /*top level*/
+    {
+        std::vector<Instance> hostInstances(
+            ext::TopLevelAccelerationStructureInfo const& info,
+            std::function<BottomLevelBVH const&(ext::BottomLevelAccelerationStructure)> const& blasOf)
+        {
+            if (info.instanceBuffer)
+                throw std::runtime_error("[TGA] Utils: TopLevelBVH can't read instances from an instanceBuffer, "
+                                         "use instanceInfos");
+            std::vector<Instance> instances;
+            for (auto& instanceInfo : info.instanceInfos)
+                instances.push_back(
+                    {&blasOf(instanceInfo.blas), instanceInfo.transform, instanceInfo.customIndex, instanceInfo.mask});
+            return instances;
+        }
+    }  // namespace
+
+    TopLevelBVH::TopLevelBVH(std::vector<Instance> const& instanceList)
+    {
+        std::vector<detail::Bounds> instanceBounds;
+        for (uint32_t index = 0; index < instanceList.size(); ++index) {
+            auto& instance = instanceList[index];
+            auto objectToWorld = toMat4(instance.transform);
+            instances.push_back(
+                {instance.blas, glm::inverse(objectToWorld), index, instance.customIndex, instance.mask});
+
+            // World space bounds of the corners of the object space bounds
+            auto blasBounds = instance.blas->bounds();
+            auto& bounds = instanceBounds.emplace_back();
+            if (!instance.blas->triangleCount()) continue;
+            for (int corner = 0; corner < 8; ++corner) {
+                glm::vec3 point{corner & 1 ? blasBounds.max.x : blasBounds.min.x,
+                                corner & 2 ? blasBounds.max.y : blasBounds.min.y,
+                                corner & 4 ? blasBounds.max.z : blasBounds.min.z};
+                grow(bounds, transformPoint(objectToWorld, point));
+            }
+        }
+
+        std::vector<uint32_t> order;
+        nodes = detail::buildBVH(instanceBounds, order);
+        std::vector<InstanceData> ordered;
+        ordered.reserve(instances.size());
+        for (auto index : order) ordered.push_back(instances[index]);
+        instances = std::move(ordered);
+    }
+
+    TopLevelBVH::TopLevelBVH(
+        ext::TopLevelAccelerationStructureInfo const& info,
+        std::function<BottomLevelBVH const&(ext::BottomLevelAccelerationStructure)> const& blasOf)
+        : TopLevelBVH(hostInstances(info, blasOf))
+    {}
+
+    Hit TopLevelBVH::intersect(Ray const& ray) const
+    {
+        Hit hit;
+        hit.t = ray.tMax;
+        RayData rayData(ray.origin, ray.direction, ray.tMin);
+        float tMax = ray.tMax;
+        traverse(nodes, rayData, tMax, [&](uint32_t first, uint32_t count, float& closest) {
+            for (uint32_t i = first; i < first + count; ++i) {
+                auto& instance = instances[i];
+                if (!(instance.mask & ray.cullMask)) continue;
+                Ray objectRay = ray;
+                objectRay.origin = transformPoint(instance.worldToObject, ray.origin);
+                objectRay.direction = transformDirection(instance.worldToObject, ray.direction);
+                if (!instance.blas->intersect(objectRay, hit)) continue;
+                closest = hit.t;
+                hit.instanceIndex = instance.instanceIndex;
+                hit.instanceCustomIndex = instance.customIndex;
+            }
+            return false;
+        });
+        return hit ? hit : Hit{};
+    }
+
+    bool TopLevelBVH::occluded(Ray const& ray) const
+    {
+        RayData rayData(ray.origin, ray.direction, ray.tMin);
+        float tMax = ray.tMax;
+        bool found{false};
+        traverse(nodes, rayData, tMax, [&](uint32_t first, uint32_t count, float&) {
+            for (uint32_t i = first; i < first + count && !found; ++i) {
+                auto& instance = instances[i];
+                if (!(instance.mask & ray.cullMask)) continue;
+                Ray objectRay = ray;
+                objectRay.origin = transformPoint(instance.worldToObject, ray.origin);
+                objectRay.direction = transformDirection(instance.worldToObject, ray.direction);
+                found = instance.blas->occluded(objectRay);
+            }
+            return found;
+        });
+        return found;
+    }
+
+    HitPacket TopLevelBVH::intersect(RayPacket const& packet) const
+    {
+        HitPacket hits;
+        hits.t = packet.tMax;
+        hits.primitiveIndex.fill(Hit::none);
+        hits.geometryIndex.fill(Hit::none);
+        hits.instanceIndex.fill(Hit::none);
+        hits.instanceCustomIndex.fill(Hit::none);
+
+        PacketData packetData(packet);
+        PacketFloat tMax = packet.tMax;
+        auto leaf = [&](uint32_t first, uint32_t count, uint32_t lanes) {
+            for (uint32_t index = first; index < first + count; ++index) {
+                auto& instance = instances[index];
+                if (!(instance.mask & packet.cullMask)) continue;
+                auto objectPacket = transformPacket(instance.worldToObject, packet);
+                auto hitLanes = instance.blas->intersect(objectPacket, hits, lanes);
+                for (uint32_t i = 0; i < packetSize; ++i) {
+                    if (!(hitLanes & (1u << i))) continue;
+                    tMax[i] = hits.t[i];
+                    hits.instanceIndex[i] = instance.instanceIndex;
+                    hits.instanceCustomIndex[i] = instance.customIndex;
+                }
+            }
+            return 0u;
+        };
+        traversePacket(nodes, packetData, tMax, packet.activeLanes, leaf);
+        for (uint32_t i = 0; i < packetSize; ++i)
+            if (hits.instanceIndex[i] == Hit::none) hits.t[i] = std::numeric_limits<float>::infinity();
+        return hits;
+    }
+
+    uint32_t TopLevelBVH::occluded(RayPacket const& packet) const
+    {
+        PacketData packetData(packet);
+        uint32_t found{0};
+        traversePacket(nodes, packetData, packet.tMax, packet.activeLanes,
+                       [&](uint32_t first, uint32_t count, uint32_t lanes) {
+                           for (uint32_t index = first; index < first + count && (lanes & ~found); ++index) {
+                               auto& instance = instances[index];
+                               if (!(instance.mask & packet.cullMask)) continue;
+                               auto objectPacket = transformPacket(instance.worldToObject, packet);
+                               found |= instance.blas->occluded(objectPacket, lanes & ~found);
+                           }
+                           return found;
+                       });
+        return found;
+    }
+}  // namespace cpu
+}  // namespace tga
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cmath>
+
+#include "tga/tga_utils.hpp"
+
+namespace tga
+{
+namespace /*quantization*/
+{
+    static_assert(sizeof(CompactVertex) == 20);
+
+    uint16_t quantizeUnorm16(float value)
+    {
+        return static_cast<uint16_t>(std::lround(std::clamp(value, 0.f, 1.f) * 65535.f));
+    }
+
+    int16_t quantizeSnorm16(float value)
+    {
+        return static_cast<int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * 32767.f));
+    }
+
+    float signNotZero(float value) { return value >= 0.f ? 1.f : -1.f; }
+}  // namespace
+
+glm::vec2 octahedralEncode(glm::vec3 direction)
+{
+    float sum = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (!(sum > 0.f) || !std::isfinite(sum)) return {0.f, 0.f};
+    glm::vec2 encoded{direction.x / sum, direction.y / sum};
+    // The lower hemisphere is folded over the diagonals of the square
+    if (direction.z < 0.f)
+        encoded = {(1.f - std::abs(encoded.y)) * signNotZero(encoded.x),
+                   (1.f - std::abs(encoded.x)) * signNotZero(encoded.y)};
+    return encoded;
+}
+
+glm::vec3 octahedralDecode(glm::vec2 encoded)
+{
+    glm::vec3 direction{encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y)};
+    float fold = std::max(-direction.z, 0.f);
+    direction.x -= fold * signNotZero(direction.x);
+    direction.y -= fold * signNotZero(direction.y);
+    return glm::normalize(direction);
+}
+
+glm::mat4 CompactObj::positionTransform() const
+{
+    return glm::scale(glm::translate(glm::mat4(1.f), boundsMin), boundsMax - boundsMin);
+}
+
+CompactObj quantizeObj(Obj const& obj)
+{
+    CompactObj compact{{}, obj.indexBuffer, glm::vec3{0.f}, glm::vec3{0.f}};
+    if (obj.vertexBuffer.empty()) return compact;
+    compact.boundsMin = compact.boundsMax = obj.vertexBuffer.front().position;
+    for (auto& vertex : obj.vertexBuffer) {
+        compact.boundsMin = glm::min(compact.boundsMin, vertex.position);
+        compact.boundsMax = glm::max(compact.boundsMax, vertex.position);
+    }
+    // Flat meshes have an axis without extent, all of their positions quantize to 0 on it
+    glm::vec3 extent = compact.boundsMax - compact.boundsMin;
+    glm::vec3 inverseExtent{extent.x > 0.f ? 1.f / extent.x : 0.f, extent.y > 0.f ? 1.f / extent.y : 0.f,
+                            extent.z > 0.f ? 1.f / extent.z : 0.f};
+
+    compact.vertexBuffer.resize(obj.vertexBuffer.size());
+    for (size_t i = 0; i < obj.vertexBuffer.size(); ++i) {
+        auto& vertex = obj.vertexBuffer[i];
+        auto& result = compact.vertexBuffer[i];
+        glm::vec3 position = (vertex.position - compact.boundsMin) * inverseExtent;
+        for (int axis = 0; axis < 3; ++axis) result.position[axis] = quantizeUnorm16(position[axis]);
+        result.position[3] = 0;
+        auto normal = octahedralEncode(vertex.normal);
+        auto tangent = octahedralEncode(vertex.tangent);
+        result.normal[0] = quantizeSnorm16(normal.x);
+        result.normal[1] = quantizeSnorm16(normal.y);
+        result.tangent[0] = quantizeSnorm16(tangent.x);
+        result.tangent[1] = quantizeSnorm16(tangent.y);
+        uint32_t uv = glm::packHalf2x16(vertex.uv);
+        result.uv[0] = static_cast<uint16_t>(uv & 0xFFFFu);
+        result.uv[1] = static_cast<uint16_t>(uv >> 16);
+    }
+    return compact;
+}
+
+CompactObj loadCompactObj(std::string const& filepath) { return quantizeObj(loadObj(filepath)); }
+}  // namespace tga
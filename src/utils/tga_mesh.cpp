@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "tga/tga_utils.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Layout of a mesh file, all values are little endian:
+//   MeshFileHeader
+//   MeshFileAttribute[attributeCount]
+//   vertex data at vertexDataOffset, vertexCount * vertexSize bytes
+//   index data at indexDataOffset, indexCount uint32_t
+// The blobs start at multiples of blobAlignment, so they can be used in place from the mapped file
+namespace tga
+{
+namespace /*mesh files*/
+{
+    constexpr char meshFileMagic[4]{'T', 'G', 'A', 'M'};
+    constexpr uint32_t meshFileVersion = 1;
+    constexpr uint64_t blobAlignment = 16;
+
+    struct MeshFileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexSize;
+        uint32_t attributeCount;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint64_t vertexDataOffset;
+        uint64_t indexDataOffset;
+        float boundsMin[3];
+        float boundsMax[3];
+    };
+    static_assert(sizeof(MeshFileHeader) == 64);
+
+    struct MeshFileAttribute {
+        uint32_t offset;
+        uint32_t format; /**<Value of tga::Format*/
+    };
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+    // Attributes need a known, uncompressed format and have to lie within the vertex
+    bool validAttribute(uint64_t offset, Format format, uint64_t vertexSize)
+    {
+        auto size = formatBlockInfo(format).size;
+        return size && !isBlockCompressed(format) && offset + size <= vertexSize;
+    }
+
+    // Maps the whole file read only, the mapping is released with the last copy of the pointer
+    std::shared_ptr<void const> mapFile(std::string const& filepath, size_t& size)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("[TGA] Utils: Can't open mesh file: " + filepath);
+        LARGE_INTEGER fileSize;
+        size = GetFileSizeEx(file, &fileSize) ? static_cast<size_t>(fileSize.QuadPart) : 0;
+        HANDLE mappingObject = size ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        CloseHandle(file);
+        void const *view = mappingObject ? MapViewOfFile(mappingObject, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (mappingObject) CloseHandle(mappingObject);
+        if (!view) throw std::runtime_error("[TGA] Utils: Can't map mesh file: " + filepath);
+        return std::shared_ptr<void const>(view, [](void const *view) { UnmapViewOfFile(view); });
+#else
+        int file = open(filepath.c_str(), O_RDONLY);
+        if (file < 0) throw std::runtime_error("[TGA] Utils: Can't open mesh file: " + filepath);
+        struct stat fileStat;
+        size = fstat(file, &fileStat) ? 0 : static_cast<size_t>(fileStat.st_size);
+        void *view = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+        close(file);
+        if (view == MAP_FAILED) throw std::runtime_error("[TGA] Utils: Can't map mesh file: " + filepath);
+        // The blobs are read front to back once, start reading them in right away
+        madvise(view, size, MADV_SEQUENTIAL);
+        madvise(view, size, MADV_WILLNEED);
+        return std::shared_ptr<void const>(view, [size](void const *view) { munmap(const_cast<void *>(view), size); });
+#endif
+    }
+
+    glm::vec3 readVec3(float const (&values)[3]) { return {values[0], values[1], values[2]}; }
+}  // namespace
+
+MeshFile::MeshFile(std::string const& filepath)
+{
+    size_t fileSize;
+    mapping = mapFile(filepath, fileSize);
+    auto bytes = static_cast<uint8_t const *>(mapping.get());
+    auto invalid = [&](char const *reason) {
+        return std::runtime_error(std::string("[TGA] Utils: ") + reason + ": " + filepath);
+    };
+
+    MeshFileHeader header;
+    if (fileSize < sizeof(header)) throw invalid("Not a mesh file");
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, meshFileMagic, sizeof(meshFileMagic))) throw invalid("Not a mesh file");
+    if (header.version != meshFileVersion) throw invalid("Unsupported mesh file version");
+
+    uint64_t attributesEnd = sizeof(header) + uint64_t{header.attributeCount} * sizeof(MeshFileAttribute);
+    uint64_t vertexDataSize = uint64_t{header.vertexCount} * header.vertexSize;
+    uint64_t indexDataSize = uint64_t{header.indexCount} * sizeof(uint32_t);
+    if (attributesEnd > fileSize || header.vertexDataOffset % blobAlignment ||
+        header.indexDataOffset % blobAlignment || header.vertexDataOffset > fileSize ||
+        vertexDataSize > fileSize - header.vertexDataOffset || header.indexDataOffset > fileSize ||
+        indexDataSize > fileSize - header.indexDataOffset)
+        throw invalid("Truncated mesh file");
+
+    layout.vertexSize = header.vertexSize;
+    for (uint32_t i = 0; i < header.attributeCount; ++i) {
+        MeshFileAttribute attribute;
+        std::memcpy(&attribute, bytes + sizeof(header) + i * sizeof(attribute), sizeof(attribute));
+        auto format = static_cast<Format>(attribute.format);
+        if (!validAttribute(attribute.offset, format, header.vertexSize)) throw invalid("Invalid vertex attribute");
+        layout.vertexAttributes.emplace_back(attribute.offset, format);
+    }
+    vertices = header.vertexCount;
+    indices = header.indexCount;
+    vertexBlob = bytes + header.vertexDataOffset;
+    indexBlob = reinterpret_cast<uint32_t const *>(bytes + header.indexDataOffset);
+    minimum = readVec3(header.boundsMin);
+    maximum = readVec3(header.boundsMax);
+}
+
+void writeMesh(std::string const& filepath, VertexLayout const& vertexLayout, void const *vertexData,
+               uint32_t vertexCount, std::vector<uint32_t> const& indexBuffer, glm::vec3 boundsMin,
+               glm::vec3 boundsMax)
+{
+    for (auto& attribute : vertexLayout.vertexAttributes)
+        if (!validAttribute(attribute.offset, attribute.format, vertexLayout.vertexSize))
+            throw std::runtime_error("[TGA] Utils: Vertex attribute has no vertex format or exceeds the vertex size");
+    for (auto index : indexBuffer)
+        if (index >= vertexCount) throw std::runtime_error("[TGA] Utils: Mesh index exceeds the vertex count");
+
+    MeshFileHeader header{};
+    std::memcpy(header.magic, meshFileMagic, sizeof(meshFileMagic));
+    header.version = meshFileVersion;
+    header.vertexSize = static_cast<uint32_t>(vertexLayout.vertexSize);
+    header.attributeCount = static_cast<uint32_t>(vertexLayout.vertexAttributes.size());
+    header.vertexCount = vertexCount;
+    header.indexCount = static_cast<uint32_t>(indexBuffer.size());
+    uint64_t vertexDataSize = uint64_t{vertexCount} * vertexLayout.vertexSize;
+    uint64_t attributesEnd = sizeof(header) + header.attributeCount * sizeof(MeshFileAttribute);
+    header.vertexDataOffset = alignUp(attributesEnd, blobAlignment);
+    header.indexDataOffset = alignUp(header.vertexDataOffset + vertexDataSize, blobAlignment);
+    for (int i = 0; i < 3; ++i) {
+        header.boundsMin[i] = boundsMin[i];
+        header.boundsMax[i] = boundsMax[i];
+    }
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("[TGA] Utils: Can't write mesh file: " + filepath);
+    char const padding[blobAlignment]{};
+    auto padTo = [&](uint64_t offset) {
+        file.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+    };
+    file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    for (auto& attribute : vertexLayout.vertexAttributes) {
+        MeshFileAttribute fileAttribute{static_cast<uint32_t>(attribute.offset),
+                                        static_cast<uint32_t>(attribute.format)};
+        file.write(reinterpret_cast<char const *>(&fileAttribute), sizeof(fileAttribute));
+    }
+    padTo(header.vertexDataOffset);
+    file.write(static_cast<char const *>(vertexData), static_cast<std::streamsize>(vertexDataSize));
+    padTo(header.indexDataOffset);
+    file.write(reinterpret_cast<char const *>(indexBuffer.data()),
+               static_cast<std::streamsize>(indexBuffer.size() * sizeof(uint32_t)));
+    if (!file) throw std::runtime_error("[TGA] Utils: Can't write mesh file: " + filepath);
+}
+
+void writeMesh(std::string const& filepath, Obj const& obj)
+{
+    glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+    glm::vec3 boundsMax{-std::numeric_limits<float>::max()};
+    for (auto& vertex : obj.vertexBuffer) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+    writeMesh(filepath, Vertex::layout(), obj.vertexBuffer.data(), static_cast<uint32_t>(obj.vertexBuffer.size()),
+              obj.indexBuffer, boundsMin, boundsMax);
+}
+
+void writeMesh(std::string const& filepath, CompactObj const& obj)
+{
+    writeMesh(filepath, CompactVertex::layout(), obj.vertexBuffer.data(),
+              static_cast<uint32_t>(obj.vertexBuffer.size()), obj.indexBuffer, obj.boundsMin, obj.boundsMax);
+}
+
+MeshBundle loadMesh(std::string const& filepath, tga::Interface& tgai, BufferUsage additionalUsage)
+{
+    MeshFile file(filepath);
+    if (!file.vertexCount() || !file.indexCount())
+        throw std::runtime_error("[TGA] Utils: Mesh file without vertices or indices: " + filepath);
+
+    // Vertices and indices share one staging buffer, the copy is the only pass over the data
+    size_t vertexDataSize = size_t{file.vertexCount()} * file.vertexLayout().vertexSize;
+    size_t indexDataOffset = alignUp(vertexDataSize, blobAlignment);
+    size_t indexDataSize = size_t{file.indexCount()} * sizeof(uint32_t);
+    auto staging = tgai.createStagingBuffer({indexDataOffset + indexDataSize});
+    auto mapping = static_cast<uint8_t *>(tgai.getMapping(staging));
+    std::memcpy(mapping, file.vertexData(), vertexDataSize);
+    std::memcpy(mapping + indexDataOffset, file.indexData(), indexDataSize);
+
+    MeshBundle bundle{{}, {}, file.vertexCount(), file.indexCount(), file.vertexLayout(), file.boundsMin(),
+                      file.boundsMax()};
+    try {
+        bundle.vertexBuffer = tgai.createBuffer({BufferUsage::vertex | additionalUsage, vertexDataSize, staging});
+        bundle.indexBuffer =
+            tgai.createBuffer({BufferUsage::index | additionalUsage, indexDataSize, staging, indexDataOffset});
+    } catch (...) {
+        if (bundle.vertexBuffer) tgai.free(bundle.vertexBuffer);
+        tgai.free(staging);
+        throw;
+    }
+    tgai.free(staging);
+    return bundle;
+}
+}  // namespace tga
@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "tga/tga_utils.hpp"
+
+// Triangle orders from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander, Nehab and
+// Barczak 2007): Tipsify for the vertex cache, then clusters of the cache optimized order sorted for overdraw
+namespace tga
+{
+namespace /*vertex cache*/
+{
+    // FIFO post transform cache: a vertex is cached if at most cacheSize misses happened since it was transformed
+    class CacheSimulation {
+    public:
+        CacheSimulation(uint32_t vertexCount, uint32_t _cacheSize)
+            : cacheSize(_cacheSize), timestamp(_cacheSize + 1), timestamps(vertexCount, 0)
+        {}
+
+        // Returns true on a miss
+        bool access(uint32_t vertex)
+        {
+            if (timestamp - timestamps[vertex] <= cacheSize) return false;
+            timestamps[vertex] = timestamp++;
+            return true;
+        }
+
+        uint32_t accessTriangle(uint32_t const *triangle)
+        {
+            return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+        }
+
+        void flush() { timestamp += cacheSize + 1; }
+
+    private:
+        uint32_t cacheSize;
+        uint32_t timestamp;
+        std::vector<uint32_t> timestamps;
+    };
+
+    void validateIndices(std::span<uint32_t const> indices, uint32_t vertexCount)
+    {
+        if (indices.size() % 3) throw std::runtime_error("[TGA] Utils: Index count must be a multiple of 3");
+        for (auto index : indices)
+            if (index >= vertexCount) throw std::runtime_error("[TGA] Utils: Index exceeds the vertex count");
+    }
+
+    glm::vec3 readPosition(void const *positionData, size_t vertexStride, uint32_t vertex)
+    {
+        glm::vec3 position;
+        std::memcpy(&position, static_cast<uint8_t const *>(positionData) + vertex * vertexStride, sizeof(position));
+        return position;
+    }
+
+    // Triangles of each vertex in compressed rows: the triangles of vertex v are triangles[offsets[v], offsets[v+1])
+    struct Adjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        Adjacency(std::span<uint32_t const> indices, uint32_t vertexCount) : offsets(vertexCount + 1, 0)
+        {
+            for (auto index : indices) ++offsets[index + 1];
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            triangles.resize(indices.size());
+            auto fill = offsets;
+            for (uint32_t i = 0; i < indices.size(); ++i) triangles[fill[indices[i]]++] = i / 3;
+        }
+    };
+}  // namespace
+
+VertexCacheStatistics analyzeVertexCache(std::span<uint32_t const> indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    validateIndices(indices, vertexCount);
+    CacheSimulation cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    uint32_t invocations{0}, referencedCount{0};
+    for (auto index : indices) {
+        invocations += cache.access(index);
+        if (referenced[index]) continue;
+        referenced[index] = true;
+        ++referencedCount;
+    }
+    VertexCacheStatistics statistics;
+    statistics.vertexShaderInvocations = invocations;
+    statistics.acmr = indices.empty() ? 0.f : float(invocations) / float(indices.size() / 3);
+    statistics.atvr = referencedCount ? float(invocations) / float(referencedCount) : 0.f;
+    return statistics;
+}
+
+void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    validateIndices(indices, vertexCount);
+    auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    Adjacency adjacency(indices, vertexCount);
+
+    // Live triangles are the triangles of a vertex that are not emitted yet
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+        liveTriangles[vertex] = adjacency.offsets[vertex + 1] - adjacency.offsets[vertex];
+    std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    constexpr uint32_t none = ~0u;
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t cursor{0};
+    // Vertices that still have live triangles, from the most recently used ones or in input order
+    auto skipDeadEnd = [&]() -> uint32_t {
+        while (!deadEnds.empty()) {
+            auto vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex]) return vertex;
+        }
+        for (; cursor < vertexCount; ++cursor)
+            if (liveTriangles[cursor]) return cursor;
+        return none;
+    };
+
+    for (auto fanning = skipDeadEnd(); fanning != none;) {
+        // Emit all live triangles around the fanning vertex
+        candidates.clear();
+        for (auto it = adjacency.offsets[fanning]; it < adjacency.offsets[fanning + 1]; ++it) {
+            auto triangle = adjacency.triangles[it];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = true;
+            for (uint32_t corner = 0; corner < 3; ++corner) {
+                auto vertex = indices[3 * triangle + corner];
+                result.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+                if (timestamp - cacheTimestamps[vertex] > cacheSize) cacheTimestamps[vertex] = timestamp++;
+            }
+        }
+
+        // Next is the candidate that stays in the cache the longest while its live triangles are emitted
+        auto next = none;
+        int32_t bestPriority{-1};
+        for (auto vertex : candidates) {
+            if (!liveTriangles[vertex]) continue;
+            int32_t priority{0};
+            if (timestamp - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+                priority = static_cast<int32_t>(timestamp - cacheTimestamps[vertex]);
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+        fanning = next != none ? next : skipDeadEnd();
+    }
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+namespace /*overdraw*/
+{
+    // Cluster boundaries as first triangles, ends with the triangle count. Clusters end where the cache simulation
+    // misses all vertices of a triangle (a dead end of the vertex cache order) or where the ACMR of the cluster so far
+    // is within threshold of the ACMR of the surrounding part
+    std::vector<uint32_t> clusterBoundaries(std::span<uint32_t const> indices, uint32_t vertexCount,
+                                            uint32_t cacheSize, float threshold)
+    {
+        auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        CacheSimulation cache(vertexCount, cacheSize);
+        std::vector<uint32_t> hardBoundaries{0};
+        for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+            if (cache.accessTriangle(&indices[3 * triangle]) == 3 && triangle) hardBoundaries.push_back(triangle);
+        hardBoundaries.push_back(triangleCount);
+
+        std::vector<uint32_t> boundaries;
+        for (size_t i = 0; i + 1 < hardBoundaries.size(); ++i) {
+            auto begin = hardBoundaries[i];
+            auto end = hardBoundaries[i + 1];
+            cache.flush();
+            uint32_t misses{0};
+            for (auto triangle = begin; triangle < end; ++triangle)
+                misses += cache.accessTriangle(&indices[3 * triangle]);
+            float clusterThreshold = threshold * float(misses) / float(end - begin);
+
+            cache.flush();
+            boundaries.push_back(begin);
+            misses = 0;
+            auto start = begin;
+            for (auto triangle = begin; triangle < end; ++triangle) {
+                misses += cache.accessTriangle(&indices[3 * triangle]);
+                if (triangle + 1 < end && float(misses) / float(triangle + 1 - start) <= clusterThreshold) {
+                    boundaries.push_back(triangle + 1);
+                    cache.flush();
+                    misses = 0;
+                    start = triangle + 1;
+                }
+            }
+        }
+        boundaries.push_back(triangleCount);
+        return boundaries;
+    }
+}  // namespace
+
+void optimizeOverdraw(std::span<uint32_t> indices, void const *positionData, size_t vertexStride,
+                      uint32_t vertexCount, uint32_t cacheSize, float threshold)
+{
+    validateIndices(indices, vertexCount);
+    if (indices.empty()) return;
+    auto position = [&](uint32_t vertex) { return readPosition(positionData, vertexStride, vertex); };
+    auto boundaries = clusterBoundaries(indices, vertexCount, cacheSize, threshold);
+    auto clusterCount = static_cast<uint32_t>(boundaries.size() - 1);
+
+    // Area weighted centroids and normals of the clusters and of the mesh
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.f));
+    glm::vec3 meshCentroid{0.f};
+    float meshArea{0.f};
+    for (uint32_t cluster = 0; cluster < clusterCount; ++cluster) {
+        float clusterArea{0.f};
+        for (auto triangle = boundaries[cluster]; triangle < boundaries[cluster + 1]; ++triangle) {
+            auto p0 = position(indices[3 * triangle + 0]);
+            auto p1 = position(indices[3 * triangle + 1]);
+            auto p2 = position(indices[3 * triangle + 2]);
+            auto normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            centroids[cluster] += (p0 + p1 + p2) * (area / 3.f);
+            normals[cluster] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += centroids[cluster];
+        meshArea += clusterArea;
+        if (clusterArea > 0.f) centroids[cluster] /= clusterArea;
+        else centroids[cluster] = position(indices[3 * boundaries[cluster]]);
+    }
+    meshCentroid = meshArea > 0.f ? meshCentroid / meshArea : glm::vec3(0.f);
+
+    // Clusters that face away from the center are likely in front of the others from most directions, draw them first
+    std::vector<float> sortKeys(clusterCount, 0.f);
+    for (uint32_t cluster = 0; cluster < clusterCount; ++cluster) {
+        float normalLength = glm::length(normals[cluster]);
+        if (normalLength > 0.f)
+            sortKeys[cluster] = glm::dot(centroids[cluster] - meshCentroid, normals[cluster]) / normalLength;
+    }
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (auto cluster : order)
+        result.insert(result.end(), indices.begin() + 3 * boundaries[cluster],
+                      indices.begin() + 3 * boundaries[cluster + 1]);
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices, uint32_t vertexCount)
+{
+    validateIndices(indices, vertexCount);
+    std::vector<uint32_t> remap(vertexCount, unusedVertex);
+    uint32_t nextVertex{0};
+    for (auto& index : indices) {
+        if (remap[index] == unusedVertex) remap[index] = nextVertex++;
+        index = remap[index];
+    }
+    return remap;
+}
+
+size_t removeDegenerateTriangles(std::vector<uint32_t>& indices)
+{
+    size_t kept{0};
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        auto a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (a == b || b == c || c == a) continue;
+        indices[kept++] = a;
+        indices[kept++] = b;
+        indices[kept++] = c;
+    }
+    auto removed = (indices.size() - kept) / 3;
+    indices.resize(kept);
+    return removed;
+}
+
+MeshOptimizationReport optimizeMesh(Obj& obj, uint32_t cacheSize, float overdrawThreshold)
+{
+    MeshOptimizationReport report;
+    auto vertexCount = static_cast<uint32_t>(obj.vertexBuffer.size());
+    report.before = analyzeVertexCache(obj.indexBuffer, vertexCount, cacheSize);
+
+    report.removedTriangles = removeDegenerateTriangles(obj.indexBuffer);
+    optimizeVertexCache(obj.indexBuffer, vertexCount, cacheSize);
+    optimizeOverdraw(obj.indexBuffer, obj.vertexBuffer.data(), sizeof(Vertex), vertexCount, cacheSize,
+                     overdrawThreshold);
+    auto remap = optimizeVertexFetch(obj.indexBuffer, vertexCount);
+    obj.vertexBuffer = remapVertices(obj.vertexBuffer, remap);
+    report.removedVertices = vertexCount - obj.vertexBuffer.size();
+
+    report.after = analyzeVertexCache(obj.indexBuffer, static_cast<uint32_t>(obj.vertexBuffer.size()), cacheSize);
+    return report;
+}
+
+namespace /*meshlets*/
+{
+    // Bounding sphere around the center of the bounding box, normal cone around the average unit triangle normal
+    Meshlet meshletBounds(std::vector<uint32_t> const& vertices, std::vector<uint32_t> const& triangles,
+                          std::vector<glm::vec3> const& triangleNormals, void const *positionData,
+                          size_t vertexStride)
+    {
+        Meshlet meshlet{};
+        glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+        glm::vec3 boundsMax{-std::numeric_limits<float>::max()};
+        for (auto vertex : vertices) {
+            auto position = readPosition(positionData, vertexStride, vertex);
+            boundsMin = glm::min(boundsMin, position);
+            boundsMax = glm::max(boundsMax, position);
+        }
+        meshlet.center = (boundsMin + boundsMax) * 0.5f;
+        for (auto vertex : vertices) {
+            auto offset = readPosition(positionData, vertexStride, vertex) - meshlet.center;
+            meshlet.radius = std::max(meshlet.radius, glm::length(offset));
+        }
+
+        glm::vec3 normalSum{0.f};
+        for (auto triangle : triangles) normalSum += triangleNormals[triangle];
+        float normalLength = glm::length(normalSum);
+        meshlet.coneCutoff = 1.f;
+        if (!(normalLength > 0.f)) return meshlet;
+        meshlet.coneAxis = normalSum / normalLength;
+        // Degenerate triangles have no normal and can't be seen from any side
+        float minimumCosine{1.f};
+        for (auto triangle : triangles)
+            if (glm::dot(triangleNormals[triangle], triangleNormals[triangle]) > 0.f)
+                minimumCosine = std::min(minimumCosine, glm::dot(meshlet.coneAxis, triangleNormals[triangle]));
+        // The camera sees no triangle from within the cone of directions at most 90 degrees minus the spread of the
+        // normals away from the axis. Normals spread over more than a half space leave no such directions
+        if (minimumCosine > 0.f) meshlet.coneCutoff = std::sqrt(1.f - minimumCosine * minimumCosine);
+        return meshlet;
+    }
+}  // namespace
+
+std::vector<Meshlet> buildMeshlets(std::span<uint32_t> indices, void const *positionData, size_t vertexStride,
+                                   uint32_t vertexCount, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    validateIndices(indices, vertexCount);
+    if (maxVertices < 3 || !maxTriangles)
+        throw std::runtime_error("[TGA] Utils: Meshlets need room for at least 3 vertices and 1 triangle");
+    auto triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    Adjacency adjacency(indices, vertexCount);
+
+    std::vector<glm::vec3> triangleNormals(triangleCount, glm::vec3(0.f));
+    for (uint32_t triangle = 0; triangle < triangleCount; ++triangle) {
+        auto p0 = readPosition(positionData, vertexStride, indices[3 * triangle + 0]);
+        auto p1 = readPosition(positionData, vertexStride, indices[3 * triangle + 1]);
+        auto p2 = readPosition(positionData, vertexStride, indices[3 * triangle + 2]);
+        auto normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length > 0.f) triangleNormals[triangle] = normal / length;
+    }
+
+    constexpr uint32_t none = ~0u;
+    // Both are stamped with the meshlet that last used the vertex or added the triangle to its candidates
+    std::vector<uint32_t> vertexMeshlet(vertexCount, none);
+    std::vector<uint32_t> candidateMeshlet(triangleCount, none);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> vertices, triangles, candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::vector<Meshlet> meshlets;
+    uint32_t cursor{0};
+
+    while (result.size() < indices.size()) {
+        auto meshletIndex = static_cast<uint32_t>(meshlets.size());
+        auto firstIndex = static_cast<uint32_t>(result.size());
+        vertices.clear();
+        triangles.clear();
+        candidates.clear();
+        glm::vec3 normalSum{0.f};
+
+        auto newVertices = [&](uint32_t triangle) {
+            auto a = indices[3 * triangle], b = indices[3 * triangle + 1], c = indices[3 * triangle + 2];
+            return uint32_t(vertexMeshlet[a] != meshletIndex) + uint32_t(vertexMeshlet[b] != meshletIndex && b != a) +
+                   uint32_t(vertexMeshlet[c] != meshletIndex && c != a && c != b);
+        };
+        auto add = [&](uint32_t triangle) {
+            emitted[triangle] = true;
+            triangles.push_back(triangle);
+            normalSum += triangleNormals[triangle];
+            for (uint32_t corner = 0; corner < 3; ++corner) {
+                auto vertex = indices[3 * triangle + corner];
+                result.push_back(vertex);
+                if (vertexMeshlet[vertex] == meshletIndex) continue;
+                vertexMeshlet[vertex] = meshletIndex;
+                vertices.push_back(vertex);
+                for (auto it = adjacency.offsets[vertex]; it < adjacency.offsets[vertex + 1]; ++it) {
+                    auto neighbour = adjacency.triangles[it];
+                    if (emitted[neighbour] || candidateMeshlet[neighbour] == meshletIndex) continue;
+                    candidateMeshlet[neighbour] = meshletIndex;
+                    candidates.push_back(neighbour);
+                }
+            }
+        };
+
+        while (emitted[cursor]) ++cursor;
+        add(cursor);
+        while (triangles.size() < maxTriangles) {
+            // Most shared vertices first, the agreement with the average normal only breaks ties
+            glm::vec3 axis = glm::dot(normalSum, normalSum) > 0.f ? glm::normalize(normalSum) : glm::vec3(0.f);
+            auto best = none;
+            float bestScore{-1.f};
+            size_t kept{0};
+            for (auto triangle : candidates) {
+                if (emitted[triangle]) continue;
+                candidates[kept++] = triangle;
+                auto added = newVertices(triangle);
+                if (vertices.size() + added > maxVertices) continue;
+                float score = float(3 - added) + 0.25f * (glm::dot(axis, triangleNormals[triangle]) + 1.f);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = triangle;
+                }
+            }
+            candidates.resize(kept);
+            if (best == none && candidates.empty()) {
+                // The connected part is done, continue with the next triangle in index order
+                while (cursor < triangleCount && emitted[cursor]) ++cursor;
+                if (cursor < triangleCount && vertices.size() + newVertices(cursor) <= maxVertices) best = cursor;
+            }
+            if (best == none) break;
+            add(best);
+        }
+
+        auto& meshlet = meshlets.emplace_back(
+            meshletBounds(vertices, triangles, triangleNormals, positionData, vertexStride));
+        meshlet.firstIndex = firstIndex;
+        meshlet.triangleCount = static_cast<uint32_t>(triangles.size());
+        meshlet.vertexCount = static_cast<uint32_t>(vertices.size());
+    }
+    std::copy(result.begin(), result.end(), indices.begin());
+    return meshlets;
+}
+
+std::vector<Meshlet> buildMeshlets(Obj& obj, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    return buildMeshlets(obj.indexBuffer, obj.vertexBuffer.data(), sizeof(Vertex),
+                         static_cast<uint32_t>(obj.vertexBuffer.size()), maxVertices, maxTriangles);
+}
+
+bool meshletVisible(Meshlet const& meshlet, glm::mat4 const& modelViewProjection, glm::vec3 cameraPosition)
+{
+    // Frustum planes from the rows of the matrix, for a depth range of 0 to 1
+    auto row = [&](int i) {
+        return glm::vec4(modelViewProjection[0][i], modelViewProjection[1][i], modelViewProjection[2][i],
+                         modelViewProjection[3][i]);
+    };
+    std::array<glm::vec4, 6> planes{row(3) + row(0), row(3) - row(0), row(3) + row(1),
+                                    row(3) - row(1), row(2),          row(3) - row(2)};
+    for (auto& plane : planes) {
+        glm::vec3 normal{plane};
+        if (glm::dot(normal, meshlet.center) + plane.w < -meshlet.radius * glm::length(normal)) return false;
+    }
+    auto view = meshlet.center - cameraPosition;
+    return glm::dot(view, meshlet.coneAxis) < meshlet.coneCutoff * glm::length(view) + meshlet.radius;
+}
+}  // namespace tga
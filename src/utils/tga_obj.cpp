@@ -0,0 +1,541 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#include "tga/tga_utils.hpp"
+
+// OBJ loading in two parallel passes over the file: the first counts the elements of each chunk of lines, which gives
+// every chunk its offsets into the final arrays, the second parses straight into them. Relative (negative) indices
+// are resolved against these offsets and absolute ones are checked against the totals of the first pass, so chunks
+// don't depend on each other and faces may reference vertices defined later in the file.
+namespace tga
+{
+namespace /*parallel work*/
+{
+    uint32_t workerCount() { return std::max(std::thread::hardware_concurrency(), 1u); }
+
+    // Runs function(task) for every task in [0, taskCount) on all cores. Exceptions are rethrown on this thread
+    template <typename Function>
+    void parallelFor(uint32_t taskCount, Function const& function)
+    {
+        std::atomic<uint32_t> nextTask{0};
+        auto work = [&] {
+            for (auto task = nextTask++; task < taskCount; task = nextTask++) function(task);
+        };
+        std::vector<std::future<void>> workers;
+        for (uint32_t i = 1; i < std::min(workerCount(), taskCount); ++i)
+            workers.push_back(std::async(std::launch::async, work));
+        work();
+        for (auto& worker : workers) worker.get();
+    }
+
+    // Begin of the part of [0, count) that belongs to task, the part ends at the begin of the next task
+    size_t taskBegin(size_t count, uint32_t taskCount, uint32_t task) { return count * task / taskCount; }
+}  // namespace
+
+namespace /*obj parsing*/
+{
+    constexpr int32_t missingIndex = -1;
+    constexpr int32_t invalidIndex = std::numeric_limits<int32_t>::min();
+
+    // Indices of the attributes of a face vertex, missingIndex if the face doesn't reference the attribute
+    struct ObjCorner {
+        int32_t position, texcoord, normal;
+    };
+
+    struct ObjCounts {
+        size_t positions{0}, texcoords{0}, normals{0}, corners{0}, quads{0};
+    };
+
+    struct ObjData {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texcoords;
+        std::vector<glm::vec3> normals;
+        std::vector<ObjCorner> corners;  // Three per triangle, polygons are triangulated as fans
+        std::vector<uint32_t> quads;     // First corner of every quad, see splitQuads
+    };
+
+    struct LineRange {
+        char const *begin, *end;
+    };
+
+    std::vector<char> readText(std::string const& filepath)
+    {
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file.is_open()) throw std::runtime_error("[TGA] Utils: Can't open OBJ file: " + filepath);
+        std::vector<char> text(std::filesystem::file_size(filepath) + 1);
+        if (!file.read(text.data(), text.size() - 1))
+            throw std::runtime_error("[TGA] Utils: Can't read OBJ file: " + filepath);
+        // The last line ends like every other line
+        text.back() = '\n';
+        return text;
+    }
+
+    // Splits the text into ranges of whole lines of about equal size
+    std::vector<LineRange> splitLines(std::vector<char> const& text, uint32_t rangeCount)
+    {
+        std::vector<LineRange> ranges;
+        auto begin = text.data();
+        auto end = text.data() + text.size();
+        for (uint32_t range = 0; range < rangeCount && begin != end; ++range) {
+            auto rangeEnd = text.data() + taskBegin(text.size(), rangeCount, range + 1);
+            rangeEnd = std::max(rangeEnd, begin);
+            if (rangeEnd != end) rangeEnd = static_cast<char const *>(std::memchr(rangeEnd, '\n', end - rangeEnd)) + 1;
+            ranges.push_back({begin, rangeEnd});
+            begin = rangeEnd;
+        }
+        return ranges;
+    }
+
+    bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    // Comments may follow the elements of a line
+    bool isLineEnd(char c) { return c == '\n' || c == '#'; }
+
+    char const *skipBlanks(char const *it)
+    {
+        while (isBlank(*it)) ++it;
+        return it;
+    }
+
+    char const *lineEnd(char const *it, char const *end)
+    {
+        return static_cast<char const *>(std::memchr(it, '\n', end - it));
+    }
+
+    enum class LineType { other, position, texcoord, normal, face };
+
+    // Sets it to the first argument of the line
+    LineType lineType(char const *& it)
+    {
+        it = skipBlanks(it);
+        // Compares byte by byte and stops at the first mismatch, which is at the latest the '\n' ending the text
+        auto startsWith = [&](char const *keyword) {
+            size_t length{0};
+            for (; keyword[length]; ++length)
+                if (it[length] != keyword[length]) return false;
+            if (!isBlank(it[length])) return false;
+            it += length;
+            return true;
+        };
+        if (startsWith("v")) return LineType::position;
+        if (startsWith("vt")) return LineType::texcoord;
+        if (startsWith("vn")) return LineType::normal;
+        if (startsWith("f")) return LineType::face;
+        return LineType::other;
+    }
+
+    uint32_t faceVertexCount(char const *it)
+    {
+        uint32_t count{0};
+        for (it = skipBlanks(it); !isLineEnd(*it); it = skipBlanks(it)) {
+            ++count;
+            while (!isLineEnd(*it) && !isBlank(*it)) ++it;
+        }
+        return count;
+    }
+
+    ObjCounts countElements(LineRange range)
+    {
+        ObjCounts counts;
+        for (auto it = range.begin; it != range.end; it = lineEnd(it, range.end) + 1) {
+            switch (lineType(it)) {
+                case LineType::position: ++counts.positions; break;
+                case LineType::texcoord: ++counts.texcoords; break;
+                case LineType::normal: ++counts.normals; break;
+                case LineType::face: {
+                    auto vertexCount = faceVertexCount(it);
+                    counts.corners += 3 * (std::max(vertexCount, 2u) - 2);
+                    if (vertexCount == 4) ++counts.quads;
+                    break;
+                }
+                default: break;
+            }
+        }
+        return counts;
+    }
+
+    // Decimal floats with optional exponent. Digits beyond what a double holds are dropped
+    char const *parseFloat(char const *it, float& value)
+    {
+        it = skipBlanks(it);
+        bool negative = *it == '-';
+        if (*it == '-' || *it == '+') ++it;
+        uint64_t mantissa{0};
+        int exponent{0};
+        int digits{0};
+        for (; *it >= '0' && *it <= '9'; ++it, ++digits) {
+            if (digits < 19) mantissa = mantissa * 10 + (*it - '0');
+            else ++exponent;
+        }
+        if (*it == '.') {
+            for (++it; *it >= '0' && *it <= '9'; ++it, ++digits) {
+                if (digits >= 19) continue;
+                mantissa = mantissa * 10 + (*it - '0');
+                --exponent;
+            }
+        }
+        if (*it == 'e' || *it == 'E') {
+            ++it;
+            bool negativeExponent = *it == '-';
+            if (*it == '-' || *it == '+') ++it;
+            int explicitExponent{0};
+            for (; *it >= '0' && *it <= '9'; ++it)
+                explicitExponent = std::min(explicitExponent * 10 + (*it - '0'), 1000);
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+        }
+        static constexpr double powersOf10[]{1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+                                             1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0 && exponent >= -22) result /= powersOf10[-exponent];
+        else if (exponent > 0 && exponent <= 22) result *= powersOf10[exponent];
+        else if (exponent) result *= std::pow(10., exponent);
+        value = static_cast<float>(negative ? -result : result);
+        return it;
+    }
+
+    // Returns a 0 based index. Relative indices count back from the defined elements, the elements before the line,
+    // absolute indices may reference any of the total elements of the file
+    char const *parseIndex(char const *it, size_t defined, size_t total, int32_t& index)
+    {
+        bool negative = *it == '-';
+        if (negative) ++it;
+        index = missingIndex;
+        if (*it < '0' || *it > '9') return it;
+        int64_t value{0};
+        for (; *it >= '0' && *it <= '9'; ++it) value = std::min<int64_t>(value * 10 + (*it - '0'), int64_t{1} << 32);
+        value = negative ? int64_t(defined) - value : value - 1;
+        bool valid = value >= 0 && value < int64_t(negative ? defined : total);
+        index = valid ? static_cast<int32_t>(value) : invalidIndex;
+        return it;
+    }
+
+    // Face vertices look like v, v/vt, v//vn or v/vt/vn
+    char const *parseFaceVertex(char const *it, ObjCounts const& defined, ObjCounts const& total, ObjCorner& corner)
+    {
+        corner = {missingIndex, missingIndex, missingIndex};
+        it = parseIndex(it, defined.positions, total.positions, corner.position);
+        if (*it == '/') it = parseIndex(it + 1, defined.texcoords, total.texcoords, corner.texcoord);
+        if (*it == '/') it = parseIndex(it + 1, defined.normals, total.normals, corner.normal);
+        while (!isLineEnd(*it) && !isBlank(*it)) ++it;
+        return it;
+    }
+
+    // offsets are the counts of all chunks before this one, total those of the whole file
+    void parseElements(LineRange range, ObjCounts offsets, ObjCounts const& total, ObjData& data,
+                       std::string const& filepath)
+    {
+        auto defined = offsets;
+        for (auto it = range.begin; it != range.end; it = lineEnd(it, range.end) + 1) {
+            switch (lineType(it)) {
+                case LineType::position: {
+                    auto& position = data.positions[defined.positions++];
+                    it = parseFloat(parseFloat(parseFloat(it, position.x), position.y), position.z);
+                    break;
+                }
+                case LineType::texcoord: {
+                    auto& texcoord = data.texcoords[defined.texcoords++];
+                    it = parseFloat(parseFloat(it, texcoord.x), texcoord.y);
+                    break;
+                }
+                case LineType::normal: {
+                    auto& normal = data.normals[defined.normals++];
+                    it = parseFloat(parseFloat(parseFloat(it, normal.x), normal.y), normal.z);
+                    break;
+                }
+                case LineType::face: {
+                    ObjCorner first, previous, current;
+                    uint32_t vertex{0};
+                    for (it = skipBlanks(it); !isLineEnd(*it); it = skipBlanks(it), ++vertex) {
+                        it = parseFaceVertex(it, defined, total, current);
+                        if (current.position < 0 || current.texcoord == invalidIndex || current.normal == invalidIndex)
+                            throw std::runtime_error("[TGA] Utils: Invalid face index in OBJ file: " + filepath);
+                        if (vertex == 0) first = current;
+                        if (vertex >= 2) {
+                            data.corners[defined.corners++] = first;
+                            data.corners[defined.corners++] = previous;
+                            data.corners[defined.corners++] = current;
+                        }
+                        previous = current;
+                    }
+                    if (vertex == 4) data.quads[defined.quads++] = static_cast<uint32_t>(defined.corners - 6);
+                    break;
+                }
+                default: break;
+            }
+        }
+    }
+
+    ObjData parseObj(std::string const& filepath)
+    {
+        auto text = readText(filepath);
+        auto ranges = splitLines(text, 4 * workerCount());
+        auto rangeCount = static_cast<uint32_t>(ranges.size());
+
+        std::vector<ObjCounts> counts(rangeCount);
+        parallelFor(rangeCount, [&](uint32_t range) { counts[range] = countElements(ranges[range]); });
+        std::vector<ObjCounts> offsets(rangeCount);
+        ObjCounts total;
+        for (uint32_t range = 0; range < rangeCount; ++range) {
+            offsets[range] = total;
+            total.positions += counts[range].positions;
+            total.texcoords += counts[range].texcoords;
+            total.normals += counts[range].normals;
+            total.corners += counts[range].corners;
+            total.quads += counts[range].quads;
+        }
+        if (std::max(total.positions, std::max(total.texcoords, total.normals)) > size_t(INT32_MAX) ||
+            total.corners > UINT32_MAX)
+            throw std::runtime_error("[TGA] Utils: OBJ file is too large: " + filepath);
+
+        // Unset components stay 0
+        ObjData data;
+        data.positions.resize(total.positions, glm::vec3(0.f));
+        data.texcoords.resize(total.texcoords, glm::vec2(0.f));
+        data.normals.resize(total.normals, glm::vec3(0.f));
+        data.corners.resize(total.corners);
+        data.quads.resize(total.quads);
+        parallelFor(rangeCount,
+                    [&](uint32_t range) { parseElements(ranges[range], offsets[range], total, data, filepath); });
+        return data;
+    }
+
+    // Quads are split along their shorter diagonal like the former tinyobjloader based loadObj did. That needs the
+    // positions of vertices that may be defined after the face, so it runs once all chunks are parsed: the fan
+    // [0, 1, 2], [0, 2, 3] becomes [0, 1, 3], [1, 2, 3] unless 0-2 is the shorter diagonal
+    void splitQuads(ObjData& data)
+    {
+        auto taskCount = 4 * workerCount();
+        parallelFor(taskCount, [&](uint32_t task) {
+            for (auto quad = taskBegin(data.quads.size(), taskCount, task);
+                 quad < taskBegin(data.quads.size(), taskCount, task + 1); ++quad) {
+                auto corners = data.corners.begin() + data.quads[quad];
+                std::array<ObjCorner, 4> vertices{corners[0], corners[1], corners[2], corners[5]};
+                auto position = [&](uint32_t vertex) { return data.positions[vertices[vertex].position]; };
+                auto diagonal02 = position(2) - position(0);
+                auto diagonal13 = position(3) - position(1);
+                if (glm::dot(diagonal02, diagonal02) < glm::dot(diagonal13, diagonal13)) continue;
+                std::array<ObjCorner, 6> split{vertices[0], vertices[1], vertices[3],
+                                               vertices[1], vertices[2], vertices[3]};
+                std::copy(split.begin(), split.end(), corners);
+            }
+        });
+    }
+}  // namespace
+
+namespace /*vertex deduplication*/
+{
+    // Corners with equal position, uv and normal become one vertex, like Vertex::operator== compares them. Each corner
+    // is hashed, the corners are sorted into shards by the upper bits of the hash, and each shard is deduplicated with
+    // its own open addressing table. Shards keep the corners in their original order, so the first corner of each
+    // vertex is found and the tangents are summed in the same order as a sequential pass would.
+    constexpr uint32_t shardBits = 8;
+    constexpr uint32_t shardCount = 1u << shardBits;
+    constexpr uint32_t emptySlot = ~0u;
+
+    class Deduplicator {
+    public:
+        explicit Deduplicator(ObjData const& _data) : data(_data) {}
+
+        Obj run()
+        {
+            auto cornerCount = data.corners.size();
+            auto taskCount = 4 * workerCount();
+            computeTangents(taskCount);
+            hashCorners(taskCount);
+            sortIntoShards(taskCount);
+
+            firstCorners.resize(cornerCount);
+            tangentSums.resize(cornerCount);
+            parallelFor(shardCount, [&](uint32_t shard) { deduplicateShard(shard); });
+
+            // Vertices are numbered in the order of their first corner
+            Obj obj;
+            obj.indexBuffer.resize(cornerCount);
+            std::vector<uint32_t> vertexCorners;
+            vertexCorners.reserve(cornerCount);
+            for (uint32_t corner = 0; corner < cornerCount; ++corner) {
+                if (firstCorners[corner] == corner) {
+                    obj.indexBuffer[corner] = static_cast<uint32_t>(vertexCorners.size());
+                    vertexCorners.push_back(corner);
+                } else {
+                    obj.indexBuffer[corner] = obj.indexBuffer[firstCorners[corner]];
+                }
+            }
+
+            obj.vertexBuffer.resize(vertexCorners.size());
+            parallelFor(taskCount, [&](uint32_t task) {
+                for (auto vertex = taskBegin(vertexCorners.size(), taskCount, task);
+                     vertex < taskBegin(vertexCorners.size(), taskCount, task + 1); ++vertex) {
+                    auto corner = vertexCorners[vertex];
+                    auto& result = obj.vertexBuffer[vertex];
+                    result.position = position(corner);
+                    result.uv = uv(corner);
+                    result.normal = normal(corner);
+                    result.tangent = glm::normalize(tangentSums[corner]);
+                }
+            });
+            return obj;
+        }
+
+    private:
+        ObjData const& data;
+        std::vector<glm::vec3> triangleTangents;
+        std::vector<uint64_t> hashes;
+        std::vector<uint32_t> sortedCorners;
+        std::array<size_t, shardCount + 1> shardBegins;
+        std::vector<uint32_t> firstCorners;  // The first corner with equal attributes, for every corner
+        std::vector<glm::vec3> tangentSums;  // Sums of the tangents of all corners of a vertex, at its first corner
+
+        glm::vec3 position(size_t corner) const { return data.positions[data.corners[corner].position]; }
+        glm::vec2 uv(size_t corner) const
+        {
+            auto index = data.corners[corner].texcoord;
+            if (index == missingIndex) return glm::vec2(0.f);
+            return {data.texcoords[index].x, 1.f - data.texcoords[index].y};
+        }
+        glm::vec3 normal(size_t corner) const
+        {
+            auto index = data.corners[corner].normal;
+            return index == missingIndex ? glm::vec3(0.f) : data.normals[index];
+        }
+
+        // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-13-normal-mapping/
+        void computeTangents(uint32_t taskCount)
+        {
+            auto triangleCount = data.corners.size() / 3;
+            triangleTangents.resize(triangleCount);
+            parallelFor(taskCount, [&](uint32_t task) {
+                for (auto triangle = taskBegin(triangleCount, taskCount, task);
+                     triangle < taskBegin(triangleCount, taskCount, task + 1); ++triangle) {
+                    auto deltaPos1 = position(3 * triangle + 1) - position(3 * triangle);
+                    auto deltaPos2 = position(3 * triangle + 2) - position(3 * triangle);
+                    auto deltaUV1 = uv(3 * triangle + 1) - uv(3 * triangle);
+                    auto deltaUV2 = uv(3 * triangle + 2) - uv(3 * triangle);
+                    float r = 1.f / (deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x);
+                    triangleTangents[triangle] = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * r;
+                }
+            });
+        }
+
+        // Equal attributes must give equal hashes, adding 0 turns -0 into 0 which compares equal to it
+        uint64_t hash(size_t corner) const
+        {
+            auto p = position(corner);
+            auto t = uv(corner);
+            auto n = normal(corner);
+            float const values[]{p.x, p.y, p.z, t.x, t.y, n.x, n.y, n.z};
+            uint64_t result{0x9E3779B97F4A7C15ull};
+            for (auto value : values) {
+                uint32_t bits;
+                value += 0.f;
+                std::memcpy(&bits, &value, sizeof(bits));
+                result = (result ^ bits) * 0xFF51AFD7ED558CCDull;
+                result ^= result >> 32;
+            }
+            // Finalizer of MurmurHash3, spreads every input bit over the shard and slot bits
+            result ^= result >> 33;
+            result *= 0xC4CEB9FE1A85EC53ull;
+            result ^= result >> 33;
+            return result;
+        }
+
+        bool sameAttributes(size_t a, size_t b) const
+        {
+            auto& cornerA = data.corners[a];
+            auto& cornerB = data.corners[b];
+            if (cornerA.position == cornerB.position && cornerA.texcoord == cornerB.texcoord &&
+                cornerA.normal == cornerB.normal)
+                return true;
+            return position(a) == position(b) && uv(a) == uv(b) && normal(a) == normal(b);
+        }
+
+        void hashCorners(uint32_t taskCount)
+        {
+            auto cornerCount = data.corners.size();
+            hashes.resize(cornerCount);
+            parallelFor(taskCount, [&](uint32_t task) {
+                for (auto corner = taskBegin(cornerCount, taskCount, task);
+                     corner < taskBegin(cornerCount, taskCount, task + 1); ++corner)
+                    hashes[corner] = hash(corner);
+            });
+        }
+
+        // Stable counting sort by shard, each task sorts its part of the corners into its own region of every shard
+        void sortIntoShards(uint32_t taskCount)
+        {
+            auto cornerCount = data.corners.size();
+            std::vector<std::array<size_t, shardCount>> taskOffsets(taskCount);
+            parallelFor(taskCount, [&](uint32_t task) {
+                auto& counts = taskOffsets[task];
+                counts.fill(0);
+                for (auto corner = taskBegin(cornerCount, taskCount, task);
+                     corner < taskBegin(cornerCount, taskCount, task + 1); ++corner)
+                    ++counts[hashes[corner] >> (64 - shardBits)];
+            });
+            size_t offset{0};
+            for (uint32_t shard = 0; shard < shardCount; ++shard) {
+                shardBegins[shard] = offset;
+                for (auto& offsets : taskOffsets) {
+                    auto count = offsets[shard];
+                    offsets[shard] = offset;
+                    offset += count;
+                }
+            }
+            shardBegins[shardCount] = offset;
+
+            sortedCorners.resize(cornerCount);
+            parallelFor(taskCount, [&](uint32_t task) {
+                auto& offsets = taskOffsets[task];
+                for (auto corner = taskBegin(cornerCount, taskCount, task);
+                     corner < taskBegin(cornerCount, taskCount, task + 1); ++corner)
+                    sortedCorners[offsets[hashes[corner] >> (64 - shardBits)]++] = static_cast<uint32_t>(corner);
+            });
+        }
+
+        // Linear probing in a table with at least twice as many slots as corners
+        void deduplicateShard(uint32_t shard)
+        {
+            auto begin = sortedCorners.begin() + shardBegins[shard];
+            auto end = sortedCorners.begin() + shardBegins[shard + 1];
+            size_t slotCount{1};
+            while (slotCount < 2 * size_t(end - begin)) slotCount <<= 1;
+            std::vector<uint32_t> slots(slotCount, emptySlot);
+            for (auto it = begin; it != end; ++it) {
+                auto corner = *it;
+                auto cornerTangent = triangleTangents[corner / 3];
+                for (auto slot = hashes[corner] & (slotCount - 1);; slot = (slot + 1) & (slotCount - 1)) {
+                    auto other = slots[slot];
+                    if (other == emptySlot) {
+                        slots[slot] = corner;
+                        firstCorners[corner] = corner;
+                        tangentSums[corner] = cornerTangent;
+                        break;
+                    }
+                    if (hashes[other] == hashes[corner] && sameAttributes(other, corner)) {
+                        firstCorners[corner] = other;
+                        tangentSums[other] += cornerTangent;
+                        break;
+                    }
+                }
+            }
+        }
+    };
+}  // namespace
+
+Obj loadObj(std::string const& filepath)
+{
+    auto data = parseObj(filepath);
+    splitQuads(data);
+    return Deduplicator(data).run();
+}
+}  // namespace tga
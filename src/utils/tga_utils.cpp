@@ -4,7 +4,11 @@
 
 #include "tga/tga_utils.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 
 namespace tga
 {
@@ -17,6 +21,15 @@ VertexLayout Vertex::layout()
              {offsetof(Vertex, tangent), tga::Format::r32g32b32_sfloat}}};
 }
 
+VertexLayout CompactVertex::layout()
+{
+    return {sizeof(CompactVertex),
+            {{offsetof(CompactVertex, position), tga::Format::r16g16b16a16_unorm},
+             {offsetof(CompactVertex, uv), tga::Format::r16g16_sfloat},
+             {offsetof(CompactVertex, normal), tga::Format::r16g16_snorm},
+             {offsetof(CompactVertex, tangent), tga::Format::r16g16_snorm}}};
+}
+
 Shader loadShader(std::string const& filepath, ShaderType shaderType, tga::Interface& tgai)
 {
     std::ifstream file(filepath, std::ios::binary);
@@ -79,9 +92,300 @@ bool isFloatingPointFormat(Format format)
     }
 }
 
+namespace /*texture containers*/
+{
+    // A mip level as it is stored in a container file
+    struct ContainerLevel {
+        uint64_t fileOffset;
+        uint64_t size;
+    };
+
+    struct ContainerImage {
+        Format format{Format::undefined};
+        uint32_t width, height;
+        TextureType textureType{TextureType::_2D};
+        uint32_t layers{1};
+        std::vector<ContainerLevel> levels;  // Largest level first
+    };
+
+    std::vector<uint8_t> readBytes(std::ifstream& file, uint64_t offset, size_t count, std::string const& filepath)
+    {
+        std::vector<uint8_t> bytes(count);
+        file.seekg(static_cast<std::streamoff>(offset));
+        if (!file.read(reinterpret_cast<char *>(bytes.data()), count))
+            throw std::runtime_error("[TGA] Utils: Unexpected end of file: " + filepath);
+        return bytes;
+    }
+
+    template <typename T>
+    T readAt(std::vector<uint8_t> const& bytes, size_t offset)
+    {
+        T value;
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        return value;
+    }
+
+    uint64_t containerLevelSize(ContainerImage const& image, uint32_t level)
+    {
+        return image.layers *
+               formatImageSize(image.format, std::max(image.width >> level, 1u), std::max(image.height >> level, 1u));
+    }
+
+    // KTX2 stores the VkFormat of the data
+    Format formatFromVkFormat(uint32_t vkFormat)
+    {
+        switch (vkFormat) {
+            case 9 /*VK_FORMAT_R8_UNORM*/: return Format::r8_unorm;
+            case 16 /*VK_FORMAT_R8G8_UNORM*/: return Format::r8g8_unorm;
+            case 37 /*VK_FORMAT_R8G8B8A8_UNORM*/: return Format::r8g8b8a8_unorm;
+            case 43 /*VK_FORMAT_R8G8B8A8_SRGB*/: return Format::r8g8b8a8_srgb;
+            case 70 /*VK_FORMAT_R16_UNORM*/: return Format::r16_unorm;
+            case 71 /*VK_FORMAT_R16_SNORM*/: return Format::r16_snorm;
+            case 77 /*VK_FORMAT_R16G16_UNORM*/: return Format::r16g16_unorm;
+            case 78 /*VK_FORMAT_R16G16_SNORM*/: return Format::r16g16_snorm;
+            case 91 /*VK_FORMAT_R16G16B16A16_UNORM*/: return Format::r16g16b16a16_unorm;
+            case 92 /*VK_FORMAT_R16G16B16A16_SNORM*/: return Format::r16g16b16a16_snorm;
+            case 97 /*VK_FORMAT_R16G16B16A16_SFLOAT*/: return Format::r16g16b16a16_sfloat;
+            case 109 /*VK_FORMAT_R32G32B32A32_SFLOAT*/: return Format::r32g32b32a32_sfloat;
+            case 131 /*VK_FORMAT_BC1_RGB_UNORM_BLOCK*/: return Format::bc1_rgb_unorm;
+            case 132 /*VK_FORMAT_BC1_RGB_SRGB_BLOCK*/: return Format::bc1_rgb_srgb;
+            case 133 /*VK_FORMAT_BC1_RGBA_UNORM_BLOCK*/: return Format::bc1_rgba_unorm;
+            case 134 /*VK_FORMAT_BC1_RGBA_SRGB_BLOCK*/: return Format::bc1_rgba_srgb;
+            case 135 /*VK_FORMAT_BC2_UNORM_BLOCK*/: return Format::bc2_unorm;
+            case 136 /*VK_FORMAT_BC2_SRGB_BLOCK*/: return Format::bc2_srgb;
+            case 137 /*VK_FORMAT_BC3_UNORM_BLOCK*/: return Format::bc3_unorm;
+            case 138 /*VK_FORMAT_BC3_SRGB_BLOCK*/: return Format::bc3_srgb;
+            case 139 /*VK_FORMAT_BC4_UNORM_BLOCK*/: return Format::bc4_unorm;
+            case 140 /*VK_FORMAT_BC4_SNORM_BLOCK*/: return Format::bc4_snorm;
+            case 141 /*VK_FORMAT_BC5_UNORM_BLOCK*/: return Format::bc5_unorm;
+            case 142 /*VK_FORMAT_BC5_SNORM_BLOCK*/: return Format::bc5_snorm;
+            case 143 /*VK_FORMAT_BC6H_UFLOAT_BLOCK*/: return Format::bc6h_ufloat;
+            case 144 /*VK_FORMAT_BC6H_SFLOAT_BLOCK*/: return Format::bc6h_sfloat;
+            case 145 /*VK_FORMAT_BC7_UNORM_BLOCK*/: return Format::bc7_unorm;
+            case 146 /*VK_FORMAT_BC7_SRGB_BLOCK*/: return Format::bc7_srgb;
+            case 147 /*VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK*/: return Format::etc2_r8g8b8_unorm;
+            case 148 /*VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK*/: return Format::etc2_r8g8b8_srgb;
+            case 149 /*VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK*/: return Format::etc2_r8g8b8a1_unorm;
+            case 150 /*VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK*/: return Format::etc2_r8g8b8a1_srgb;
+            case 151 /*VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK*/: return Format::etc2_r8g8b8a8_unorm;
+            case 152 /*VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK*/: return Format::etc2_r8g8b8a8_srgb;
+            case 157 /*VK_FORMAT_ASTC_4x4_UNORM_BLOCK*/: return Format::astc_4x4_unorm;
+            case 158 /*VK_FORMAT_ASTC_4x4_SRGB_BLOCK*/: return Format::astc_4x4_srgb;
+            case 165 /*VK_FORMAT_ASTC_6x6_UNORM_BLOCK*/: return Format::astc_6x6_unorm;
+            case 166 /*VK_FORMAT_ASTC_6x6_SRGB_BLOCK*/: return Format::astc_6x6_srgb;
+            case 171 /*VK_FORMAT_ASTC_8x8_UNORM_BLOCK*/: return Format::astc_8x8_unorm;
+            case 172 /*VK_FORMAT_ASTC_8x8_SRGB_BLOCK*/: return Format::astc_8x8_srgb;
+            default: return Format::undefined;
+        }
+    }
+
+    // DDS files with a DX10 header store a DXGI_FORMAT
+    Format formatFromDxgiFormat(uint32_t dxgiFormat)
+    {
+        switch (dxgiFormat) {
+            case 2 /*DXGI_FORMAT_R32G32B32A32_FLOAT*/: return Format::r32g32b32a32_sfloat;
+            case 10 /*DXGI_FORMAT_R16G16B16A16_FLOAT*/: return Format::r16g16b16a16_sfloat;
+            case 11 /*DXGI_FORMAT_R16G16B16A16_UNORM*/: return Format::r16g16b16a16_unorm;
+            case 13 /*DXGI_FORMAT_R16G16B16A16_SNORM*/: return Format::r16g16b16a16_snorm;
+            case 28 /*DXGI_FORMAT_R8G8B8A8_UNORM*/: return Format::r8g8b8a8_unorm;
+            case 29 /*DXGI_FORMAT_R8G8B8A8_UNORM_SRGB*/: return Format::r8g8b8a8_srgb;
+            case 35 /*DXGI_FORMAT_R16G16_UNORM*/: return Format::r16g16_unorm;
+            case 37 /*DXGI_FORMAT_R16G16_SNORM*/: return Format::r16g16_snorm;
+            case 56 /*DXGI_FORMAT_R16_UNORM*/: return Format::r16_unorm;
+            case 58 /*DXGI_FORMAT_R16_SNORM*/: return Format::r16_snorm;
+            case 71 /*DXGI_FORMAT_BC1_UNORM*/: return Format::bc1_rgba_unorm;
+            case 72 /*DXGI_FORMAT_BC1_UNORM_SRGB*/: return Format::bc1_rgba_srgb;
+            case 74 /*DXGI_FORMAT_BC2_UNORM*/: return Format::bc2_unorm;
+            case 75 /*DXGI_FORMAT_BC2_UNORM_SRGB*/: return Format::bc2_srgb;
+            case 77 /*DXGI_FORMAT_BC3_UNORM*/: return Format::bc3_unorm;
+            case 78 /*DXGI_FORMAT_BC3_UNORM_SRGB*/: return Format::bc3_srgb;
+            case 80 /*DXGI_FORMAT_BC4_UNORM*/: return Format::bc4_unorm;
+            case 81 /*DXGI_FORMAT_BC4_SNORM*/: return Format::bc4_snorm;
+            case 83 /*DXGI_FORMAT_BC5_UNORM*/: return Format::bc5_unorm;
+            case 84 /*DXGI_FORMAT_BC5_SNORM*/: return Format::bc5_snorm;
+            case 95 /*DXGI_FORMAT_BC6H_UF16*/: return Format::bc6h_ufloat;
+            case 96 /*DXGI_FORMAT_BC6H_SF16*/: return Format::bc6h_sfloat;
+            case 98 /*DXGI_FORMAT_BC7_UNORM*/: return Format::bc7_unorm;
+            case 99 /*DXGI_FORMAT_BC7_UNORM_SRGB*/: return Format::bc7_srgb;
+            default: return Format::undefined;
+        }
+    }
+
+    std::string lowercaseExtension(std::string const& filepath)
+    {
+        auto extension = std::filesystem::path(filepath).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension;
+    }
+
+    constexpr uint32_t fourCC(char const (&code)[5])
+    {
+        return uint32_t(uint8_t(code[0])) | uint32_t(uint8_t(code[1])) << 8 | uint32_t(uint8_t(code[2])) << 16 |
+               uint32_t(uint8_t(code[3])) << 24;
+    }
+
+    ContainerImage parseKTX2(std::ifstream& file, std::string const& filepath)
+    {
+        // Identifier, header and index, followed by the level index
+        constexpr size_t levelIndexOffset = 80;
+        auto header = readBytes(file, 0, levelIndexOffset, filepath);
+        constexpr uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+        if (std::memcmp(header.data(), identifier, sizeof(identifier)) != 0)
+            throw std::runtime_error("[TGA] Utils: Not a KTX2 file: " + filepath);
+
+        uint32_t vkFormat = readAt<uint32_t>(header, 12);
+        ContainerImage image;
+        image.format = formatFromVkFormat(vkFormat);
+        image.width = readAt<uint32_t>(header, 20);
+        image.height = std::max(readAt<uint32_t>(header, 24), 1u);
+        uint32_t depth = readAt<uint32_t>(header, 28);
+        uint32_t layerCount = readAt<uint32_t>(header, 32);
+        uint32_t faceCount = readAt<uint32_t>(header, 36);
+        uint32_t levelCount = std::max(readAt<uint32_t>(header, 40), 1u);
+        uint32_t supercompression = readAt<uint32_t>(header, 44);
+
+        if (image.format == Format::undefined)
+            throw std::runtime_error("[TGA] Utils: Unsupported VkFormat " + std::to_string(vkFormat) + " in " +
+                                     filepath);
+        if (supercompression != 0)
+            throw std::runtime_error("[TGA] Utils: Supercompressed KTX2 files (Basis/Zstd) are not supported: " +
+                                     filepath);
+        if (depth > 1 || (faceCount == 6 && layerCount > 1))
+            throw std::runtime_error("[TGA] Utils: 3D textures and cube map arrays are not supported: " + filepath);
+
+        if (faceCount == 6) {
+            image.textureType = TextureType::_Cube;
+            image.layers = 6;
+        } else if (layerCount > 1) {
+            image.textureType = TextureType::_2DArray;
+            image.layers = layerCount;
+        }
+
+        // Each level holds all layers and faces of that level
+        auto levelIndex = readBytes(file, levelIndexOffset, levelCount * 3 * sizeof(uint64_t), filepath);
+        for (uint32_t level = 0; level < levelCount; ++level) {
+            uint64_t byteOffset = readAt<uint64_t>(levelIndex, level * 3 * sizeof(uint64_t));
+            uint64_t byteLength = readAt<uint64_t>(levelIndex, (level * 3 + 1) * sizeof(uint64_t));
+            uint64_t size = containerLevelSize(image, level);
+            if (byteLength < size) throw std::runtime_error("[TGA] Utils: Truncated mip level in " + filepath);
+            image.levels.push_back({byteOffset, size});
+        }
+        return image;
+    }
+
+    ContainerImage parseDDS(std::ifstream& file, std::string const& filepath)
+    {
+        // Magic number and DDS_HEADER, optionally followed by a DDS_HEADER_DXT10
+        constexpr size_t headerSize = 4 + 124;
+        constexpr size_t dx10HeaderSize = 20;
+        auto header = readBytes(file, 0, headerSize, filepath);
+        if (readAt<uint32_t>(header, 0) != fourCC("DDS "))
+            throw std::runtime_error("[TGA] Utils: Not a DDS file: " + filepath);
+
+        constexpr uint32_t mipMapCountFlag = 0x20000;
+        constexpr uint32_t cubeMapCaps = 0x200;
+        constexpr uint32_t volumeCaps = 0x200000;
+        uint32_t flags = readAt<uint32_t>(header, 8);
+        ContainerImage image;
+        image.height = readAt<uint32_t>(header, 12);
+        image.width = readAt<uint32_t>(header, 16);
+        uint32_t levelCount = (flags & mipMapCountFlag) ? std::max(readAt<uint32_t>(header, 28), 1u) : 1;
+        uint32_t pixelFormatFourCC = readAt<uint32_t>(header, 84);
+        uint32_t caps2 = readAt<uint32_t>(header, 112);
+        if (caps2 & (cubeMapCaps | volumeCaps))
+            throw std::runtime_error("[TGA] Utils: DDS cube maps and volume textures are not supported: " + filepath);
+
+        uint64_t dataOffset = headerSize;
+        switch (pixelFormatFourCC) {
+            case fourCC("DXT1"): image.format = Format::bc1_rgba_unorm; break;
+            case fourCC("DXT3"): image.format = Format::bc2_unorm; break;
+            case fourCC("DXT5"): image.format = Format::bc3_unorm; break;
+            case fourCC("ATI1"):
+            case fourCC("BC4U"): image.format = Format::bc4_unorm; break;
+            case fourCC("BC4S"): image.format = Format::bc4_snorm; break;
+            case fourCC("ATI2"):
+            case fourCC("BC5U"): image.format = Format::bc5_unorm; break;
+            case fourCC("BC5S"): image.format = Format::bc5_snorm; break;
+            case fourCC("DX10"): {
+                auto dx10Header = readBytes(file, headerSize, dx10HeaderSize, filepath);
+                uint32_t dxgiFormat = readAt<uint32_t>(dx10Header, 0);
+                constexpr uint32_t textureCubeFlag = 0x4;
+                if ((readAt<uint32_t>(dx10Header, 8) & textureCubeFlag) || readAt<uint32_t>(dx10Header, 12) > 1)
+                    throw std::runtime_error("[TGA] Utils: DDS cube maps and arrays are not supported: " + filepath);
+                image.format = formatFromDxgiFormat(dxgiFormat);
+                if (image.format == Format::undefined)
+                    throw std::runtime_error("[TGA] Utils: Unsupported DXGI format " + std::to_string(dxgiFormat) +
+                                             " in " + filepath);
+                dataOffset += dx10HeaderSize;
+                break;
+            }
+            default:
+                throw std::runtime_error("[TGA] Utils: Unsupported DDS pixel format, only block-compressed DDS files "
+                                         "can be loaded: " + filepath);
+        }
+
+        // Levels are stored one after another, starting with the largest
+        for (uint32_t level = 0; level < levelCount; ++level) {
+            uint64_t size = containerLevelSize(image, level);
+            image.levels.push_back({dataOffset, size});
+            dataOffset += size;
+        }
+        return image;
+    }
+}  // namespace
+
+TextureBundle loadCompressedTexture(std::string const& filepath, SamplerMode samplerMode, AddressMode addressMode,
+                                    tga::Interface& tgai)
+{
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) throw std::runtime_error("[TGA] Utils: Can't load image: " + filepath);
+
+    auto extension = lowercaseExtension(filepath);
+    ContainerImage image;
+    if (extension == ".ktx2")
+        image = parseKTX2(file, filepath);
+    else if (extension == ".dds")
+        image = parseDDS(file, filepath);
+    else
+        throw std::runtime_error("[TGA] Utils: Unknown texture container, expected .ktx2 or .dds: " + filepath);
+
+    // The mip chain is read from the file straight into the staging buffer, tightly packed as createTexture expects
+    uint64_t dataSize{0};
+    for (auto& level : image.levels) dataSize += level.size;
+    auto staging = tgai.createStagingBuffer({dataSize});
+    auto mapping = static_cast<char *>(tgai.getMapping(staging));
+    for (auto& level : image.levels) {
+        file.seekg(static_cast<std::streamoff>(level.fileOffset));
+        if (!file.read(mapping, static_cast<std::streamsize>(level.size))) {
+            tgai.free(staging);
+            throw std::runtime_error("[TGA] Utils: Unexpected end of file: " + filepath);
+        }
+        mapping += level.size;
+    }
+
+    Texture texture;
+    try {
+        texture = tgai.createTexture(tga::TextureInfo{image.width, image.height, image.format, samplerMode, addressMode,
+                                                      image.textureType, image.layers, staging}
+                                         .setMipLevels(static_cast<uint32_t>(image.levels.size()))
+                                         .setSrcDataMipChain(true));
+    } catch (...) {
+        tgai.free(staging);
+        throw;
+    }
+    tgai.free(staging);
+    return {texture, image.width, image.height};
+}
+
 TextureBundle loadTexture(std::string const& filepath, Format format, SamplerMode samplerMode, AddressMode addressMode,
                           tga::Interface& tgai, bool doGammaCorrection)
 {
+    // Containers carry their own format and precompressed mip levels
+    auto extension = lowercaseExtension(filepath);
+    if (extension == ".ktx2" || extension == ".dds")
+        return loadCompressedTexture(filepath, samplerMode, addressMode, tgai);
+
     int width, height, channels;
     int components = formatComponentCount(format);
     uint8_t *data;